@@ -0,0 +1,73 @@
+#include "arena.h"
+
+#include <stdio.h> 
+
+#define ALIGN_UP(n, a) (((n) + (a) - 1) & ~((size_t)(a) - 1))
+#define CHUNK_HEADER ALIGN_UP(sizeof(Arena_chunk), ARENA_ALIGN)
+#define CHUNK_DATA(chunk) ((char*)(chunk) + CHUNK_HEADER)
+
+static Arena_chunk* arena_new_chunk(Arena* arena, size_t min_size)
+{
+    size_t size = min_size > ARENA_CHUNK_SIZE ? min_size : ARENA_CHUNK_SIZE; 
+    Arena_chunk* chunk = malloc(CHUNK_HEADER + size); 
+    if (!chunk)
+    {
+        fprintf(stderr, "Error: out of memory\n"); 
+        exit(1); 
+    }
+
+    chunk->prev = arena->current; 
+    chunk->size = size; 
+    chunk->used = 0; 
+    arena->current = chunk; 
+    arena->bytes_reserved += CHUNK_HEADER + size; 
+
+    return chunk; 
+}
+
+void arena_init(Arena* arena)
+{
+    arena->current = NULL; 
+    arena->bytes_used = 0; 
+    arena->bytes_reserved = 0; 
+}
+
+void* arena_alloc(Arena* arena, size_t size)
+{
+    size = ALIGN_UP(size, ARENA_ALIGN); 
+
+    Arena_chunk* chunk = arena->current; 
+    if (!chunk || chunk->size - chunk->used < size)
+        chunk = arena_new_chunk(arena, size); 
+
+    void* ptr = CHUNK_DATA(chunk) + chunk->used; 
+    chunk->used += size; 
+    arena->bytes_used += size; 
+
+    return ptr; 
+}
+
+char* arena_strndup(Arena* arena, const char* str, size_t len)
+{
+    char* copy = arena_alloc(arena, len + 1); 
+    memcpy(copy, str, len); 
+    copy[len] = '\0'; 
+    return copy; 
+}
+
+char* arena_strdup(Arena* arena, const char* str)
+{
+    return arena_strndup(arena, str, strlen(str)); 
+}
+
+void arena_release(Arena* arena)
+{
+    Arena_chunk* chunk = arena->current; 
+    while (chunk)
+    {
+        Arena_chunk* prev = chunk->prev; 
+        free(chunk); 
+        chunk = prev; 
+    }
+    arena_init(arena); 
+}
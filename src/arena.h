@@ -0,0 +1,32 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdlib.h> 
+#include <stddef.h> 
+#include <string.h> 
+
+/* bump pointer allocator, everything is released at once with arena_release */ 
+
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#define ARENA_ALIGN _Alignof(max_align_t)
+
+typedef struct Arena_chunk_s {
+    struct Arena_chunk_s* prev; 
+    size_t size;  /* usable bytes after the header */ 
+    size_t used; 
+} Arena_chunk; 
+
+typedef struct Arena_s {
+    Arena_chunk* current; 
+    size_t bytes_used;      /* bytes handed out (with padding) */ 
+    size_t bytes_reserved;  /* bytes requested from malloc */ 
+} Arena; 
+
+void    arena_init(Arena* arena); 
+void*   arena_alloc(Arena* arena, size_t size); 
+char*   arena_strdup(Arena* arena, const char* str); 
+char*   arena_strndup(Arena* arena, const char* str, size_t len); 
+/* free every chunk, the arena can be reused after */ 
+void    arena_release(Arena* arena); 
+
+#endif
@@ -1,11 +1,68 @@
 #include "ast.h"
+#include "error.h"
 
 #include <stdarg.h> 
 
 #define NODE_CREATE(node, node_var_type, node_type) \
-    node_var_type* node = malloc(sizeof(node_var_type));\
+    node_var_type* node = ast_alloc(node_type, sizeof(node_var_type));\
     node -> type = node_type\
 
+/* every compilation builds and releases its ast on one thread */ 
+static _Thread_local Arena ast_arena; 
+static _Thread_local size_t ast_kind_bytes[NODE_TYPE_NB]; 
+static _Thread_local size_t ast_kind_count[NODE_TYPE_NB]; 
+
+static const char* ast_kind_names[NODE_TYPE_NB] = {
+    "program", "subprograms", "function", "params", "param", "args", "arg", 
+    "type", "new_type_decls", "array_type_decl", "matrix_type_decl", 
+    "declarations", "var_declaration", "fun_declaration", 
+    "statements", "assign", "if", "elif", "branch", "for", "while", "dowhile", 
+    "return", "print", "read", 
+    "op", "const", "id", "call", "arr_sub", "mat_sub", 
+}; 
+
+static void* ast_alloc(Node_type kind, size_t size)
+{
+    ast_kind_bytes[kind] += size; 
+    ast_kind_count[kind]++; 
+    return arena_alloc(&ast_arena, size); 
+}
+
+static void ast_list_init(Vector* list)
+{
+    VEC_init(list, &ast_arena); 
+}
+
+/* list storage is accounted to the node owning the list */ 
+static void ast_list_insert(Node_type owner, Vector* list, void* data)
+{
+    size_t used = ast_arena.bytes_used; 
+    VEC_push_back(list, data); 
+    ast_kind_bytes[owner] += ast_arena.bytes_used - used; 
+}
+
+void AST_arena_release(void)
+{
+    arena_release(&ast_arena); 
+    memset(ast_kind_bytes, 0, sizeof(ast_kind_bytes)); 
+    memset(ast_kind_count, 0, sizeof(ast_kind_count)); 
+}
+
+void AST_stats_print(FILE* out)
+{
+    size_t total = 0; 
+    fprintf(out, "%-18s %10s %12s\n", "node kind", "count", "bytes"); 
+    for (int kind = 0; kind < NODE_TYPE_NB; kind++)
+    {
+        if (!ast_kind_count[kind])
+            continue; 
+        fprintf(out, "%-18s %10zu %12zu\n", ast_kind_names[kind], ast_kind_count[kind], ast_kind_bytes[kind]); 
+        total += ast_kind_bytes[kind]; 
+    }
+    fprintf(out, "%-18s %10s %12zu (arena reserved %zu)\n", "total", "", total, ast_arena.bytes_reserved); 
+    fprintf(out, "%-18s %10zu %12zu (interned once)\n", "identifiers", intern_count(), intern_bytes()); 
+}
+
 AST_node *ast_program_create(AST_node* new_types, AST_node* subprograms, AST_node* decls, AST_node* stmts)
 {
     NODE_CREATE(node, AST_program_node, NODE_PROGRAM); 
@@ -23,7 +80,7 @@ AST_node *ast_subprograms_create(AST_node* subprogram_node)
 {
     NODE_CREATE(node, AST_subprograms_node, NODE_SUBPROGRAMS); 
     
-    node -> functions_list = LL_create_list(); 
+    ast_list_init(&node -> functions_list); 
     ast_subprograms_insert((AST_node*)node, subprogram_node); 
 
     return (AST_node*) node; 
@@ -32,7 +89,7 @@ AST_node *ast_subprograms_create(AST_node* subprogram_node)
 void ast_subprograms_insert(AST_node* subprogram_nodes, AST_node* subprogram_node)
 {
     if (subprogram_node->type == NODE_FUNCTION)
-        LL_insert_back(((AST_subprograms_node*)subprogram_nodes)->functions_list,subprogram_node); 
+        ast_list_insert(NODE_SUBPROGRAMS, &((AST_subprograms_node*)subprogram_nodes)->functions_list, subprogram_node); 
 }
 
 AST_node *ast_function_create(AST_node* id_node, AST_node* params, AST_node* decls, AST_node* stmts, AST_node* ret_type)
@@ -44,6 +101,10 @@ AST_node *ast_function_create(AST_node* id_node, AST_node* params, AST_node* dec
     node->params   = params; 
     node->declarations = decls;  
     node -> statements = stmts; 
+    node -> evaluable = false; 
+    node -> effect = EFFECT_ANY; 
+    node -> norecurse = false; 
+    node -> willreturn = false; 
 
     return (AST_node*) node; 
 }
@@ -52,7 +113,7 @@ AST_node *ast_params_create(AST_node* param)
 {
     NODE_CREATE(node, AST_params_node, NODE_PARAMS); 
     
-    node->params_list = LL_create_list(); 
+    ast_list_init(&node->params_list); 
     ast_params_insert((AST_node*)node, param); 
     
     return (AST_node*) node; 
@@ -60,7 +121,7 @@ AST_node *ast_params_create(AST_node* param)
 
 void ast_params_insert(AST_node* params, AST_node* param)
 {
-    LL_insert_back(((AST_params_node*)params)->params_list, param); 
+    ast_list_insert(NODE_PARAMS, &((AST_params_node*)params)->params_list, param); 
 }
 
 AST_node *ast_param_create(AST_node* id_type, AST_node* id_node)
@@ -75,9 +136,9 @@ AST_node *ast_param_create(AST_node* id_type, AST_node* id_node)
 
 AST_node *ast_args_create(AST_node* arg)
 {
-    NODE_CREATE(node, AST_args_node, NODE_PARAMS); 
+    NODE_CREATE(node, AST_args_node, NODE_ARGS); 
     
-    node->args_list = LL_create_list(); 
+    ast_list_init(&node->args_list); 
     ast_args_insert((AST_node*)node, arg); 
     
     return (AST_node*) node; 
@@ -85,7 +146,7 @@ AST_node *ast_args_create(AST_node* arg)
 
 void ast_args_insert(AST_node* args, AST_node* arg)
 {
-    LL_insert_back(((AST_args_node*)args)->args_list, arg); 
+    ast_list_insert(NODE_ARGS, &((AST_args_node*)args)->args_list, arg); 
 }
 
 AST_node *ast_arg_create(AST_node* exp)
@@ -102,13 +163,13 @@ AST_node *ast_type_create_from_type(Type* type)
     NODE_CREATE(node, AST_type_node, NODE_TYPE); 
 
     node->type_kind = TYPE_NODE_PRIMITIVE; 
-    node->id        = NULL; 
+    node->id        = SYMBOL_NONE; 
     node->id_type   = type; 
     
     return (AST_node*)node; 
 }
 
-AST_node *ast_type_create_from_name(char* name)
+AST_node *ast_type_create_from_name(Symbol name)
 {
     NODE_CREATE(node, AST_type_node, NODE_TYPE); 
 
@@ -123,7 +184,7 @@ AST_node *ast_ntype_decls_node_create(AST_node* decl_node)
 {
     NODE_CREATE(node, AST_ntype_decls_node, NODE_NEW_TYPE_DECLS); 
 
-    node -> new_type_decls_list = LL_create_list(); 
+    ast_list_init(&node -> new_type_decls_list); 
     ast_ntype_decls_node_insert((AST_node*)node, decl_node); 
 
     return (AST_node*) node; 
@@ -131,7 +192,7 @@ AST_node *ast_ntype_decls_node_create(AST_node* decl_node)
 
 void ast_ntype_decls_node_insert(AST_node* ntype_decls_node, AST_node* ntype_decl_node)
 {
-    LL_insert_back(((AST_ntype_decls_node*) ntype_decls_node) -> new_type_decls_list, ntype_decl_node); 
+    ast_list_insert(NODE_NEW_TYPE_DECLS, &((AST_ntype_decls_node*) ntype_decls_node) -> new_type_decls_list, ntype_decl_node); 
 }
 
 AST_node *ast_ntype_array_node_create(AST_node* id_node, size_t arr_size, AST_node* elem_type)
@@ -161,8 +222,8 @@ AST_node *ast_decls_node_create(AST_node* decl)
 {
     NODE_CREATE(node, AST_declarations_node, NODE_DECLARATIONS); 
 
-    node -> var_decls_list = LL_create_list(); 
-    node -> fun_decls_list = LL_create_list(); 
+    ast_list_init(&node -> var_decls_list); 
+    ast_list_init(&node -> fun_decls_list); 
     ast_decls_node_insert((AST_node*)node, decl); 
 
     return (AST_node*) node; 
@@ -171,9 +232,9 @@ AST_node *ast_decls_node_create(AST_node* decl)
 void ast_decls_node_insert(AST_node* decls, AST_node* decl)
 {
     if (decl -> type == NODE_VAR_DECLARATION)
-        LL_insert_back(((AST_declarations_node*) decls) -> var_decls_list, decl); 
+        ast_list_insert(NODE_DECLARATIONS, &((AST_declarations_node*) decls) -> var_decls_list, decl); 
     else 
-        LL_insert_back(((AST_declarations_node*) decls) -> fun_decls_list, decl); 
+        ast_list_insert(NODE_DECLARATIONS, &((AST_declarations_node*) decls) -> fun_decls_list, decl); 
 }
 
 AST_node *ast_var_decl_node_create(AST_node* id_type, AST_node* id_node)
@@ -182,6 +243,7 @@ AST_node *ast_var_decl_node_create(AST_node* id_type, AST_node* id_node)
 
     node -> id_type = id_type; 
     node -> id_node = id_node; 
+    node -> narrow_bits = 0; 
 
     return (AST_node*) node; 
 }
@@ -199,15 +261,15 @@ AST_node *ast_statements_node_create(AST_node* statement)
 {
     NODE_CREATE(node, AST_statements_node, NODE_STATEMENTS); 
     
-    node -> stmts_list = LL_create_list(); 
-    LL_insert_back(node -> stmts_list, statement); 
+    ast_list_init(&node -> stmts_list); 
+    ast_list_insert(NODE_STATEMENTS, &node -> stmts_list, statement); 
     
     return (AST_node*) node; 
 }
 
 void ast_statements_node_insert(AST_node* statements, AST_node* statement)
 {
-    LL_insert_back(((AST_statements_node*) statements) -> stmts_list, statement); 
+    ast_list_insert(NODE_STATEMENTS, &((AST_statements_node*) statements) -> stmts_list, statement); 
 }
 
 AST_node *ast_assign_node_create(AST_node* dest, AST_node* assign_exp)
@@ -232,18 +294,33 @@ AST_node *ast_if_node_create(AST_node* cond, AST_node* action, AST_node* elif, A
     return (AST_node*) node; 
 }
 
+void ast_if_node_add_elif(AST_node* if_node, AST_node* branch)
+{
+    AST_if_node* node = (AST_if_node*) if_node; 
+
+    if (node -> elif_branches == NULL)
+        node -> elif_branches = ast_elif_node_create(branch); 
+    else 
+        ast_elif_node_insert(node -> elif_branches, branch); 
+}
+
+void ast_if_node_set_else(AST_node* if_node, AST_node* else_branch)
+{
+    ((AST_if_node*) if_node) -> else_action = else_branch; 
+}
+
 AST_node *ast_elif_node_create(AST_node* branch)
 {
     NODE_CREATE(node, AST_elif_node, NODE_ELIF); 
 
-    node -> branches_list = LL_create_list(); 
-    LL_insert_back(node -> branches_list, branch); 
+    ast_list_init(&node -> branches_list); 
+    ast_list_insert(NODE_ELIF, &node -> branches_list, branch); 
 
     return (AST_node*) node; 
 }
 void ast_elif_node_insert(AST_node* elif_node, AST_node* branch)
 {
-    LL_insert_back(((AST_elif_node*) elif_node) -> branches_list, branch); 
+    ast_list_insert(NODE_ELIF, &((AST_elif_node*) elif_node) -> branches_list, branch); 
 }
 
 AST_node *ast_branch_node_create(AST_node* cond, AST_node* action)
@@ -305,6 +382,14 @@ AST_node *ast_print_node_create(AST_node* args)
     return (AST_node*) node; 
 }
 
+AST_node *ast_read_node_create(AST_node* args)
+{
+    NODE_CREATE(node, AST_read_node, NODE_READ); 
+
+    node->args = args; 
+    return (AST_node*) node; 
+}
+
 Type* ast_exp_type(AST_node* exp_node)
 {
     if (exp_node == NULL)
@@ -345,8 +430,7 @@ Type* ast_exp_type(AST_node* exp_node)
                 return node->elem_type; 
             }
         default: 
-            fprintf(stderr,"Error : ast node is not an expression\n"); 
-            exit(3);
+            error_fatal(3, "Error : ast node is not an expression\n");
     }
 
     return VAL_ERR;  
@@ -357,6 +441,7 @@ AST_node *ast_op_node_create(Op_type op_type, AST_node* lhs, AST_node* rhs)
     NODE_CREATE(node, AST_op_node, NODE_OP); 
 
     node -> res_type = NULL;  
+    node -> operand_type = NULL;  
     node -> op_type = op_type; 
     node -> lhs = lhs; 
     node -> rhs = rhs; 
@@ -374,12 +459,12 @@ AST_node *ast_const_node_create(Value_type val_type, Const_value val)
     return (AST_node*) node; 
 }
 
-AST_node *ast_id_node_create(char* id_str)
+AST_node *ast_id_node_create(Symbol id)
 {
     NODE_CREATE(node, AST_id_node, NODE_ID); 
 
     node -> id_type = NULL; 
-    node -> id_str = id_str; 
+    node -> id = id; 
 
     return (AST_node*) node;  
 }
@@ -388,6 +473,7 @@ AST_node *ast_call_node_create(AST_node* id_node, AST_node* args)
 {
     NODE_CREATE(node, AST_call_node, NODE_CALL); 
 
+    node -> callee = NULL; 
     node -> id_node = id_node; 
     node -> args = args; 
 
@@ -415,228 +501,6 @@ AST_node *ast_mat_sub_create(AST_node* id_node, AST_node* exp_row, AST_node* exp
     return (AST_node*) node; 
 }
 
-void AST_tree_free(void* tree)
-{
-    AST_node* root_node = (AST_node*) tree; 
-    if (!root_node)
-        return; 
-    switch (root_node -> type)    
-    {
-        case NODE_PROGRAM: 
-            {
-                AST_program_node* node = (AST_program_node*)root_node; 
-                AST_tree_free(node -> new_types); 
-                AST_tree_free(node -> subprograms); 
-                AST_tree_free(node -> statements); 
-                AST_tree_free(node -> declarations); 
-            }
-            break; 
-        case NODE_SUBPROGRAMS: 
-            {
-                AST_subprograms_node* node = (AST_subprograms_node*)root_node; 
-                LL_free_list(&node->functions_list, AST_tree_free); 
-            }
-            break; 
-        case NODE_FUNCTION: 
-            {
-                AST_function_node* node = (AST_function_node*)root_node; 
-                AST_tree_free(node->id_node); 
-                AST_tree_free(node->params); 
-                AST_tree_free(node->declarations); 
-                AST_tree_free(node->statements); 
-                AST_tree_free(node->ret_type); 
-            }
-            break; 
-        case NODE_PARAMS: 
-            {
-                AST_params_node* node = (AST_params_node*)root_node; 
-                LL_free_list(&node->params_list, AST_tree_free); 
-            }
-            break; 
-        case NODE_PARAM: 
-            {
-                AST_param_node* node = (AST_param_node*)root_node; 
-                AST_tree_free(node->id_node); 
-                AST_tree_free(node->id_type); 
-            }
-            break; 
-        case NODE_ARGS: 
-            {
-                AST_args_node* node = (AST_args_node*)root_node; 
-                LL_free_list(&node->args_list, AST_tree_free); 
-            }
-            break; 
-        case NODE_ARG: 
-            {
-                AST_arg_node* node = (AST_arg_node*)root_node; 
-                AST_tree_free(node->exp); 
-            }
-            break; 
-        case NODE_TYPE: 
-            {
-                AST_type_node* node = (AST_type_node*)root_node; 
-                free(node->id); 
-            }
-            break; 
-        case NODE_NEW_TYPE_DECLS: 
-            {
-                AST_ntype_decls_node* node = (AST_ntype_decls_node*)root_node; 
-                LL_free_list(&node->new_type_decls_list, AST_tree_free); 
-            }
-            break; 
-        case NODE_ARRAY_TYPE_DECL: 
-            {
-                AST_array_type_decl_node* node = (AST_array_type_decl_node*)root_node; 
-                AST_tree_free(node->id_node); 
-                AST_tree_free(node->element_type); 
-            }
-            break; 
-        case NODE_MATRIX_TYPE_DECL: 
-            {
-                AST_matrix_type_decl_node* node = (AST_matrix_type_decl_node*)root_node; 
-                AST_tree_free(node->id_node); 
-                AST_tree_free(node->element_type); 
-            }
-            break; 
-        case NODE_DECLARATIONS: 
-            {
-                AST_declarations_node* node = (AST_declarations_node*)root_node; 
-                LL_free_list(&node -> var_decls_list, AST_tree_free); 
-                LL_free_list(&node -> fun_decls_list, AST_tree_free); 
-            }
-            break; 
-        case NODE_VAR_DECLARATION: 
-            {
-                AST_var_declaration_node* node = (AST_var_declaration_node*)root_node; 
-                AST_tree_free(node -> id_node);
-                AST_tree_free(node -> id_type); 
-            }
-            break; 
-        case NODE_FUN_DECLARATION: 
-            {
-                AST_fun_declaration_node* node = (AST_fun_declaration_node*)root_node; 
-                AST_tree_free(node -> id_node);
-            }
-            break; 
-        case NODE_STATEMENTS: 
-            {
-                AST_statements_node* node = (AST_statements_node*)root_node; 
-                LL_free_list(&node -> stmts_list, AST_tree_free); 
-            }
-            break; 
-        case NODE_ASSIGN: 
-            {
-                AST_assign_node* node = (AST_assign_node*)root_node; 
-                AST_tree_free(node -> dest); 
-                AST_tree_free(node -> assign_exp); 
-            }
-            break; 
-        case NODE_IF: 
-            {
-                AST_if_node* node = (AST_if_node*)root_node; 
-                AST_tree_free(node -> cond); 
-                AST_tree_free(node -> action); 
-                AST_tree_free(node -> elif_branches); 
-                AST_tree_free(node -> else_action); 
-            }
-            break; 
-        case NODE_ELIF: 
-            {
-                AST_elif_node* node = (AST_elif_node*)root_node; 
-                LL_free_list(&node -> branches_list, AST_tree_free) ; 
-            }
-            break; 
-        case NODE_BRANCH: 
-            {
-                AST_branch_node* node = (AST_branch_node*)root_node; 
-                AST_tree_free(node -> cond); 
-                AST_tree_free(node -> action); 
-            }
-            break;  
-        case NODE_FOR: 
-            {
-                AST_for_node* node = (AST_for_node*)root_node; 
-                AST_tree_free(node -> iter); 
-                AST_tree_free(node -> from); 
-                AST_tree_free(node -> to); 
-                AST_tree_free(node -> statements); 
-            }
-            break; 
-        case NODE_WHILE: 
-            {
-                AST_while_node* node = (AST_while_node*)root_node; 
-                AST_tree_free(node -> cond); 
-                AST_tree_free(node -> statements); 
-            }
-            break; 
-        case NODE_DOWHILE: 
-            {
-                AST_dowhile_node* node = (AST_dowhile_node*)root_node; 
-                AST_tree_free(node -> cond); 
-                AST_tree_free(node -> statements); 
-            }
-            break; 
-        case NODE_RETURN: 
-            {
-                AST_return_node* node = (AST_return_node*)root_node; 
-                AST_tree_free(node -> exp); 
-            }
-            break; 
-        case NODE_PRINT: 
-            {
-                AST_print_node* node = (AST_print_node*)root_node; 
-                AST_tree_free(node->args); 
-            }
-            break; 
-        case NODE_OP: 
-            {
-                AST_op_node* node = (AST_op_node*)root_node; 
-                AST_tree_free(node -> lhs); 
-                AST_tree_free(node -> rhs); 
-            }
-            break; 
-        case NODE_CONST: 
-            {
-                //do nothing; 
-            } 
-            break; 
-        case NODE_ID: 
-            {
-                AST_id_node* node = (AST_id_node*)root_node; 
-                free(node -> id_str); 
-            }
-            break; 
-        case NODE_CALL: 
-            {
-                AST_call_node* node = (AST_call_node*)root_node; 
-                AST_tree_free(node->id_node); 
-                AST_tree_free(node->args); 
-            }
-            break; 
-        case NODE_ARR_SUB: 
-            {
-                AST_arr_sub_node* node = (AST_arr_sub_node*)root_node; 
-                AST_tree_free(node->id_node); 
-                AST_tree_free(node->exp); 
-            }
-            break; 
-        case NODE_MAT_SUB: 
-            {
-                AST_mat_sub_node* node = (AST_mat_sub_node*)root_node; 
-                AST_tree_free(node->id_node); 
-                AST_tree_free(node->exp[0]); 
-                AST_tree_free(node->exp[1]); 
-            }
-            break; 
-        default: 
-            fprintf(stderr, "Error bad node %d\n", root_node -> type); 
-            break; 
-        
-    }
-
-    free(root_node); 
-}
-
 static void printd(int depth, char* format, ...)
 {
     va_list args; 
@@ -668,9 +532,9 @@ void AST_tree_print(AST_node* root_node, int depth)
             {
                 AST_subprograms_node* node= (AST_subprograms_node*)root_node; 
                 printd(depth, "multiple subprograms : \n"); 
-                for (LL_Node* head = node->functions_list->head;head;head = head->next)
+                VEC_FOR_EACH(&node->functions_list, function)
                 {
-                    AST_tree_print((AST_node*)head->data, depth+1); 
+                    AST_tree_print((AST_node*)function, depth+1); 
                 }
             }
             break; 
@@ -687,11 +551,9 @@ void AST_tree_print(AST_node* root_node, int depth)
             {
                 AST_declarations_node* node = (AST_declarations_node*)root_node; 
                 printd(depth, "multiple definitions : \n"); 
-                LL_Node* head = node -> var_decls_list -> head; 
-                while (head != NULL)
+                VEC_FOR_EACH(&node -> var_decls_list, item)
                 {
-                    AST_tree_print((AST_node*) head -> data, depth + 1); 
-                    head = head -> next; 
+                    AST_tree_print((AST_node*) item, depth + 1); 
                 }
             }
             break; 
@@ -706,11 +568,9 @@ void AST_tree_print(AST_node* root_node, int depth)
             {
                 AST_statements_node* node = (AST_statements_node*)root_node; 
                 printd(depth, "multiples statements nodes : \n"); 
-                LL_Node* head = node -> stmts_list -> head; 
-                while (head != NULL)
+                VEC_FOR_EACH(&node -> stmts_list, item)
                 {
-                    AST_tree_print((AST_node*) head -> data, depth + 1); 
-                    head = head -> next; 
+                    AST_tree_print((AST_node*) item, depth + 1); 
                 }
             }
             break; 
@@ -739,11 +599,9 @@ void AST_tree_print(AST_node* root_node, int depth)
             {
                 AST_elif_node* node = (AST_elif_node*)root_node; 
                 printd(depth, "multiples elif branches : \n"); 
-                LL_Node* head = node -> branches_list -> head; 
-                while (head != NULL)
+                VEC_FOR_EACH(&node -> branches_list, item)
                 {
-                    AST_tree_print((AST_node*) head -> data, depth + 1); 
-                    head = head -> next; 
+                    AST_tree_print((AST_node*) item, depth + 1); 
                 }
             }
             break; 
@@ -848,7 +706,7 @@ void AST_tree_print(AST_node* root_node, int depth)
         case NODE_ID: 
             {
                 AST_id_node* node = (AST_id_node*)root_node; 
-                printd(depth, "id node : %s\n", node -> id_str); 
+                printd(depth, "id node : %s\n", symbol_name(node -> id)); 
             }
             break; 
         default:      
@@ -7,7 +7,9 @@
 #include <stdio.h> 
 
 #include "types.h"
-#include "linkedlist.h"
+#include "vector.h"
+#include "arena.h"
+#include "intern.h"
 
 
 typedef enum Node_type_e {
@@ -39,6 +41,7 @@ typedef enum Node_type_e {
     NODE_DOWHILE, 
     NODE_RETURN, 
     NODE_PRINT, 
+    NODE_READ, 
     //expressions
     NODE_OP, 
     NODE_CONST,  
@@ -47,6 +50,7 @@ typedef enum Node_type_e {
     NODE_ARR_SUB, 
     NODE_MAT_SUB, 
 
+    NODE_TYPE_NB, /* not a node, number of node kinds */ 
 } Node_type; 
 
 typedef enum AST_type_kind_e {
@@ -72,9 +76,16 @@ typedef struct AST_program_node_s { /*main program node*/
 typedef struct AST_subprograms_node_s {
     Node_type type;  
 
-    Linkedlist* functions_list; 
+    Vector functions_list; 
 } AST_subprograms_node; 
 
+/* what a function may touch besides its own frame, see effects.c */ 
+typedef enum Fn_effect_e {
+    EFFECT_PURE,     /* its result only depends on its arguments */ 
+    EFFECT_READONLY, /* reads memory it doesn't own */ 
+    EFFECT_ANY,      /* writes memory or prints */ 
+} Fn_effect; 
+
 typedef struct AST_function_node_s {
     Node_type type; 
 
@@ -83,12 +94,16 @@ typedef struct AST_function_node_s {
     AST_node* params; 
     AST_node* declarations; 
     AST_node* statements; 
+    bool evaluable; /* can run at compile time, see ctfe.c */ 
+    Fn_effect effect; 
+    bool norecurse;  /* never reached again while it runs */ 
+    bool willreturn; /* every call returns */ 
 } AST_function_node; 
 
 typedef struct AST_params_node_s {
     Node_type type; 
     
-    Linkedlist* params_list; 
+    Vector params_list; 
 } AST_params_node; 
 
 typedef struct AST_param_node_s {
@@ -101,7 +116,7 @@ typedef struct AST_param_node_s {
 typedef struct AST_args_node_s {
     Node_type type; 
 
-    Linkedlist* args_list; 
+    Vector args_list; 
 } AST_args_node; 
 
 typedef struct AST_arg_node_s {
@@ -113,14 +128,14 @@ typedef struct AST_arg_node_s {
 typedef struct AST_type_node_s {
     Node_type type; 
     AST_type_kind type_kind; 
-    char* id;
+    Symbol id;
     Type* id_type; 
 } AST_type_node;
 
 typedef struct AST_ntype_decls_node_s {
     Node_type type; 
 
-    Linkedlist* new_type_decls_list; 
+    Vector new_type_decls_list; 
 } AST_ntype_decls_node; 
 
 typedef struct AST_array_type_decl_node_s {
@@ -142,8 +157,8 @@ typedef struct AST_matrix_type_decl_node_s {
 typedef struct AST_declarations_node_s {
     Node_type type; 
 
-    Linkedlist* var_decls_list; 
-    Linkedlist* fun_decls_list; 
+    Vector var_decls_list; 
+    Vector fun_decls_list; 
 } AST_declarations_node; 
 
 typedef struct AST_var_declaration_node_s {
@@ -151,6 +166,7 @@ typedef struct AST_var_declaration_node_s {
 
     AST_node* id_type;  
     AST_node* id_node; 
+    unsigned narrow_bits; /* width the integer elements are stored with, 0 keeps the type's, see ranges.c */ 
 } AST_var_declaration_node; 
 
 typedef struct AST_fun_declaration_node_s {
@@ -164,7 +180,7 @@ typedef struct AST_fun_declaration_node_s {
 typedef struct AST_statements_node_s {
     Node_type type; 
 
-    Linkedlist* stmts_list; 
+    Vector stmts_list; 
 } AST_statements_node; 
 
 typedef struct AST_assign_node_s {
@@ -186,7 +202,7 @@ typedef struct AST_if_node_s {
 typedef struct AST_elif_node_s {
     Node_type type; 
 
-    Linkedlist* branches_list; 
+    Vector branches_list; 
 } AST_elif_node; 
 
 typedef struct AST_branch_node_s {
@@ -231,11 +247,18 @@ typedef struct AST_print_node_s {
     AST_node* args; 
 } AST_print_node; 
 
+typedef struct AST_read_node_s {
+    Node_type type; 
+
+    AST_node* args; /* the arguments are lvalues */ 
+} AST_read_node; 
+
 typedef struct AST_op_nodes_s {
     Node_type type; 
 
     Op_type op_type; 
     Type* res_type; /*This will be populated during type resolution*/ 
+    Type* operand_type; /* both operands are promoted to it, filled with res_type */ 
     AST_node* lhs; 
     AST_node* rhs; 
 } AST_op_node; 
@@ -250,7 +273,7 @@ typedef struct AST_const_s {
 typedef struct AST_id_node_s {
     Node_type type;  
 
-    char* id_str;  
+    Symbol id;  
     Type* id_type; /*This will be populated during type resolution*/ 
 } AST_id_node; 
 
@@ -259,6 +282,7 @@ typedef struct AST_call_node_s {
 
     Type* fun_type; /* will be filled during type resolution */  
     Type* ret_type; /* will be filled during type resolution */  
+    AST_node* callee; /* the function node, NULL for a builtin, filled during type resolution */ 
     AST_node* id_node; 
     AST_node* args; 
 } AST_call_node; 
@@ -294,7 +318,7 @@ AST_node *ast_arg_create(AST_node* exp);
 
 //new types 
 AST_node *ast_type_create_from_type(Type* type); 
-AST_node *ast_type_create_from_name(char* name); 
+AST_node *ast_type_create_from_name(Symbol name); 
 AST_node *ast_ntype_decls_node_create(AST_node* ntype_decl_node); 
 void ast_ntype_decls_node_insert(AST_node* ntype_decls_node, AST_node* ntype_decl_node); 
 AST_node *ast_ntype_array_node_create(AST_node* id_node, size_t arr_size, AST_node* elem_type);
@@ -311,6 +335,8 @@ AST_node *ast_statements_node_create(AST_node* statement);
 void ast_statements_node_insert(AST_node* statements, AST_node* statement); 
 AST_node *ast_assign_node_create(AST_node* dest, AST_node* assign_val); 
 AST_node *ast_if_node_create(AST_node* cond, AST_node* action, AST_node* elif, AST_node* else_branch); 
+void ast_if_node_add_elif(AST_node* if_node, AST_node* branch); 
+void ast_if_node_set_else(AST_node* if_node, AST_node* else_branch); 
 AST_node *ast_elif_node_create(AST_node* branch); 
 void ast_elif_node_insert(AST_node* elif_node, AST_node* branch); 
 AST_node *ast_branch_node_create(AST_node* cond, AST_node* action);
@@ -319,6 +345,7 @@ AST_node *ast_while_node_create(AST_node* cond, AST_node* stmts);
 AST_node *ast_dowhile_node_create(AST_node* cond, AST_node* stmts); 
 AST_node *ast_return_node_create(AST_node* exp); 
 AST_node *ast_print_node_create(AST_node* args); 
+AST_node *ast_read_node_create(AST_node* args); 
 
 
 //expressions
@@ -327,12 +354,16 @@ AST_node *ast_print_node_create(AST_node* args);
 Type* ast_exp_type(AST_node* exp_node); 
 AST_node *ast_op_node_create(Op_type otype, AST_node* lhs, AST_node* rhs); 
 AST_node *ast_const_node_create(Value_type val_type, Const_value val);  
-AST_node *ast_id_node_create(char* id_str); 
+AST_node *ast_id_node_create(Symbol id); 
 AST_node *ast_call_node_create(AST_node* id_node, AST_node* args); 
 AST_node *ast_arr_sub_create(AST_node* id_node, AST_node* exp); 
 AST_node *ast_mat_sub_create(AST_node* id_node, AST_node* exp_row, AST_node* exp_col); 
 
-void AST_tree_free(void* tree);
+/* every node and list is allocated in the ast arena of the calling thread */ 
+/* frees the whole tree at once */ 
+void AST_arena_release(void);
+/* bytes used by each node kind */ 
+void AST_stats_print(FILE* out); 
 
 //debug
 void AST_tree_print(AST_node* root_node, int depth); 
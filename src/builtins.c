@@ -1,146 +1,224 @@
+#include <limits.h>
+#include <math.h>
+
 #include "builtins.h"
 
-#define BUILTINS_NB 3
+static LLVMValueRef emit_ord(LLVMBuilderRef builder, LLVMValueRef* args); 
+static LLVMValueRef emit_chr(LLVMBuilderRef builder, LLVMValueRef* args); 
+static LLVMValueRef emit_ent(LLVMBuilderRef builder, LLVMValueRef* args); 
+static LLVMValueRef emit_abs(LLVMBuilderRef builder, LLVMValueRef* args); 
+
+static bool eval_ord(const Const_value* args, Const_value* out); 
+static bool eval_chr(const Const_value* args, Const_value* out); 
+static bool eval_ent(const Const_value* args, Const_value* out); 
+static bool eval_abs(const Const_value* args, Const_value* out); 
+static bool eval_min(const Const_value* args, Const_value* out); 
+static bool eval_max(const Const_value* args, Const_value* out); 
+static bool eval_fabs(const Const_value* args, Const_value* out); 
+static bool eval_fmin(const Const_value* args, Const_value* out); 
+static bool eval_fmax(const Const_value* args, Const_value* out); 
+static bool eval_sqrt(const Const_value* args, Const_value* out); 
+static bool eval_floor(const Const_value* args, Const_value* out); 
+static bool eval_ceil(const Const_value* args, Const_value* out); 
+
+/* the code of a character */ 
+static const Builtin_range range_char = {0, UCHAR_MAX}; 
+
+/* a new builtin is one more line, overloads differ by their parameters */ 
+static const Builtin_prototype builtins[] = {
+    {"ord",   TYPE_INT,   {TYPE_CHAR}, 1, NULL, emit_ord, eval_ord, &range_char},
+    {"chr",   TYPE_CHAR,  {TYPE_INT}, 1, NULL, emit_chr, eval_chr, NULL},
+    {"ent",   TYPE_INT,   {TYPE_FLOAT}, 1, NULL, emit_ent, eval_ent, NULL},
+    {"abs",   TYPE_INT,   {TYPE_INT}, 1, NULL, emit_abs, eval_abs, NULL},
+    {"min",   TYPE_INT,   {TYPE_INT, TYPE_INT}, 2, "llvm.smin", NULL, eval_min, NULL},
+    {"max",   TYPE_INT,   {TYPE_INT, TYPE_INT}, 2, "llvm.smax", NULL, eval_max, NULL},
+    {"abs",   TYPE_FLOAT, {TYPE_FLOAT}, 1, "llvm.fabs", NULL, eval_fabs, NULL},
+    {"min",   TYPE_FLOAT, {TYPE_FLOAT, TYPE_FLOAT}, 2, "llvm.minnum", NULL, eval_fmin, NULL},
+    {"max",   TYPE_FLOAT, {TYPE_FLOAT, TYPE_FLOAT}, 2, "llvm.maxnum", NULL, eval_fmax, NULL},
+    {"sqrt",  TYPE_FLOAT, {TYPE_FLOAT}, 1, "llvm.sqrt", NULL, eval_sqrt, NULL},
+    {"floor", TYPE_FLOAT, {TYPE_FLOAT}, 1, "llvm.floor", NULL, eval_floor, NULL},
+    {"ceil",  TYPE_FLOAT, {TYPE_FLOAT}, 1, "llvm.ceil", NULL, eval_ceil, NULL},
+    {"pow",   TYPE_FLOAT, {TYPE_FLOAT, TYPE_FLOAT}, 2, "llvm.pow", NULL, NULL, NULL},
+    {"sin",   TYPE_FLOAT, {TYPE_FLOAT}, 1, "llvm.sin", NULL, NULL, NULL},
+    {"cos",   TYPE_FLOAT, {TYPE_FLOAT}, 1, "llvm.cos", NULL, NULL, NULL},
+    {"exp",   TYPE_FLOAT, {TYPE_FLOAT}, 1, "llvm.exp", NULL, NULL, NULL},
+    {"log",   TYPE_FLOAT, {TYPE_FLOAT}, 1, "llvm.log", NULL, NULL, NULL},
+}; 
 
-Builtin_fn builtins[BUILTINS_NB];
-size_t builtins_count = 0;
+#define BUILTINS_COUNT (sizeof(builtins) / sizeof(builtins[0]))
 
-static void implement_ord(LLVMValueRef fn); 
-static void implement_chr(LLVMValueRef fn) ; 
-static void implement_ent(LLVMValueRef fn) ; 
-static void builtin_register(Builtin_fn fn); 
-static Builtin_fn builtin_build(LLVMModuleRef module, Builtin_prototype* prototype); 
+/* the names as symbols of the pool the thread uses, interned by
+ * builtins_declare or found on the first call of a thread it's lent to */ 
+static _Thread_local Intern_pool* names_pool = NULL; 
+static _Thread_local Symbol names[BUILTINS_COUNT]; 
 
-Builtin_prototype prototypes[BUILTINS_NB] = {
-    {
-        "ord", 
-        TYPE_INT, 
-        (Type*[]){TYPE_CHAR}, 
-        1,
-        implement_ord, 
-    }, 
-    {
-        "chr", 
-        TYPE_CHAR, 
-        (Type*[]){TYPE_INT}, 
-        1,
-        implement_chr, 
-    }, 
+static const Symbol* builtin_names(void)
+{
+    Intern_pool* current = intern_pool_current(); 
+    if (names_pool != current)
     {
-        "ent", 
-        TYPE_INT, 
-        (Type*[]){TYPE_FLOAT}, 
-        1,
-        implement_ent, 
-    }, 
-}; 
+        for (size_t i = 0; i < BUILTINS_COUNT; i++)
+            names[i] = intern_find(builtins[i].name); 
+        names_pool = current; 
+    }
+    return names; 
+}
 
-void builtins_init(LLVMModuleRef module)
-{    
-    for (int i = 0; i < BUILTINS_NB; i++)
+void builtins_declare(Symbol_table* sym_tab)
+{
+    for (size_t i = 0; i < BUILTINS_COUNT; i++)
     {
-
-        Builtin_fn builtin = builtin_build(module, &prototypes[i]); 
-        builtin_register(builtin); 
+        const Builtin_prototype* prot = &builtins[i]; 
+        Type* fun_type = type_function_create(prot->ret_type, (Type**)prot->params_type, prot->params_count); 
+        names[i] = intern(prot->name); 
+        st_insert_fun(sym_tab, names[i], fun_type, NULL, NULL); 
     }
+    /* the pool of a new compilation may reuse the address of the last one */ 
+    names_pool = intern_pool_current(); 
 }
 
-void builtins_add_to_symtab(Symbol_table* sym_tab)
+const Builtin_prototype* builtins_find(Symbol name, Type** params_type, size_t params_count)
 {
-    for (size_t i = 0; i < builtins_count; i++)
+    const Symbol* symbols = builtin_names(); 
+    for (size_t i = 0; i < BUILTINS_COUNT; i++)
     {
-        Builtin_fn builtin = builtins[i]; 
-        st_insert_fun(sym_tab, builtin.name, builtin.type, builtin.fun_ref, builtin.fun_type); 
+        const Builtin_prototype* prot = &builtins[i]; 
+        if (prot->params_count != params_count || symbols[i] != name)
+            continue; 
+        size_t param = 0; 
+        while (param < params_count && type_equal(prot->params_type[param], params_type[param]))
+            param++; 
+        if (param == params_count)
+            return prot; 
     }
+    return NULL; 
 }
 
-static void builtin_register(Builtin_fn fn)
+static LLVMValueRef call_intrinsic(LLVMBuilderRef builder, const char* name, LLVMValueRef* args, unsigned args_count)
 {
-    assert(builtins_count < BUILTINS_NB);
-    builtins[builtins_count++] = fn; 
+    LLVMModuleRef module = LLVMGetGlobalParent(LLVMGetBasicBlockParent(LLVMGetInsertBlock(builder))); 
+    unsigned id = LLVMLookupIntrinsicID(name, strlen(name)); 
+    assert(id != 0); 
+    /* the math intrinsics are overloaded on their operand type */ 
+    LLVMTypeRef overload = LLVMTypeOf(args[0]); 
+    LLVMValueRef fn = LLVMGetIntrinsicDeclaration(module, id, &overload, 1); 
+    return LLVMBuildCall2(builder, LLVMGlobalGetValueType(fn), fn, args, args_count, ""); 
 }
 
-static Builtin_fn builtin_build(LLVMModuleRef module, Builtin_prototype* prot)
+LLVMValueRef builtins_emit(LLVMBuilderRef builder, const Builtin_prototype* builtin, LLVMValueRef* args)
 {
-    LLVMTypeRef llvm_ret_type = type_to_llvm_type(prot->ret_type); 
-    LLVMTypeRef* llvm_params_type = NULL; 
-    if (prot->params_count > 0)
-        llvm_params_type = malloc(prot->params_count * sizeof(LLVMTypeRef)); 
-    for (size_t i = 0; i < prot->params_count; i++)
-    {
-        llvm_params_type[i] = type_to_llvm_type(prot->params_type[i]); 
-    }
+    if (builtin->emit)
+        return builtin->emit(builder, args); 
+    return call_intrinsic(builder, builtin->intrinsic, args, builtin->params_count); 
+}
+
+bool builtins_eval(const Builtin_prototype* builtin, const Const_value* args, Const_value* out)
+{
+    return builtin->eval && builtin->eval(args, out); 
+}
 
-    LLVMTypeRef llvm_fun_type = LLVMFunctionType(llvm_ret_type, llvm_params_type, prot->params_count, 0); 
-    LLVMValueRef llvm_fun_ref = LLVMAddFunction(module, prot->name, llvm_fun_type); 
+static inline LLVMContextRef builder_context(LLVMBuilderRef builder)
+{
+    return LLVMGetTypeContext(LLVMTypeOf(LLVMGetBasicBlockParent(LLVMGetInsertBlock(builder)))); 
+}
+
+/* ord (returns the ascii code of a char) */ 
+static LLVMValueRef emit_ord(LLVMBuilderRef builder, LLVMValueRef* args)
+{
+    return LLVMBuildZExt(builder, args[0], LLVMInt32TypeInContext(builder_context(builder)), "ord_result"); 
+}
 
-    Type* fun_type = type_function_create(prot->ret_type, prot->params_type, prot->params_count); 
-    //clean up 
-    free(llvm_params_type); 
+/* chr (returns the char of an ascii code) */ 
+static LLVMValueRef emit_chr(LLVMBuilderRef builder, LLVMValueRef* args)
+{
+    return LLVMBuildTrunc(builder, args[0], LLVMInt8TypeInContext(builder_context(builder)), "chr_result"); 
+}
 
-    /* implement */ 
-    prot->implement(llvm_fun_ref); 
+/* ent (float to int, towards zero) */ 
+static LLVMValueRef emit_ent(LLVMBuilderRef builder, LLVMValueRef* args)
+{
+    return LLVMBuildFPToSI(builder, args[0], LLVMInt32TypeInContext(builder_context(builder)), "ent_result"); 
+}
 
-    return (Builtin_fn){
-        prot->name, 
-        fun_type, 
-        llvm_fun_ref, 
-        llvm_fun_type, 
-    }; 
+/* abs of the smallest integer is itself, not poison */ 
+static LLVMValueRef emit_abs(LLVMBuilderRef builder, LLVMValueRef* args)
+{
+    LLVMValueRef abs_args[] = {args[0], LLVMConstInt(LLVMInt1TypeInContext(builder_context(builder)), 0, false)}; 
+    return call_intrinsic(builder, "llvm.abs", abs_args, 2); 
 }
 
-static inline LLVMBuilderRef create_fn_builder(LLVMValueRef fn)
+static bool eval_ord(const Const_value* args, Const_value* out)
 {
-    LLVMBuilderRef builder = LLVMCreateBuilder();
+    out->ival = (unsigned char)args[0].cval; 
+    return true; 
+}
 
-    LLVMBasicBlockRef entry = LLVMAppendBasicBlock(fn, "entry");
-    LLVMPositionBuilderAtEnd(builder, entry);
-    return builder; 
+static bool eval_chr(const Const_value* args, Const_value* out)
+{
+    out->cval = (char)args[0].ival; 
+    return true; 
 }
 
-/* each function will have it's own builder to avoid interference with main code */ 
+static bool eval_ent(const Const_value* args, Const_value* out)
+{
+    /* fptosi of a value out of range is poison */ 
+    if (isnan(args[0].fval) || args[0].fval <= (float)INT_MIN - 1.0f || args[0].fval >= (float)INT_MAX)
+        return false; 
+    out->ival = (int)args[0].fval; 
+    return true; 
+}
 
-/* ord function (returns ascii integer from char)
- * args (char)
- * return int
- */
-static void implement_ord(LLVMValueRef fn) 
+static bool eval_abs(const Const_value* args, Const_value* out)
 {
-    LLVMBuilderRef builder = create_fn_builder(fn);
+    out->ival = args[0].ival < 0 ? (int)(0u - (unsigned)args[0].ival) : args[0].ival; 
+    return true; 
+}
 
-    LLVMValueRef arg = LLVMGetParam(fn, 0);
-    LLVMValueRef result = LLVMBuildZExt(builder, arg, LLVMInt32Type(), "ord_result");
-    LLVMBuildRet(builder, result);
+static bool eval_min(const Const_value* args, Const_value* out)
+{
+    out->ival = args[0].ival < args[1].ival ? args[0].ival : args[1].ival; 
+    return true; 
+}
 
-    LLVMDisposeBuilder(builder);
+static bool eval_max(const Const_value* args, Const_value* out)
+{
+    out->ival = args[0].ival > args[1].ival ? args[0].ival : args[1].ival; 
+    return true; 
 }
 
-/* chr function (returns character from ascii integer) 
- * args (int)
- * return char
- */
-static void implement_chr(LLVMValueRef fn) 
+/* the float ones are exact, the same as the instructions */ 
+static bool eval_fabs(const Const_value* args, Const_value* out)
 {
-    LLVMBuilderRef builder = create_fn_builder(fn);
+    out->fval = fabsf(args[0].fval); 
+    return true; 
+}
 
-    LLVMValueRef arg = LLVMGetParam(fn, 0);
-    LLVMValueRef result = LLVMBuildTrunc(builder, arg, LLVMInt8Type(), "chr_result"); 
-    LLVMBuildRet(builder, result); 
+static bool eval_fmin(const Const_value* args, Const_value* out)
+{
+    out->fval = fminf(args[0].fval, args[1].fval); 
+    return true; 
+}
 
-    LLVMDisposeBuilder(builder);
+static bool eval_fmax(const Const_value* args, Const_value* out)
+{
+    out->fval = fmaxf(args[0].fval, args[1].fval); 
+    return true; 
 }
 
-/* ent function (float to int)
- * args (float)
- * return int 
- */
-static void implement_ent(LLVMValueRef fn) 
+static bool eval_sqrt(const Const_value* args, Const_value* out)
 {
-    LLVMBuilderRef builder = create_fn_builder(fn);
+    out->fval = sqrtf(args[0].fval); 
+    return true; 
+}
 
-    LLVMValueRef arg = LLVMGetParam(fn, 0);
-    LLVMValueRef result = LLVMBuildFPToSI(builder, arg, LLVMInt32Type(), "ent_result"); 
-    LLVMBuildRet(builder, result); 
+static bool eval_floor(const Const_value* args, Const_value* out)
+{
+    out->fval = floorf(args[0].fval); 
+    return true; 
+}
 
-    LLVMDisposeBuilder(builder);
+static bool eval_ceil(const Const_value* args, Const_value* out)
+{
+    out->fval = ceilf(args[0].fval); 
+    return true; 
 }
@@ -6,25 +6,36 @@
 
 #include "symboltable.h"
 
+#define BUILTIN_PARAMS_MAX 2
+
+typedef struct Builtin_range_s {
+    int lo; 
+    int hi; 
+} Builtin_range; 
+
+/* a builtin is either an llvm intrinsic overloaded on its first argument's
+ * type or a few instructions built by emit. both are generated inline at
+ * the call, nothing is added to the module but the intrinsic declarations */ 
 typedef struct Builtin_prototype_s {
     const char* name;   
     Type* ret_type; 
-    Type** params_type; 
+    Type* params_type[BUILTIN_PARAMS_MAX]; 
     size_t params_count; 
-    void (*implement)(LLVMValueRef fn); 
+    const char* intrinsic; 
+    LLVMValueRef (*emit)(LLVMBuilderRef builder, LLVMValueRef* args); 
+    /* the value of a call with constant arguments, false if it has none.
+     * NULL when the result would depend on the libm */ 
+    bool (*eval)(const Const_value* args, Const_value* out); 
+    /* the values of an integer result, NULL when it can be any */ 
+    const Builtin_range* ret_range; 
 } Builtin_prototype; 
 
-typedef struct Builtin_fn_s {
-    const char* name; 
-    Type* type; /* function type */ 
-    
-    /* llvm */ 
-    LLVMValueRef fun_ref;  
-    LLVMTypeRef fun_type;  
-
-} Builtin_fn; 
-
-void builtins_init(LLVMModuleRef module); 
-void builtins_add_to_symtab(Symbol_table* sym_tab); 
+/* declares the builtins in sym_tab, for the semantic pass */ 
+void builtins_declare(Symbol_table* sym_tab); 
+/* the builtin a call without a callee resolved to */ 
+const Builtin_prototype* builtins_find(Symbol name, Type** params_type, size_t params_count); 
+/* the builtin's code at the builder's position */ 
+LLVMValueRef builtins_emit(LLVMBuilderRef builder, const Builtin_prototype* builtin, LLVMValueRef* args); 
+bool builtins_eval(const Builtin_prototype* builtin, const Const_value* args, Const_value* out); 
 
 #endif
@@ -0,0 +1,267 @@
+#include "cache.h"
+
+#include <stdio.h> 
+#include <stdlib.h> 
+#include <string.h> 
+#include <errno.h> 
+#include <fcntl.h> 
+#include <unistd.h> 
+#include <dirent.h> 
+#include <time.h> 
+#include <sys/stat.h> 
+
+/* set by the makefile to a hash of the sources, the build is part of the version: 
+ * objects of another compiler are never loaded. a compiler built without it has no cache */ 
+#ifndef FRASCAL_BUILD_ID
+#define FRASCAL_BUILD_ID ""
+#endif
+#define FRASCAL_VERSION "frascal 0.1 (" FRASCAL_BUILD_ID ")"
+
+#define CACHE_EXTENSION ".o"
+#define CACHE_TEMP_PREFIX "tmp-"
+#define CACHE_TEMP CACHE_TEMP_PREFIX "XXXXXX"
+#define CACHE_TEMP_STALE 60 /* seconds, a temporary file older than that was left by a killed run */ 
+#define FNV128_PRIME ((((unsigned __int128)1) << 88) + 0x13b)
+#define FNV128_OFFSET ((((unsigned __int128)0x6c62272e07bb0142ull) << 64) | 0x62b821756295c58dull)
+
+bool cache_available(void)
+{
+    return *FRASCAL_BUILD_ID != '\0'; 
+}
+
+void cache_hash_init(Cache_hash* hash)
+{
+    hash->state = FNV128_OFFSET; 
+    cache_hash_add_str(hash, FRASCAL_VERSION); 
+}
+
+void cache_hash_add(Cache_hash* hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = data; 
+    unsigned __int128 state = hash->state; 
+    for (size_t i = 0; i < size; i++)
+    {
+        state ^= bytes[i]; 
+        state *= FNV128_PRIME; 
+    }
+    hash->state = state; 
+}
+
+/* with its NUL, "ab" "c" and "a" "bc" hash differently */ 
+void cache_hash_add_str(Cache_hash* hash, const char* str)
+{
+    cache_hash_add(hash, str, strlen(str) + 1); 
+}
+
+void cache_hash_key(const Cache_hash* hash, char key[CACHE_KEY_SIZE])
+{
+    snprintf(key, CACHE_KEY_SIZE, "%016llx%016llx",
+             (unsigned long long)(hash->state >> 64), (unsigned long long)hash->state); 
+}
+
+/* the cache directory, created if needed. NULL if there's none */ 
+static const char* cache_dir(void)
+{
+    static _Thread_local char path[4096]; 
+    const char* dir = getenv("FRASCAL_CACHE_DIR"); 
+    const char* base; 
+    int len; 
+    if (!cache_available())
+        return NULL; 
+    if (dir && *dir)
+        len = snprintf(path, sizeof(path), "%s", dir); 
+    else if ((base = getenv("XDG_CACHE_HOME")) && *base)
+        len = snprintf(path, sizeof(path), "%s/frascal", base); 
+    else if ((base = getenv("HOME")) && *base)
+    {
+        len = snprintf(path, sizeof(path), "%s/.cache", base); 
+        if (len > 0 && (size_t)len < sizeof(path))
+            mkdir(path, 0755); 
+        len = snprintf(path, sizeof(path), "%s/.cache/frascal", base); 
+    }
+    else
+        return NULL; 
+
+    if (len <= 0 || (size_t)len >= sizeof(path))
+        return NULL; 
+    if (mkdir(path, 0755) < 0 && errno != EEXIST)
+        return NULL; 
+    return path; 
+}
+
+static size_t cache_max_size(void)
+{
+    const char* limit = getenv("FRASCAL_CACHE_SIZE"); 
+    if (!limit || !*limit)
+        return CACHE_DEFAULT_SIZE; 
+
+    char* end; 
+    unsigned long long size = strtoull(limit, &end, 10); 
+    switch (*end)
+    {
+        case 'K': case 'k': size <<= 10; end++; break; 
+        case 'M': case 'm': size <<= 20; end++; break; 
+        case 'G': case 'g': size <<= 30; end++; break; 
+    }
+    return *end ? CACHE_DEFAULT_SIZE : size; 
+}
+
+static bool cache_path(char* path, size_t size, const char* dir, const char* name)
+{
+    int len = snprintf(path, size, "%s/%s", dir, name); 
+    return len > 0 && (size_t)len < size; 
+}
+
+void* cache_load(const char* key, size_t* size)
+{
+    const char* dir = cache_dir(); 
+    char path[4096]; 
+    char name[CACHE_KEY_SIZE + sizeof(CACHE_EXTENSION)]; 
+    snprintf(name, sizeof(name), "%s" CACHE_EXTENSION, key); 
+    if (!dir || !cache_path(path, sizeof(path), dir, name))
+        return NULL; 
+
+    int fd = open(path, O_RDONLY); 
+    if (fd < 0)
+        return NULL; 
+    struct stat st; 
+    char* data = NULL; 
+    if (fstat(fd, &st) == 0 && st.st_size > 0 && (data = malloc(st.st_size)))
+    {
+        size_t done = 0; 
+        while (done < (size_t)st.st_size)
+        {
+            ssize_t got = read(fd, data + done, st.st_size - done); 
+            if (got <= 0)
+                break; 
+            done += got; 
+        }
+        if (done < (size_t)st.st_size)
+        {
+            free(data); 
+            data = NULL; 
+        }
+        else
+        {
+            *size = done; 
+            /* the modification time orders the eviction */ 
+            futimens(fd, NULL); 
+        }
+    }
+    close(fd); 
+    return data; 
+}
+
+typedef struct Cache_entry_s {
+    char name[CACHE_KEY_SIZE + sizeof(CACHE_EXTENSION)]; 
+    size_t size; 
+    struct timespec used; 
+} Cache_entry; 
+
+static int cache_entry_older(const void* a, const void* b)
+{
+    const struct timespec* x = &((const Cache_entry*)a)->used; 
+    const struct timespec* y = &((const Cache_entry*)b)->used; 
+    if (x->tv_sec != y->tv_sec)
+        return x->tv_sec < y->tv_sec ? -1 : 1; 
+    if (x->tv_nsec != y->tv_nsec)
+        return x->tv_nsec < y->tv_nsec ? -1 : 1; 
+    return 0; 
+}
+
+static bool cache_is_temp(const char* name)
+{
+    return strlen(name) == strlen(CACHE_TEMP) && !strncmp(name, CACHE_TEMP_PREFIX, strlen(CACHE_TEMP_PREFIX)); 
+}
+
+/* removes the least recently used objects but keep until the rest fits. 
+ * the temporary files of the runs killed while storing go too */ 
+static void cache_evict(const char* dir, size_t max_size, const char* keep)
+{
+    DIR* stream = opendir(dir); 
+    if (!stream)
+        return; 
+
+    Cache_entry* entries = NULL; 
+    size_t count = 0, capacity = 0, total = 0; 
+    time_t now = time(NULL); 
+    struct dirent* ent; 
+    while ((ent = readdir(stream)))
+    {
+        struct stat st; 
+        if (cache_is_temp(ent->d_name))
+        {
+            /* a recent one is being written */ 
+            if (fstatat(dirfd(stream), ent->d_name, &st, 0) == 0 && now - st.st_mtime > CACHE_TEMP_STALE)
+                unlinkat(dirfd(stream), ent->d_name, 0); 
+            continue; 
+        }
+
+        size_t len = strlen(ent->d_name); 
+        if (len != CACHE_KEY_SIZE - 1 + strlen(CACHE_EXTENSION)
+            || strcmp(ent->d_name + CACHE_KEY_SIZE - 1, CACHE_EXTENSION))
+            continue; 
+        if (fstatat(dirfd(stream), ent->d_name, &st, 0) < 0)
+            continue; 
+        if (count == capacity)
+        {
+            capacity = capacity ? capacity * 2 : 64; 
+            Cache_entry* grown = realloc(entries, capacity * sizeof(Cache_entry)); 
+            if (!grown)
+                break; 
+            entries = grown; 
+        }
+        memcpy(entries[count].name, ent->d_name, len + 1); 
+        entries[count].size = st.st_size; 
+        entries[count].used = st.st_mtim; 
+        total += st.st_size; 
+        count++; 
+    }
+
+    if (total > max_size)
+    {
+        qsort(entries, count, sizeof(Cache_entry), cache_entry_older); 
+        /* another run may be evicting the same files, missing ones are skipped */ 
+        for (size_t i = 0; i < count && total > max_size; i++)
+        {
+            if (!strcmp(entries[i].name, keep))
+                continue; 
+            unlinkat(dirfd(stream), entries[i].name, 0); 
+            total -= entries[i].size; 
+        }
+    }
+    free(entries); 
+    closedir(stream); 
+}
+
+void cache_store(const char* key, const void* data, size_t size)
+{
+    const char* dir = cache_dir(); 
+    char path[4096], temp[4096]; 
+    char name[CACHE_KEY_SIZE + sizeof(CACHE_EXTENSION)]; 
+    snprintf(name, sizeof(name), "%s" CACHE_EXTENSION, key); 
+    if (!dir || !cache_path(path, sizeof(path), dir, name) || !cache_path(temp, sizeof(temp), dir, CACHE_TEMP))
+        return; 
+
+    /* written aside then renamed: concurrent runs see all of it or nothing */ 
+    int fd = mkstemp(temp); 
+    if (fd < 0)
+        return; 
+    const char* bytes = data; 
+    size_t done = 0; 
+    while (done < size)
+    {
+        ssize_t put = write(fd, bytes + done, size - done); 
+        if (put <= 0)
+            break; 
+        done += put; 
+    }
+    fchmod(fd, 0644); 
+    if (close(fd) < 0 || done < size || rename(temp, path) < 0)
+    {
+        unlink(temp); 
+        return; 
+    }
+
+    cache_evict(dir, cache_max_size(), name); 
+}
@@ -0,0 +1,38 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdbool.h> 
+#include <stddef.h> 
+
+/* the object cache of --run --cache: the compiled object of a program is 
+ * stored under a key hashing everything it depends on, the next runs of the 
+ * same program load it instead of compiling. 
+ * the directory is $FRASCAL_CACHE_DIR, $XDG_CACHE_HOME/frascal or 
+ * ~/.cache/frascal, it's kept under $FRASCAL_CACHE_SIZE bytes (K, M or G 
+ * suffixes, CACHE_DEFAULT_SIZE by default) by removing the least recently 
+ * used objects. the cache never fails a compilation, errors are misses. 
+ * a compiler built without FRASCAL_BUILD_ID (see the makefile) has no cache */ 
+
+#define CACHE_DEFAULT_SIZE ((size_t)64 << 20)
+#define CACHE_KEY_SIZE 33 /* 128 bits in hex and the NUL */ 
+
+/* fnv-1a on 128 bits, seeded with the compiler's version */ 
+typedef struct Cache_hash_s {
+    unsigned __int128 state; 
+} Cache_hash; 
+
+/* false when the compiler has no build id, --cache is refused */ 
+bool cache_available(void); 
+
+void cache_hash_init(Cache_hash* hash); 
+void cache_hash_add(Cache_hash* hash, const void* data, size_t size); 
+void cache_hash_add_str(Cache_hash* hash, const char* str); 
+void cache_hash_key(const Cache_hash* hash, char key[CACHE_KEY_SIZE]); 
+
+/* the object stored under key (malloc'ed), NULL on a miss. 
+ * a hit makes it the most recently used */ 
+void* cache_load(const char* key, size_t* size); 
+/* replaces atomically what key held, then evicts the other objects down to the size limit */ 
+void cache_store(const char* key, const void* data, size_t size); 
+
+#endif
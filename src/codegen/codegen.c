@@ -1,118 +1,229 @@
 #include "codegen.h"
 
-void code_gen_init(Codegen_ctx *ctx)
+#include <errno.h> 
+#include <unistd.h> 
+
+static void code_gen_init_module(Codegen_ctx *ctx, const char* module_name, LLVMOrcThreadSafeContextRef jit_context)
 {
     memset(ctx, 0, sizeof(Codegen_ctx)); 
-    //init llvm 
-    ctx->module = LLVMModuleCreateWithName("main_module"); 
-    ctx->builder = LLVMCreateBuilder(); 
+    //init llvm, every compilation owns its context so they can run in parallel 
+    ctx->jit_context = jit_context; 
+    ctx->context = jit_context ? LLVMOrcThreadSafeContextGetContext(jit_context) : LLVMContextCreate(); 
+    ctx->module = LLVMModuleCreateWithNameInContext(module_name, ctx->context); 
+    ctx->builder = LLVMCreateBuilderInContext(ctx->context); 
+    llvm_type_cache_init(&ctx->llvm_types, ctx->context); 
 
     //set up the symbol table 
-    ctx->global_sym_tab = st_create(); 
+    ctx->sym_tab = st_create(); 
+    VEC_init(&ctx->bounds_loops, NULL); 
+}
 
-    //define builtins functions 
-    builtins_init(ctx->module); 
-    builtins_add_to_symtab(ctx->global_sym_tab); 
+void code_gen_init(Codegen_ctx *ctx)
+{
+    code_gen_init_module(ctx, "main_module", NULL); 
+}
 
+void code_gen_init_jit(Codegen_ctx *ctx)
+{
+    code_gen_init_module(ctx, "main_module", LLVMOrcCreateNewThreadSafeContext()); 
+}
 
-    /* printf 
-     * return type : int
-     * argument : (char* , ...)
-     * isVarArg : true 
-     */
-    LLVMTypeRef printf_arg_types[] = { LLVMPointerType(LLVMInt8Type(), 0) };
-    ctx->printf_type = LLVMFunctionType(LLVMInt32Type(), printf_arg_types, 1, true); 
-    ctx->printf_ref = LLVMAddFunction(ctx->module, "printf", ctx->printf_type); 
+void code_gen_init_worker(Codegen_ctx *ctx, Codegen_ctx *parent)
+{
+    code_gen_init_module(ctx, "worker_module", NULL); 
 
+    ctx->shared = parent->sym_tab; 
+    ctx->bounds_check = parent->bounds_check; 
 }
 
 void code_gen_cleanup(Codegen_ctx *ctx)
 {
-    //cleanup llvm 
+    //cleanup llvm, the lazy stubs hold symbols of the jit's pool: they go before it 
+    if (ctx->jit_stubs)
+        LLVMOrcDisposeIndirectStubsManager(ctx->jit_stubs); 
+    if (ctx->jit_call_through)
+        LLVMOrcDisposeLazyCallThroughManager(ctx->jit_call_through); 
+    //then the jit's modules, they live in the context 
+    if (ctx->jit)
+        LLVMConsumeError(LLVMOrcDisposeLLJIT(ctx->jit)); 
     LLVMDisposeBuilder(ctx->builder); 
     LLVMDisposeModule(ctx->module); 
+    if (ctx->jit_context)
+        LLVMOrcDisposeThreadSafeContext(ctx->jit_context); 
+    else 
+        LLVMContextDispose(ctx->context); 
+    llvm_type_cache_free(&ctx->llvm_types); 
 
     //free the symbol table
-    st_free(ctx->global_sym_tab); 
+    st_free(ctx->sym_tab); 
+    VEC_free(&ctx->bounds_loops); 
+    free(ctx->strings); 
+    if (ctx->target_machine)
+        LLVMDisposeTargetMachine(ctx->target_machine); 
 }
 
-St_entry* find_var(Codegen_ctx* ctx, char* name)
+St_entry* find_var(Codegen_ctx* ctx, Symbol name)
 {
-    St_entry* var = st_find_var(ctx->current_sym_tab, name); 
-    if (var)
-        return var; 
+    /* locals shadow the globals */ 
+    return st_find_var(ctx->sym_tab, name); 
+}
 
-    /* if it's the main function dont research in the global sym tab */ 
-    if (ctx->current_sym_tab == ctx->global_sym_tab)
-        return NULL; 
+/* attributes belong to a context, they are rebuilt from their kinds */ 
+static void copy_fn_attributes(Codegen_ctx* ctx, LLVMValueRef from, LLVMValueRef to)
+{
+    unsigned count = LLVMGetAttributeCountAtIndex(from, LLVMAttributeFunctionIndex); 
+    if (count == 0)
+        return; 
+    LLVMAttributeRef* attrs = malloc(count * sizeof(LLVMAttributeRef)); 
+    LLVMGetAttributesAtIndex(from, LLVMAttributeFunctionIndex, attrs); 
+    for (unsigned i = 0; i < count; i++)
+    {
+        LLVMAttributeRef attr = LLVMCreateEnumAttribute(ctx->context, 
+                                                        LLVMGetEnumAttributeKind(attrs[i]), 
+                                                        LLVMGetEnumAttributeValue(attrs[i])); 
+        LLVMAddAttributeAtIndex(to, LLVMAttributeFunctionIndex, attr); 
+    }
+    free(attrs); 
+}
 
-    return st_find_var(ctx->global_sym_tab, name); 
+/* declares a function of the shared table in the worker's module, 
+ * under the same llvm name so the modules link back together */ 
+static St_entry* import_fun(Codegen_ctx* ctx, St_entry* shared_entry)
+{
+    Function_type* fn_type = (Function_type*)shared_entry->type; 
+    LLVMTypeRef llvm_fun_type = code_gen_llvm_type(ctx, shared_entry->type); 
+    /* reading the name is safe, the parent's module doesn't change while workers run */ 
+    size_t name_len; 
+    const char* llvm_name = LLVMGetValueName2(shared_entry->value_ref, &name_len); 
+    /* imports are dropped with the function's scope but the module keeps them */ 
+    LLVMValueRef fun_ref = LLVMGetNamedFunction(ctx->module, llvm_name); 
+    if (!fun_ref)
+    {
+        /* a private string of the worker may hold the name already, it gives it up */ 
+        LLVMValueRef clash = LLVMGetNamedGlobal(ctx->module, llvm_name); 
+        if (clash)
+            LLVMSetValueName2(clash, "", 0); 
+        fun_ref = LLVMAddFunction(ctx->module, llvm_name, llvm_fun_type); 
+        copy_fn_attributes(ctx, shared_entry->value_ref, fun_ref); 
+    }
+
+    /* types are shared, the worker only reads them */ 
+    st_insert_fun(ctx->sym_tab, shared_entry->name, shared_entry->type, fun_ref, llvm_fun_type); 
+    return st_find_fun(ctx->sym_tab, shared_entry->name, fn_type->param_types, fn_type->param_count); 
 }
 
-/* for now search only the global table */ 
-St_entry* find_fun(Codegen_ctx* ctx, char* name, Type** args, size_t args_count)
+/* functions are only declared in the global scope */ 
+St_entry* find_fun(Codegen_ctx* ctx, Symbol name, Type** args, size_t args_count)
 {
-    return st_find_fun(ctx->global_sym_tab, name, args, args_count); 
+    St_entry* entry = st_find_fun(ctx->sym_tab, name, args, args_count); 
+    if (entry || !ctx->shared)
+        return entry; 
+
+    /* a worker sees the functions declared before the one it generates */ 
+    St_entry* shared_entry = st_find_fun(ctx->shared, name, args, args_count); 
+    if (!shared_entry || shared_entry->order > ctx->visible_order)
+        return NULL; 
+    return import_fun(ctx, shared_entry); 
 }
 
 
+/* an integer array or matrix with its elements on bits */ 
+static LLVMTypeRef narrowed_llvm_type(Codegen_ctx* ctx, Type* type, unsigned bits)
+{
+    LLVMTypeRef elem = LLVMIntTypeInContext(ctx->context, bits); 
+    if (TYPE_IS_ARRAY(type))
+        return LLVMArrayType(elem, ((Array_type*)type)->size); 
+    Matrix_type* mat_type = (Matrix_type*)type; 
+    return LLVMArrayType(LLVMArrayType(elem, mat_type->size[1]), mat_type->size[0]); 
+}
+
 void code_gen_populate_st(Codegen_ctx* ctx, AST_node* decls)
 {
     if (!decls)
         return; 
-    LL_FOR_EACH(((AST_declarations_node*)decls) -> var_decls_list, ll_node)
+    VEC_FOR_EACH(&((AST_declarations_node*)decls) -> var_decls_list, item)
     {
-        AST_var_declaration_node* decl_node = (AST_var_declaration_node*)ll_node -> data; 
+        AST_var_declaration_node* decl_node = (AST_var_declaration_node*)item; 
         AST_id_node* id_node = (AST_id_node*)(decl_node -> id_node); 
 
-        Type* decl_type = code_gen_resolve_type(ctx, decl_node->id_type); 
+        Type* decl_type = code_gen_resolve_type(decl_node->id_type); 
+        LLVMTypeRef storage = decl_node->narrow_bits 
+            ? narrowed_llvm_type(ctx, decl_type, decl_node->narrow_bits) 
+            : code_gen_llvm_type(ctx, decl_type); 
 
-        LLVMValueRef id_alloca = LLVMBuildAlloca(ctx->builder, type_to_llvm_type(decl_type), id_node->id_str);
-        if (st_insert_var(ctx->current_sym_tab, id_node->id_str, decl_type, id_alloca)
-                                                == ST_ALREADY_DECLARED)
-        {
-            fprintf(stderr, "Error : variable %s declared twice\n", id_node -> id_str); 
-            exit(3); 
-        }
+        LLVMValueRef id_alloca = LLVMBuildAlloca(ctx->builder, storage, symbol_name(id_node->id));
+        st_insert_var(ctx->sym_tab, id_node->id, decl_type, id_alloca); 
+        if (decl_node->narrow_bits)
+            st_find_var(ctx->sym_tab, id_node->id)->type_ref = storage; 
     }
 }
 
 void code_gen_ir(Codegen_ctx *ctx, AST_node* program_node)
 {
+    /* the program went through the semantic pass, user types are resolved */ 
     assert(program_node != NULL); 
-    // user defined types 
-    code_gen_new_types(ctx, ((AST_program_node*)program_node)->new_types); 
-    
     //code generating subprograms 
     code_gen_subprograms(ctx, ((AST_program_node*)program_node)->subprograms); 
     
     //creating a main function without arguments
-    LLVMTypeRef ret_type = LLVMFunctionType(LLVMInt32Type(), NULL, 0, 0);
+    LLVMTypeRef ret_type = LLVMFunctionType(LLVMInt32TypeInContext(ctx->context), NULL, 0, 0);
     LLVMValueRef main_function = LLVMAddFunction(ctx->module, "main", ret_type);
 
     //creating entry basic block 
-    LLVMBasicBlockRef entry = LLVMAppendBasicBlock(main_function, "entry");
+    LLVMBasicBlockRef entry = LLVMAppendBasicBlockInContext(ctx->context, main_function, "entry");
     LLVMPositionBuilderAtEnd(ctx->builder, entry);
 
     //allocate variables in the stack
-    //* it's the main function there is no local symtoble so make it point to the gloable table *//  
-    ctx->current_sym_tab = ctx->global_sym_tab; 
+    //* it's the main function there is no local scope, its variables go in the global one *//  
     code_gen_populate_st(ctx, ((AST_program_node*)program_node)->declarations); 
 
     //statements ir generation
     code_gen_stmt(ctx, ((AST_program_node*)program_node)->statements); 
 
     //main function return 
-    LLVMBuildRet(ctx->builder, LLVMConstInt(LLVMInt32Type(), 0, false));
-    //verify the main module
+    LLVMBuildRet(ctx->builder, LLVMConstInt(LLVMInt32TypeInContext(ctx->context), 0, false));
+    //verify the main module, without aborting: other compilations may be running 
     char* error = NULL; 
-    if (LLVMVerifyModule(ctx->module, LLVMAbortProcessAction, &error))
+    if (LLVMVerifyModule(ctx->module, LLVMReturnStatusAction, &error))
     {
-        fprintf(stderr, "Error : %s\n", error); 
-        exit(3); 
+        error_fatal(3, "Error : %s\n", error); 
     }
     LLVMDisposeMessage(error); 
-    //print the final ir to a file  
-    LLVMPrintModuleToFile(ctx->module, "out.ll", NULL); 
+}
+
+void code_gen_write_stdout(const char* data, size_t size)
+{
+    if (fwrite(data, 1, size, stdout) != size || fflush(stdout))
+        error_fatal(1, "Error : can't write to the standard output: %s\n", strerror(errno)); 
+}
+
+void code_gen_write_ir(Codegen_ctx *ctx, const char* path)
+{
+    if (!strcmp(path, "-"))
+    {
+        char* ir = LLVMPrintModuleToString(ctx->module); 
+        code_gen_write_stdout(ir, strlen(ir)); 
+        LLVMDisposeMessage(ir); 
+        return; 
+    }
+
+    char* error = NULL; 
+    if (LLVMPrintModuleToFile(ctx->module, path, &error))
+    {
+        error_fatal(1, "Error : %s: %s\n", path, error); 
+    }
+}
+
+void code_gen_write_bitcode(Codegen_ctx *ctx, const char* path)
+{
+    /* straight to the descriptor, nothing is buffered on the way */ 
+    if (!strcmp(path, "-"))
+    {
+        if (fflush(stdout) || LLVMWriteBitcodeToFD(ctx->module, STDOUT_FILENO, 0, 1))
+            error_fatal(1, "Error : can't write the bitcode to the standard output\n"); 
+        return; 
+    }
 
+    if (LLVMWriteBitcodeToFile(ctx->module, path))
+        error_fatal(1, "Error : can't write the bitcode to %s\n", path); 
 }
@@ -4,31 +4,89 @@
 #include <llvm-c/Core.h>
 #include <llvm-c/Analysis.h>
 #include <llvm-c/Support.h>
-#include <llvm-c/ExecutionEngine.h>
+#include <llvm-c/LLJIT.h>
+#include <llvm-c/TargetMachine.h>
+#include <llvm-c/BitWriter.h>
 #include <stdio.h>
 
 #include "ast.h"
 #include "symboltable.h"
 #include "builtins.h"
+#include "error.h"
+
+/* the functions of runtime/frascal_rt.h the generated code calls */ 
+typedef enum Runtime_fn_e {
+    RT_EMIT_INT, 
+    RT_EMIT_FLOAT, 
+    RT_EMIT_BOOL, 
+    RT_EMIT_CHAR, 
+    RT_EMIT_STR, 
+    RT_READ_INT, 
+    RT_READ_FLOAT, 
+    RT_READ_BOOL, 
+    RT_READ_CHAR, 
+    RT_BOUNDS_FAIL, 
+    RT_FN_NB, 
+} Runtime_fn; 
+
+/* a slot of the string constants' table, global is NULL if it's empty */ 
+typedef struct Codegen_string_s {
+    LLVMValueRef global; 
+    uint32_t hash; 
+} Codegen_string; 
 
 typedef struct Codegen_ctx_s {
+    LLVMContextRef context; 
     LLVMModuleRef module;
     LLVMBuilderRef builder;
-    Symbol_table* global_sym_tab; 
-    Symbol_table* current_sym_tab; 
+    Symbol_table* sym_tab; /* global scope, function bodies push their own */ 
     Type* current_fn_ret_type;  
     bool current_block_terminated; 
-    LLVMTypeRef printf_type; 
-    LLVMValueRef printf_ref; 
+    Llvm_type_cache llvm_types; /* the module's types, built once */ 
+    LLVMValueRef runtime_refs[RT_FN_NB]; /* declared on first use */ 
+    Codegen_string* strings; /* open addressing table of the module's string constants, each one once */ 
+    size_t strings_count; 
+    size_t strings_capacity; 
+
+    int codegen_threads; /* more than 1 generates the subprograms in parallel */ 
+    /* parallel workers only: functions are looked up in the 
+     * compilation's global table (read only) and functions declared up to 
+     * visible_order are imported into the worker's module on first use */ 
+    Symbol_table* shared; 
+    size_t visible_order; 
+
+    bool bounds_check; /* check the subscripts against the array sizes */ 
+    Vector bounds_loops; /* the enclosing pour loops with a known counter, see codegen_bounds.c */ 
+
+    int opt_level; /* -O, 0 leaves the module as generated */ 
+    LLVMTargetMachineRef target_machine; /* the host's, created on first use */ 
+
+    /* --run, see codegen_jit.c */ 
+    LLVMOrcThreadSafeContextRef jit_context; /* owns context, the jit's modules share it */ 
+    LLVMOrcLLJITRef jit; 
+    LLVMOrcLazyCallThroughManagerRef jit_call_through; 
+    LLVMOrcIndirectStubsManagerRef jit_stubs; 
 } Codegen_ctx; 
 
 void code_gen_ir(Codegen_ctx *ctx, AST_node* program_node);
+/* the module's textual ir or bitcode to path, "-" is the standard output */ 
+void code_gen_write_ir(Codegen_ctx *ctx, const char* path);
+void code_gen_write_bitcode(Codegen_ctx *ctx, const char* path); 
+void code_gen_write_stdout(const char* data, size_t size); 
 
 void code_gen_init(Codegen_ctx *ctx);
+/* the same, in a context the jit can share */ 
+void code_gen_init_jit(Codegen_ctx *ctx); 
+/* a context with its own llvm context and module that reads parent's globals */ 
+void code_gen_init_worker(Codegen_ctx *ctx, Codegen_ctx *parent);
 void code_gen_cleanup(Codegen_ctx *ctx);
 
 /* subprograms */ 
 void code_gen_subprograms(Codegen_ctx *ctx, AST_node* subprograms); 
+/* declare adds the prototype to the module and the symbol table, define emits the body */ 
+St_entry* code_gen_declare_function(Codegen_ctx *ctx, AST_function_node* fn); 
+void code_gen_define_function(Codegen_ctx *ctx, AST_function_node* fn, St_entry* fn_entry); 
+void code_gen_subprograms_parallel(Codegen_ctx *ctx, AST_function_node** fns, St_entry** entries, size_t count); 
 
 /* statements */ 
 void code_gen_stmt(Codegen_ctx *ctx, AST_node* stmt); 
@@ -37,15 +95,55 @@ void code_gen_stmt(Codegen_ctx *ctx, AST_node* stmt);
 LLVMValueRef code_gen_exp(Codegen_ctx *ctx, AST_node* exp); 
 LLVMValueRef code_gen_lval(Codegen_ctx *ctx, AST_node* lval); 
 #define code_gen_rval(c, r) code_gen_exp(c, r)
+/* the element type of a narrowed array subscript, NULL for any other lvalue */ 
+LLVMTypeRef code_gen_narrowed_elem(Codegen_ctx *ctx, AST_node* lval); 
+
+/* bounds checks, only emitted with bounds_check */ 
+#define BOUNDS_OK_WEIGHT 1048575 /* branch weight of a passing check against 1 */ 
+typedef struct Bounds_loop_s Bounds_loop; 
+void code_gen_bounds_check(Codegen_ctx *ctx, AST_node* subscript, unsigned dim, LLVMValueRef index); 
+/* proves the counter subscripts of the body or checks them once before it, NULL if nothing is known */ 
+Bounds_loop* code_gen_bounds_enter_loop(Codegen_ctx *ctx, AST_for_node* node, LLVMValueRef from, LLVMValueRef to); 
+/* continues in a new block if the checks hoisted out of the loop pass, 
+ * returns the block where they failed. NULL if nothing was hoisted */ 
+LLVMBasicBlockRef code_gen_bounds_version_loop(Codegen_ctx *ctx, Bounds_loop* loop); 
+/* the body generated next checks its subscripts on every iteration */ 
+void code_gen_bounds_drop_hoisted(Bounds_loop* loop); 
+void code_gen_bounds_leave_loop(Codegen_ctx *ctx, Bounds_loop* loop); 
+
+/* runtime */ 
+LLVMValueRef code_gen_runtime_fn(Codegen_ctx *ctx, Runtime_fn fn); 
+LLVMValueRef code_gen_runtime_call(Codegen_ctx *ctx, Runtime_fn fn, LLVMValueRef* args, unsigned args_count); 
+/* the symbol of a runtime function and its address in the compiler */ 
+const char* code_gen_runtime_name(Runtime_fn fn); 
+void* code_gen_runtime_address(Runtime_fn fn); 
+/* a pointer to len bytes of str, identical strings share one global */ 
+LLVMValueRef code_gen_string(Codegen_ctx *ctx, const char* str, size_t len); 
+
+/* target */ 
+LLVMTargetMachineRef code_gen_target_machine(Codegen_ctx *ctx); 
+/* a new one owned by the caller */ 
+LLVMTargetMachineRef code_gen_create_target_machine(int opt_level); 
+/* runs the -O pipeline of opt_level on the module, for the host */ 
+void code_gen_optimize(Codegen_ctx *ctx); 
+/* the module as host assembly or a native object file, "-" is the standard output */ 
+void code_gen_emit_native(Codegen_ctx *ctx, const char* path, LLVMCodeGenFileType type); 
+LLVMMemoryBufferRef code_gen_emit_buffer(Codegen_ctx *ctx, LLVMCodeGenFileType type); 
+
+/* jit */ 
+/* runs main in process, returns its result and how long it ran */ 
+int code_gen_run(Codegen_ctx *ctx, double* run_seconds); 
+/* the same from the compiled object of a program, the jit takes the buffer */ 
+int code_gen_run_object(Codegen_ctx *ctx, LLVMMemoryBufferRef object, double* run_seconds); 
 
 /* type */ 
+#define code_gen_llvm_type(c, t) type_to_llvm_type_cached(&(c)->llvm_types, (t))
 LLVMValueRef code_gen_promote(Codegen_ctx *ctx, LLVMValueRef value, Type* val_type, Type* dest_type);
-Type* code_gen_resolve_type(Codegen_ctx* ctx, AST_node* type); 
-void code_gen_new_types(Codegen_ctx *ctx, AST_node* new_types); 
+Type* code_gen_resolve_type(AST_node* type); 
 
 /* helper functions */ 
-St_entry* find_var(Codegen_ctx *ctx, char * name);
-St_entry* find_fun(Codegen_ctx *ctx, char * name, Type** args, size_t args_count);
+St_entry* find_var(Codegen_ctx *ctx, Symbol name);
+St_entry* find_fun(Codegen_ctx *ctx, Symbol name, Type** args, size_t args_count);
 void code_gen_populate_st(Codegen_ctx *ctx, AST_node* decls);
 static inline bool is_block_terminated(Codegen_ctx *ctx)
 {
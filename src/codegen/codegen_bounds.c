@@ -0,0 +1,327 @@
+#include <stdint.h>
+
+#include <codegen.h>
+
+#include "effects.h"
+
+/* a subscript checked once before the loop, for all its iterations */ 
+typedef struct Bounds_hoisted_s {
+    AST_node* subscript; 
+    unsigned dim; 
+} Bounds_hoisted; 
+
+/* a pour loop whose body doesn't write the counter: in the body the
+ * counter stays between the bounds read before the first iteration */ 
+struct Bounds_loop_s {
+    Symbol counter; 
+    bool is_const; /* the bounds are constants, lo <= hi */ 
+    int lo; 
+    int hi; 
+    Bounds_hoisted* hoisted; 
+    size_t hoisted_count; 
+    LLVMValueRef hoisted_ok; /* every hoisted subscript is in range */ 
+}; 
+
+static inline LLVMTypeRef i32_type(Codegen_ctx *ctx)
+{
+    return LLVMInt32TypeInContext(ctx->context); 
+}
+
+/* the false side of branch is cold, it's laid out of the way of the loop */ 
+static void set_cold_false(Codegen_ctx *ctx, LLVMValueRef branch)
+{
+    LLVMValueRef weights[] = {
+        LLVMMDStringInContext(ctx->context, "branch_weights", strlen("branch_weights")),
+        LLVMConstInt(i32_type(ctx), BOUNDS_OK_WEIGHT, false),
+        LLVMConstInt(i32_type(ctx), 1, false),
+    }; 
+    LLVMSetMetadata(branch, LLVMGetMDKindIDInContext(ctx->context, "prof", strlen("prof")),
+                    LLVMMDNodeInContext(ctx->context, weights, 3)); 
+}
+
+/* continues in a new block if ok, reports index otherwise */ 
+static void emit_check(Codegen_ctx *ctx, LLVMValueRef ok, LLVMValueRef index, size_t size)
+{
+    LLVMValueRef function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(ctx->builder)); 
+    LLVMBasicBlockRef cont = LLVMAppendBasicBlockInContext(ctx->context, function, "bounds_ok"); 
+    LLVMBasicBlockRef fail = LLVMAppendBasicBlockInContext(ctx->context, function, "bounds_fail"); 
+    set_cold_false(ctx, LLVMBuildCondBr(ctx->builder, ok, cont, fail)); 
+
+    LLVMPositionBuilderAtEnd(ctx->builder, fail); 
+    LLVMValueRef args[] = {index, LLVMConstInt(i32_type(ctx), size, false)}; 
+    code_gen_runtime_call(ctx, RT_BOUNDS_FAIL, args, 2); 
+    LLVMBuildUnreachable(ctx->builder); 
+
+    LLVMPositionBuilderAtEnd(ctx->builder, cont); 
+}
+
+static Bounds_loop* find_loop(Codegen_ctx *ctx, Symbol counter)
+{
+    for (size_t i = VEC_size(&ctx->bounds_loops); i > 0; i--)
+    {
+        Bounds_loop* loop = VEC_at(&ctx->bounds_loops, i - 1); 
+        if (loop->counter == counter)
+            return loop; 
+    }
+    return NULL; 
+}
+
+/* true if every value of index is proven to be in [0, size) */ 
+static bool index_proven(Codegen_ctx *ctx, AST_node* index, size_t size)
+{
+    Symbol var; 
+    int offset; 
+    if (!effects_index_affine(index, &var, &offset))
+        return false; 
+    int64_t lo = offset, hi = offset; 
+    if (var != SYMBOL_NONE)
+    {
+        Bounds_loop* loop = find_loop(ctx, var); 
+        if (!loop || !loop->is_const)
+            return false; 
+        lo += loop->lo; 
+        hi += loop->hi; 
+    }
+    return lo >= 0 && hi < (int64_t)size; 
+}
+
+static size_t subscript_size(AST_node* subscript, unsigned dim)
+{
+    if (subscript->type == NODE_ARR_SUB)
+        return ((Array_type*)ast_exp_type(((AST_arr_sub_node*)subscript)->id_node))->size; 
+    return ((Matrix_type*)ast_exp_type(((AST_mat_sub_node*)subscript)->id_node))->size[dim]; 
+}
+
+static AST_node* subscript_index(AST_node* subscript, unsigned dim)
+{
+    if (subscript->type == NODE_ARR_SUB)
+        return ((AST_arr_sub_node*)subscript)->exp; 
+    return ((AST_mat_sub_node*)subscript)->exp[dim]; 
+}
+
+void code_gen_bounds_check(Codegen_ctx *ctx, AST_node* subscript, unsigned dim, LLVMValueRef index)
+{
+    if (!ctx->bounds_check)
+        return; 
+
+    size_t size = subscript_size(subscript, dim); 
+    if (index_proven(ctx, subscript_index(subscript, dim), size))
+        return; 
+    for (size_t i = VEC_size(&ctx->bounds_loops); i > 0; i--)
+    {
+        Bounds_loop* loop = VEC_at(&ctx->bounds_loops, i - 1); 
+        for (size_t j = 0; j < loop->hoisted_count; j++)
+        {
+            if (loop->hoisted[j].subscript == subscript && loop->hoisted[j].dim == dim)
+                return; 
+        }
+    }
+
+    /* a negative index is a large unsigned one */ 
+    LLVMValueRef ok = LLVMBuildICmp(ctx->builder, LLVMIntULT, index,
+                                    LLVMConstInt(i32_type(ctx), size, false), "in_bounds"); 
+    emit_check(ctx, ok, index, size); 
+}
+
+/* a body holding loops isn't duplicated, the copies would nest */ 
+static bool has_loop(AST_node* root)
+{
+    if (!root)
+        return false; 
+    switch (root->type)
+    {
+        case NODE_FOR:
+        case NODE_WHILE:
+        case NODE_DOWHILE:
+            return true; 
+        case NODE_STATEMENTS:
+            VEC_FOR_EACH(&((AST_statements_node*)root)->stmts_list, item)
+            {
+                if (has_loop(item))
+                    return true; 
+            }
+            return false; 
+        case NODE_IF:
+        {
+            AST_if_node* node = (AST_if_node*)root; 
+            if (has_loop(node->action) || has_loop(node->else_action))
+                return true; 
+            if (node->elif_branches)
+            {
+                VEC_FOR_EACH(&((AST_elif_node*)node->elif_branches)->branches_list, item)
+                {
+                    if (has_loop(((AST_branch_node*)item)->action))
+                        return true; 
+                }
+            }
+            return false; 
+        }
+        default:
+            return false; 
+    }
+}
+
+/* [from + offset, to + offset] is in [0, size) */ 
+static LLVMValueRef range_ok(Codegen_ctx *ctx, LLVMValueRef from, LLVMValueRef to, int offset, size_t size)
+{
+    LLVMTypeRef i64 = LLVMInt64TypeInContext(ctx->context); 
+    LLVMValueRef off = LLVMConstInt(i64, offset, true); 
+    LLVMValueRef first = LLVMBuildAdd(ctx->builder, LLVMBuildSExt(ctx->builder, from, i64, ""), off, "first_index"); 
+    LLVMValueRef last = LLVMBuildAdd(ctx->builder, LLVMBuildSExt(ctx->builder, to, i64, ""), off, "last_index"); 
+    LLVMValueRef low_ok = LLVMBuildICmp(ctx->builder, LLVMIntSGE, first, LLVMConstInt(i64, 0, false), ""); 
+    LLVMValueRef high_ok = LLVMBuildICmp(ctx->builder, LLVMIntSLT, last, LLVMConstInt(i64, size, false), ""); 
+    return LLVMBuildAnd(ctx->builder, low_ok, high_ok, "in_bounds"); 
+}
+
+static void hoist_exp(Codegen_ctx *ctx, Bounds_loop* loop, AST_node* exp, LLVMValueRef from, LLVMValueRef to); 
+
+static void hoist_subscript(Codegen_ctx *ctx, Bounds_loop* loop, AST_node* subscript, unsigned dim,
+                            LLVMValueRef from, LLVMValueRef to)
+{
+    AST_node* index = subscript_index(subscript, dim); 
+    hoist_exp(ctx, loop, index, from, to); 
+
+    Symbol var; 
+    int offset; 
+    size_t size = subscript_size(subscript, dim); 
+    if (!effects_index_affine(index, &var, &offset) || var == SYMBOL_NONE || index_proven(ctx, index, size))
+        return; 
+
+    LLVMValueRef ok; 
+    if (var == loop->counter)
+        ok = range_ok(ctx, from, to, offset, size); 
+    else if (find_loop(ctx, var))
+        /* the counter of an enclosing loop doesn't move during this one,
+         * a negative index is a large unsigned one */ 
+        ok = LLVMBuildICmp(ctx->builder, LLVMIntULT, code_gen_exp(ctx, index), 
+                           LLVMConstInt(i32_type(ctx), size, false), "in_bounds"); 
+    else 
+        return; 
+    loop->hoisted_ok = loop->hoisted_ok ? LLVMBuildAnd(ctx->builder, loop->hoisted_ok, ok, "") : ok; 
+    Bounds_hoisted* hoisted = realloc(loop->hoisted, (loop->hoisted_count + 1) * sizeof(Bounds_hoisted)); 
+    if (!hoisted)
+    {
+        fprintf(stderr, "Error: out of memory\n"); 
+        exit(1); 
+    }
+    loop->hoisted = hoisted; 
+    loop->hoisted[loop->hoisted_count++] = (Bounds_hoisted){subscript, dim}; 
+}
+
+/* the subscripts evaluated on every iteration */ 
+static void hoist_exp(Codegen_ctx *ctx, Bounds_loop* loop, AST_node* exp, LLVMValueRef from, LLVMValueRef to)
+{
+    if (!exp)
+        return; 
+    switch (exp->type)
+    {
+        case NODE_OP:
+        {
+            AST_op_node* node = (AST_op_node*)exp; 
+            hoist_exp(ctx, loop, node->lhs, from, to); 
+            /* the right side of et and ou may be skipped */ 
+            if (node->op_type != OP_AND && node->op_type != OP_OR)
+                hoist_exp(ctx, loop, node->rhs, from, to); 
+            break; 
+        }
+        case NODE_CALL:
+        {
+            AST_node* args = ((AST_call_node*)exp)->args; 
+            if (args)
+            {
+                VEC_FOR_EACH(&((AST_args_node*)args)->args_list, item)
+                {
+                    hoist_exp(ctx, loop, ((AST_arg_node*)item)->exp, from, to); 
+                }
+            }
+            break; 
+        }
+        case NODE_ARR_SUB:
+            hoist_subscript(ctx, loop, exp, 0, from, to); 
+            break; 
+        case NODE_MAT_SUB:
+            hoist_subscript(ctx, loop, exp, 0, from, to); 
+            hoist_subscript(ctx, loop, exp, 1, from, to); 
+            break; 
+        default:
+            break; 
+    }
+}
+
+Bounds_loop* code_gen_bounds_enter_loop(Codegen_ctx *ctx, AST_for_node* node, LLVMValueRef from, LLVMValueRef to)
+{
+    Symbol counter = ((AST_id_node*)node->iter)->id; 
+    if (!ctx->bounds_check || effects_writes_var(node->statements, counter))
+        return NULL; 
+
+    Bounds_loop* loop = calloc(1, sizeof(Bounds_loop)); 
+    if (!loop)
+    {
+        fprintf(stderr, "Error: out of memory\n"); 
+        exit(1); 
+    }
+    loop->counter = counter; 
+    if (LLVMIsAConstantInt(from) && LLVMIsAConstantInt(to))
+    {
+        loop->lo = LLVMConstIntGetSExtValue(from); 
+        loop->hi = LLVMConstIntGetSExtValue(to); 
+        loop->is_const = loop->lo <= loop->hi; 
+    }
+    VEC_push_back(&ctx->bounds_loops, loop); 
+
+    /* the statements of the body that run on every iteration have
+     * their counter subscripts checked once, before the loop starts */ 
+    if (node->statements && !has_loop(node->statements))
+    {
+        VEC_FOR_EACH(&((AST_statements_node*)node->statements)->stmts_list, item)
+        {
+            AST_node* stmt = item; 
+            if (stmt->type == NODE_ASSIGN)
+            {
+                hoist_exp(ctx, loop, ((AST_assign_node*)stmt)->dest, from, to); 
+                hoist_exp(ctx, loop, ((AST_assign_node*)stmt)->assign_exp, from, to); 
+            }
+            else if (stmt->type == NODE_PRINT && ((AST_print_node*)stmt)->args)
+            {
+                VEC_FOR_EACH(&((AST_args_node*)((AST_print_node*)stmt)->args)->args_list, arg)
+                {
+                    hoist_exp(ctx, loop, ((AST_arg_node*)arg)->exp, from, to); 
+                }
+            }
+            else if (stmt->type == NODE_READ)
+            {
+                VEC_FOR_EACH(&((AST_args_node*)((AST_read_node*)stmt)->args)->args_list, arg)
+                {
+                    hoist_exp(ctx, loop, ((AST_arg_node*)arg)->exp, from, to); 
+                }
+            }
+        }
+    }
+    return loop; 
+}
+
+LLVMBasicBlockRef code_gen_bounds_version_loop(Codegen_ctx *ctx, Bounds_loop* loop)
+{
+    if (!loop || !loop->hoisted_ok)
+        return NULL; 
+    LLVMValueRef function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(ctx->builder)); 
+    LLVMBasicBlockRef hoisted = LLVMAppendBasicBlockInContext(ctx->context, function, "for_hoisted"); 
+    LLVMBasicBlockRef checked = LLVMAppendBasicBlockInContext(ctx->context, function, "for_checked"); 
+    set_cold_false(ctx, LLVMBuildCondBr(ctx->builder, loop->hoisted_ok, hoisted, checked)); 
+    LLVMPositionBuilderAtEnd(ctx->builder, hoisted); 
+    return checked; 
+}
+
+void code_gen_bounds_drop_hoisted(Bounds_loop* loop)
+{
+    loop->hoisted_count = 0; 
+}
+
+void code_gen_bounds_leave_loop(Codegen_ctx *ctx, Bounds_loop* loop)
+{
+    if (!loop)
+        return; 
+    VEC_pop_back(&ctx->bounds_loops); 
+    free(loop->hoisted); 
+    free(loop); 
+}
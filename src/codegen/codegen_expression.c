@@ -5,6 +5,56 @@ static LLVMValueRef code_gen_call(Codegen_ctx *ctx, AST_node* root);
 static LLVMValueRef code_gen_arr_sub(Codegen_ctx *ctx, AST_node* root);
 static LLVMValueRef code_gen_mat_sub(Codegen_ctx *ctx, AST_node* root);
 
+/* evaluating it when the program wouldn't can't trap, read out of 
+ * an array or have an effect */ 
+static bool is_speculatable(AST_node* exp)
+{
+    switch (exp->type)
+    {
+        case NODE_CONST: 
+        case NODE_ID: 
+            return true; 
+        case NODE_OP: 
+        {
+            AST_op_node* node = (AST_op_node*)exp; 
+            if (node->op_type == OP_IDIV || node->op_type == OP_MOD)
+                return false; 
+            return is_speculatable(node->lhs) && (!node->rhs || is_speculatable(node->rhs)); 
+        }
+        default: 
+            return false; 
+    }
+}
+
+/* et and ou only evaluate their right side if the left one doesn't decide */ 
+static LLVMValueRef code_gen_short_circuit(Codegen_ctx *ctx, AST_op_node* node)
+{
+    bool is_and = node->op_type == OP_AND; 
+    LLVMValueRef left = code_gen_exp(ctx, node->lhs); 
+    LLVMBasicBlockRef left_block = LLVMGetInsertBlock(ctx->builder); 
+    LLVMValueRef function = LLVMGetBasicBlockParent(left_block); 
+
+    LLVMBasicBlockRef rhs_block = LLVMAppendBasicBlockInContext(ctx->context, function, is_and ? "and_rhs" : "or_rhs"); 
+    LLVMBasicBlockRef merge_block = LLVMAppendBasicBlockInContext(ctx->context, function, is_and ? "and_end" : "or_end"); 
+    if (is_and)
+        LLVMBuildCondBr(ctx->builder, left, rhs_block, merge_block); 
+    else 
+        LLVMBuildCondBr(ctx->builder, left, merge_block, rhs_block); 
+
+    LLVMPositionBuilderAtEnd(ctx->builder, rhs_block); 
+    LLVMValueRef right = code_gen_exp(ctx, node->rhs); 
+    /* the right side may have split its block */ 
+    LLVMBasicBlockRef right_block = LLVMGetInsertBlock(ctx->builder); 
+    LLVMBuildBr(ctx->builder, merge_block); 
+
+    LLVMPositionBuilderAtEnd(ctx->builder, merge_block); 
+    LLVMValueRef phi = LLVMBuildPhi(ctx->builder, LLVMInt1TypeInContext(ctx->context), is_and ? "andtemp" : "ortemp"); 
+    LLVMValueRef values[2] = {LLVMConstInt(LLVMInt1TypeInContext(ctx->context), !is_and, false), right}; 
+    LLVMBasicBlockRef blocks[2] = {left_block, right_block}; 
+    LLVMAddIncoming(phi, values, blocks, 2); 
+    return phi; 
+}
+
 static LLVMValueRef code_gen_op(Codegen_ctx *ctx, AST_node* root)
 {
     if (root == NULL)
@@ -12,16 +62,18 @@ static LLVMValueRef code_gen_op(Codegen_ctx *ctx, AST_node* root)
 
     AST_op_node* node = (AST_op_node*) root;
 
+    /* a right side that is safe to evaluate anyway stays branch free */ 
+    if ((node->op_type == OP_AND || node->op_type == OP_OR) && !is_speculatable(node->rhs))
+        return code_gen_short_circuit(ctx, node); 
+
     LLVMValueRef left = code_gen_exp(ctx, node -> lhs); 
     LLVMValueRef right = code_gen_exp(ctx, node -> rhs); 
      
     Type* left_node_type =  ast_exp_type(node -> lhs); 
     Type* right_node_type =  ast_exp_type(node -> rhs); 
 
-    //resolve types
-    Type* node_type = type_resolve_op(left_node_type, right_node_type, node -> op_type) ; 
-
-    node->res_type = op_rel(node -> op_type) ? TYPE_BOOL :node_type; 
+    //resolved by the semantic pass 
+    Type* node_type = node -> operand_type; 
 
     //cast left and right
     LLVMValueRef cleft = code_gen_promote(ctx, left,  left_node_type, node_type); 
@@ -111,8 +163,7 @@ static LLVMValueRef code_gen_op(Codegen_ctx *ctx, AST_node* root)
                 
 
         default: 
-            fprintf(stderr, "Error: bad node not an operation for now only integer operations\n"); 
-            exit(3); 
+            error_fatal(3, "Error: bad node not an operation for now only integer operations\n"); 
             
     }
     return NULL; 
@@ -120,63 +171,87 @@ static LLVMValueRef code_gen_op(Codegen_ctx *ctx, AST_node* root)
 
 static LLVMValueRef code_gen_call(Codegen_ctx *ctx, AST_node* root)
 {
-    size_t args_count = 0; 
-    Type** args_type = NULL; 
-    LLVMValueRef* args_val = NULL; 
+    Vector args_val; 
     AST_call_node* call = (AST_call_node*)root; 
     AST_args_node* args = (AST_args_node*)call->args; 
 
+    VEC_init(&args_val, NULL); 
     if (args != NULL)
     {
-        args_count = LL_size(args->args_list); 
-        args_type = malloc(args_count * sizeof(Type*)); 
-        args_val = malloc(args_count * sizeof(LLVMValueRef)); 
-        size_t index = 0; 
-        LL_FOR_EACH(args->args_list, ll_node)
+        VEC_FOR_EACH(&args->args_list, item)
         {
-            AST_arg_node* arg = ll_node->data; 
-            args_val[index] = code_gen_exp(ctx, arg->exp); 
-            args_type[index] = ast_exp_type(arg->exp); 
-            index++; 
+            AST_arg_node* arg = item; 
+            VEC_push_back(&args_val, code_gen_exp(ctx, arg->exp)); 
         }
     }
+    size_t args_count = VEC_size(&args_val); 
 
-    /* search the function in the symbol table */ 
-    char* fun_name = ((AST_id_node*)call->id_node)->id_str; 
-    St_entry* fn_entry = find_fun(ctx, fun_name, args_type, args_count); 
-    if (!fn_entry)
+    /* the semantic pass picked the overload, find its llvm function */ 
+    Function_type* fun_type = (Function_type*)call->fun_type; 
+    if (!call->callee)
     {
-        fprintf(stderr, "Error: %s function is not declared or args does not match\n", fun_name); 
-        exit(3); 
+        /* builtins are generated in place */ 
+        const Builtin_prototype* builtin = builtins_find(((AST_id_node*)call->id_node)->id, 
+                                                         fun_type->param_types, fun_type->param_count); 
+        LLVMValueRef result = builtins_emit(ctx->builder, builtin, (LLVMValueRef*)VEC_data(&args_val)); 
+        VEC_free(&args_val); 
+        return result; 
     }
+    St_entry* fn_entry = find_fun(ctx, ((AST_id_node*)call->id_node)->id, fun_type->param_types, fun_type->param_count); 
 
-    LLVMValueRef result =  LLVMBuildCall2(ctx->builder, fn_entry->type_ref, fn_entry->value_ref, args_val, args_count, "calltemp"); 
-
-    call->fun_type = fn_entry->type; 
-    call->ret_type = ((Function_type*)call->fun_type)->return_type; 
+    LLVMValueRef result =  LLVMBuildCall2(ctx->builder, fn_entry->type_ref, fn_entry->value_ref, 
+                                (LLVMValueRef*)VEC_data(&args_val), args_count, "calltemp"); 
 
     /* clean up */ 
-    free(args_val); 
-    free(args_type); 
+    VEC_free(&args_val); 
     return result; 
 }
 
-static LLVMValueRef code_gen_arr_sub(Codegen_ctx *ctx, AST_node* root)
+/* the array of a subscript, narrowed ones have their storage type in type_ref */ 
+static St_entry* subscripted_entry(Codegen_ctx *ctx, AST_node* id_node)
+{
+    return find_var(ctx, ((AST_id_node*)id_node)->id); 
+}
+
+LLVMTypeRef code_gen_narrowed_elem(Codegen_ctx *ctx, AST_node* lval)
+{
+    AST_node* id_node; 
+    if (lval->type == NODE_ARR_SUB)
+        id_node = ((AST_arr_sub_node*)lval)->id_node; 
+    else if (lval->type == NODE_MAT_SUB)
+        id_node = ((AST_mat_sub_node*)lval)->id_node; 
+    else 
+        return NULL; 
+
+    LLVMTypeRef storage = subscripted_entry(ctx, id_node)->type_ref; 
+    if (!storage)
+        return NULL; 
+    storage = LLVMGetElementType(storage); 
+    if (lval->type == NODE_MAT_SUB)
+        storage = LLVMGetElementType(storage); 
+    return storage; 
+}
+
+/* narrowed elements are sign extended back to an entier */ 
+static LLVMValueRef load_elem(Codegen_ctx *ctx, AST_node* root, Type* elem_type)
 {
     LLVMValueRef elem_ptr = code_gen_lval(ctx, root); 
-    return LLVMBuildLoad2(ctx->builder, 
-            type_to_llvm_type(((AST_arr_sub_node*)root)->elem_type), 
-            elem_ptr, 
-            "loaded_elem"); 
+    LLVMTypeRef narrowed = code_gen_narrowed_elem(ctx, root); 
+    if (!narrowed)
+        return LLVMBuildLoad2(ctx->builder, code_gen_llvm_type(ctx, elem_type), elem_ptr, "loaded_elem"); 
+
+    LLVMValueRef value = LLVMBuildLoad2(ctx->builder, narrowed, elem_ptr, "loaded_elem"); 
+    return LLVMBuildSExt(ctx->builder, value, code_gen_llvm_type(ctx, elem_type), "widened_elem"); 
+}
+
+static LLVMValueRef code_gen_arr_sub(Codegen_ctx *ctx, AST_node* root)
+{
+    return load_elem(ctx, root, ((AST_arr_sub_node*)root)->elem_type); 
 }
 
 static LLVMValueRef code_gen_mat_sub(Codegen_ctx *ctx, AST_node* root)
 {
-    LLVMValueRef elem_ptr = code_gen_lval(ctx, root); 
-    return LLVMBuildLoad2(ctx->builder, 
-            type_to_llvm_type(((AST_mat_sub_node*)root)->elem_type), 
-            elem_ptr, 
-            "loaded_elem"); 
+    return load_elem(ctx, root, ((AST_mat_sub_node*)root)->elem_type); 
 }
 
 LLVMValueRef code_gen_exp(Codegen_ctx *ctx, AST_node* root)
@@ -192,20 +267,19 @@ LLVMValueRef code_gen_exp(Codegen_ctx *ctx, AST_node* root)
                 switch (node -> val_type)
                 {
                     case VAL_INT: 
-                        const_ret = LLVMConstInt(LLVMInt32Type(), node -> value.ival, true); 
+                        const_ret = LLVMConstInt(LLVMInt32TypeInContext(ctx->context), node -> value.ival, true); 
                     break; 
                     case VAL_FLOAT: 
-                        const_ret = LLVMConstReal(LLVMFloatType(), node -> value.fval); 
+                        const_ret = LLVMConstReal(LLVMFloatTypeInContext(ctx->context), node -> value.fval); 
                     break; 
                     case VAL_BOOL: 
-                        const_ret = LLVMConstInt(LLVMInt1Type(), node -> value.bval, false); 
+                        const_ret = LLVMConstInt(LLVMInt1TypeInContext(ctx->context), node -> value.bval, false); 
                     break; 
                     case VAL_CHAR: 
-                        const_ret = LLVMConstInt(LLVMInt8Type(), node -> value.cval, false); 
+                        const_ret = LLVMConstInt(LLVMInt8TypeInContext(ctx->context), node -> value.cval, false); 
                     break; 
                     default: 
-                        fprintf(stderr, "bad expression node\n"); 
-                        exit(3); 
+                        error_fatal(3, "bad expression node\n"); 
                     break; 
                 }
                 return const_ret; 
@@ -213,16 +287,9 @@ LLVMValueRef code_gen_exp(Codegen_ctx *ctx, AST_node* root)
         case NODE_ID:
             {
                 AST_id_node* node = (AST_id_node*)root; 
-                St_entry* entry = find_var(ctx, node -> id_str); 
-                if (entry == NULL)
-                {
-                    fprintf(stderr, "Error: %s is not declared\n", node -> id_str);
-                    exit(3); 
-                }
-
-                node -> id_type = entry -> type; 
+                St_entry* entry = find_var(ctx, node -> id); 
 
-                return LLVMBuildLoad2(ctx->builder, type_to_llvm_type(entry -> type), 
+                return LLVMBuildLoad2(ctx->builder, code_gen_llvm_type(ctx, entry -> type), 
                         entry -> value_ref, "loaded_var"); 
             }
         case NODE_OP: 
@@ -234,8 +301,7 @@ LLVMValueRef code_gen_exp(Codegen_ctx *ctx, AST_node* root)
         case NODE_MAT_SUB: 
             return code_gen_mat_sub(ctx, root); 
         default: 
-            fprintf(stderr, "Error: bad ast node not an expression.\n"); 
-            exit(3); 
+            error_fatal(3, "Error: bad ast node not an expression.\n"); 
 
     }
     return NULL; 
@@ -251,13 +317,7 @@ LLVMValueRef code_gen_lval(Codegen_ctx *ctx, AST_node* root)
         case NODE_ID: 
         {
             AST_id_node* node = (AST_id_node*)root; 
-            St_entry* entry = find_var(ctx, node -> id_str); 
-            if (entry == NULL)
-            {
-                fprintf(stderr, "Error: %s is not declared\n", node -> id_str);
-                exit(3); 
-            }
-            node -> id_type = entry -> type; 
+            St_entry* entry = find_var(ctx, node -> id); 
             return entry -> value_ref; 
         }
         break; 
@@ -266,22 +326,12 @@ LLVMValueRef code_gen_lval(Codegen_ctx *ctx, AST_node* root)
 
             AST_arr_sub_node* node = (AST_arr_sub_node*)root; 
             /* find the array from the symbol table */ 
-            LLVMValueRef arr_ref = code_gen_lval(ctx, node->id_node); 
-            Array_type* arr_type = (Array_type*)ast_exp_type(node->id_node); 
-            if (!TYPE_IS_ARRAY((Type*)arr_type))
-            {
-                fprintf(stderr, "%s not an array\n", ((AST_id_node*)node->id_node)->id_str); 
-                exit(3); 
-            }
-            node->elem_type = arr_type->element_type; 
-            LLVMTypeRef llvm_arr_type = type_to_llvm_type((Type*)arr_type); 
-            LLVMValueRef zero = LLVMConstInt(LLVMInt32Type(), 0, false);
+            St_entry* entry = subscripted_entry(ctx, node->id_node); 
+            LLVMValueRef arr_ref = entry->value_ref; 
+            LLVMTypeRef llvm_arr_type = entry->type_ref ? entry->type_ref : code_gen_llvm_type(ctx, entry->type); 
+            LLVMValueRef zero = LLVMConstInt(LLVMInt32TypeInContext(ctx->context), 0, false);
             LLVMValueRef idx[2] = {zero, code_gen_exp(ctx, node->exp)}; 
-            if (!type_equal(ast_exp_type(node->exp), TYPE_INT))
-            {
-                fprintf(stderr, "index must be an integer\n"); 
-                exit(3); 
-           }
+            code_gen_bounds_check(ctx, root, 0, idx[1]); 
             return LLVMBuildGEP2(ctx->builder, llvm_arr_type, arr_ref, idx, 2, "arr_sub_item"); 
         }
         break; 
@@ -289,33 +339,18 @@ LLVMValueRef code_gen_lval(Codegen_ctx *ctx, AST_node* root)
         {
             AST_mat_sub_node* node = (AST_mat_sub_node*)root; 
             /* find the matrix from the symbol table */ 
-            LLVMValueRef mat_ref = code_gen_lval(ctx, node->id_node); 
-            Matrix_type* mat_type = (Matrix_type*)ast_exp_type(node->id_node); 
-            if (!TYPE_IS_MATRIX((Type*)mat_type))
-            {
-                fprintf(stderr, "%s not a matrix\n", ((AST_id_node*)node->id_node)->id_str); 
-                exit(3); 
-            }
-            node->elem_type = mat_type->element_type;
-            LLVMTypeRef llvm_mat_type = type_to_llvm_type((Type*)mat_type); 
-            LLVMValueRef zero = LLVMConstInt(LLVMInt32Type(), 0, false);
+            St_entry* entry = subscripted_entry(ctx, node->id_node); 
+            LLVMValueRef mat_ref = entry->value_ref; 
+            LLVMTypeRef llvm_mat_type = entry->type_ref ? entry->type_ref : code_gen_llvm_type(ctx, entry->type); 
+            LLVMValueRef zero = LLVMConstInt(LLVMInt32TypeInContext(ctx->context), 0, false);
             LLVMValueRef idx[3] = {zero, code_gen_exp(ctx, node->exp[0]), code_gen_exp(ctx, node->exp[1])}; 
-            if (!type_equal(ast_exp_type(node->exp[0]), TYPE_INT))
-            {
-                fprintf(stderr, "index must be an integer\n"); 
-                exit(3); 
-           }
-            if (!type_equal(ast_exp_type(node->exp[1]), TYPE_INT))
-            {
-                fprintf(stderr, "index must be an integer\n"); 
-                exit(3); 
-           }
+            code_gen_bounds_check(ctx, root, 0, idx[1]); 
+            code_gen_bounds_check(ctx, root, 1, idx[2]); 
             return LLVMBuildGEP2(ctx->builder, llvm_mat_type, mat_ref, idx, 3, "mat_sub_item"); 
         }
         break; 
         default: 
-            fprintf(stderr, "Not an lvalue\n"); 
-            exit(3); 
+            error_fatal(3, "Not an lvalue\n"); 
     }
 
 }
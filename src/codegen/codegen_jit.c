@@ -0,0 +1,359 @@
+#include <time.h>
+
+#include <llvm-c/LLJIT.h>
+#include <llvm-c/Orc.h>
+#include <llvm-c/Transforms/PassBuilder.h>
+
+#include <codegen.h>
+#include "runtime/frascal_rt.h"
+
+/* --run executes main in the compiler's process. 
+ * every function but main is reached through a lazy stub: the first call 
+ * cuts the function out of the program (see Jit_group) and compiles it, 
+ * the next ones jump straight to its code. functions that are never called 
+ * are never compiled. a cached program is one object compiled ahead, see 
+ * code_gen_run_object */ 
+
+/* the compiled code of f is f$body, f is the stub the callers jump to */ 
+#define JIT_BODY_SUFFIX "$body"
+
+/* a part of the program's functions in a module of its own. a request 
+ * splits it in halves until the requested function is alone: reaching one 
+ * function copies the module log n times on sizes that halve, not n times */ 
+typedef struct Jit_group_s {
+    Codegen_ctx* ctx; 
+    LLVMModuleRef module; /* has the bodies of the group's functions, the others are declared */ 
+    char** names;   /* the functions, as named in the module */ 
+    size_t count; 
+} Jit_group; 
+
+static void jit_check(LLVMErrorRef error, const char* what)
+{
+    if (!error)
+        return; 
+    char* message = LLVMGetErrorMessage(error); 
+    fprintf(error_stream(), "Error : %s\n", message); 
+    LLVMDisposeErrorMessage(message); 
+    error_fatal(1, "Error : the jit can't %s\n", what); 
+}
+
+static void* jit_alloc(void* ptr, size_t size)
+{
+    ptr = realloc(ptr, size); 
+    if (!ptr)
+    {
+        fprintf(stderr, "Error: out of memory\n"); 
+        exit(1); 
+    }
+    return ptr; 
+}
+
+static char* jit_strdup(const char* str)
+{
+    size_t size = strlen(str) + 1; 
+    return memcpy(jit_alloc(NULL, size), str, size); 
+}
+
+/* a stub jumps here when its function can't be compiled, under the program's calls */ 
+static void jit_call_through_failed(void)
+{
+    frascal_rt_flush(); 
+    fprintf(stderr, "Error : the jit can't compile a function\n"); 
+    exit(1); 
+}
+
+static char* body_name(const char* name)
+{
+    size_t len = strlen(name); 
+    char* body = jit_alloc(NULL, len + sizeof(JIT_BODY_SUFFIX)); 
+    memcpy(body, name, len); 
+    strcpy(body + len, JIT_BODY_SUFFIX); 
+    return body; 
+}
+
+/* main is called once, by the compiler: it has no stub */ 
+static bool has_stub(const char* name)
+{
+    return strcmp(name, "main") != 0; 
+}
+
+/* declares the functions instead of defining them. 
+ * elim-avail-extern drops the bodies, globaldce what only they used */ 
+static bool drop_bodies(LLVMModuleRef module, char** names, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        LLVMSetLinkage(LLVMGetNamedFunction(module, names[i]), LLVMAvailableExternallyLinkage); 
+
+    LLVMPassBuilderOptionsRef options = LLVMCreatePassBuilderOptions(); 
+    LLVMErrorRef error = LLVMRunPasses(module, "elim-avail-extern,globaldce", NULL, options); 
+    LLVMDisposePassBuilderOptions(options); 
+    if (error)
+        LLVMConsumeError(error); 
+    return error == NULL; 
+}
+
+static void jit_group_free(void* arg)
+{
+    Jit_group* group = arg; 
+    for (size_t i = 0; i < group->count; i++)
+        free(group->names[i]); 
+    free(group->names); 
+    if (group->module)
+        LLVMDisposeModule(group->module); 
+    free(group); 
+}
+
+static void jit_group_fail(Jit_group* group, LLVMOrcMaterializationResponsibilityRef responsibility)
+{
+    LLVMOrcMaterializationResponsibilityFailMaterialization(responsibility); 
+    LLVMOrcDisposeMaterializationResponsibility(responsibility); 
+    jit_group_free(group); 
+}
+
+/* compiles the only function of the group, as name$body when it has a stub */ 
+static void jit_group_emit(Jit_group* group, LLVMOrcMaterializationResponsibilityRef responsibility)
+{
+    if (has_stub(group->names[0]))
+    {
+        /* its recursive calls go straight to the body */ 
+        char* body = body_name(group->names[0]); 
+        LLVMSetValueName2(LLVMGetNamedFunction(group->module, group->names[0]), body, strlen(body)); 
+        free(body); 
+    }
+
+    Codegen_ctx* ctx = group->ctx; 
+    LLVMOrcThreadSafeModuleRef thread_safe = LLVMOrcCreateNewThreadSafeModule(group->module, ctx->jit_context); 
+    group->module = NULL; 
+    jit_group_free(group); 
+    LLVMOrcIRTransformLayerEmit(LLVMOrcLLJITGetIRTransformLayer(ctx->jit), responsibility, thread_safe); 
+}
+
+static LLVMOrcMaterializationUnitRef jit_group_unit(Jit_group* group); 
+
+/* symbol is the compiled code of the function name */ 
+static bool is_body_of(const char* symbol, const char* name)
+{
+    if (!has_stub(name))
+        return strcmp(symbol, name) == 0; 
+    size_t len = strlen(name); 
+    return strncmp(symbol, name, len) == 0 && strcmp(symbol + len, JIT_BODY_SUFFIX) == 0; 
+}
+
+/* a lookup waits on one of the group's functions */ 
+static bool jit_group_requested(Jit_group* group, LLVMOrcSymbolStringPoolEntryRef* requested, size_t requested_count)
+{
+    for (size_t i = 0; i < requested_count; i++)
+    {
+        const char* symbol = LLVMOrcSymbolStringPoolEntryStr(requested[i]); 
+        for (size_t j = 0; j < group->count; j++)
+            if (is_body_of(symbol, group->names[j]))
+                return true; 
+    }
+    return false; 
+}
+
+/* moves the second half of the group's functions to a copy of its module, each keeps its own bodies */ 
+static Jit_group* jit_group_split(Jit_group* group)
+{
+    size_t half = group->count / 2; 
+    Jit_group* second = jit_alloc(NULL, sizeof(Jit_group)); 
+    second->ctx = group->ctx; 
+    second->module = LLVMCloneModule(group->module); 
+    second->count = group->count - half; 
+    second->names = jit_alloc(NULL, second->count * sizeof(char*)); 
+    memcpy(second->names, group->names + half, second->count * sizeof(char*)); 
+    group->count = half; 
+
+    if (!drop_bodies(group->module, second->names, second->count)
+        || !drop_bodies(second->module, group->names, group->count))
+    {
+        jit_group_free(second); 
+        return NULL; 
+    }
+    return second; 
+}
+
+/* called on the first lookup of one of the group's symbols, on the thread that looks it up. 
+ * the group is halved down to the requested function, the halves nobody waits on go back 
+ * to the dylib unmaterialized. a half that is waited on too is materialized right away, 
+ * from within the replace: keeping that rare keeps the nesting shallow */ 
+static void jit_group_materialize(void* arg, LLVMOrcMaterializationResponsibilityRef responsibility)
+{
+    Jit_group* group = arg; 
+    size_t requested_count; 
+    LLVMOrcSymbolStringPoolEntryRef* requested = LLVMOrcMaterializationResponsibilityGetRequestedSymbols(responsibility,
+                                                                                                        &requested_count); 
+    bool failed = false; 
+    while (!failed && group->count > 1)
+    {
+        Jit_group* second = jit_group_split(group); 
+        if (!second)
+        {
+            failed = true; 
+            break; 
+        }
+        if (!jit_group_requested(group, requested, requested_count))
+        {
+            Jit_group* swap = group; 
+            group = second; 
+            second = swap; 
+        }
+
+        /* this runs under the program's calls: errors fail the lookup, they can't unwind */ 
+        LLVMErrorRef error = LLVMOrcMaterializationResponsibilityReplace(responsibility, jit_group_unit(second)); 
+        if (error)
+        {
+            LLVMConsumeError(error); 
+            failed = true; 
+        }
+    }
+    LLVMOrcDisposeSymbols(requested); 
+
+    if (failed)
+        jit_group_fail(group, responsibility); 
+    else 
+        jit_group_emit(group, responsibility); 
+}
+
+static void jit_group_discard(void* arg, LLVMOrcJITDylibRef dylib, LLVMOrcSymbolStringPoolEntryRef symbol)
+{
+    (void)arg; (void)dylib; (void)symbol; 
+}
+
+/* defines the bodies of the group's functions */ 
+static LLVMOrcMaterializationUnitRef jit_group_unit(Jit_group* group)
+{
+    LLVMJITSymbolFlags flags = {LLVMJITSymbolGenericFlagsExported | LLVMJITSymbolGenericFlagsCallable, 0}; 
+    LLVMOrcCSymbolFlagsMapPair* symbols = jit_alloc(NULL, group->count * sizeof(LLVMOrcCSymbolFlagsMapPair)); 
+    for (size_t i = 0; i < group->count; i++)
+    {
+        char* body = has_stub(group->names[i]) ? body_name(group->names[i]) : NULL; 
+        symbols[i].Name = LLVMOrcLLJITMangleAndIntern(group->ctx->jit, body ? body : group->names[i]); 
+        symbols[i].Flags = flags; 
+        free(body); 
+    }
+    LLVMOrcMaterializationUnitRef unit = LLVMOrcCreateCustomMaterializationUnit(group->names[0], group, symbols, group->count, NULL,
+                                                                                jit_group_materialize,
+                                                                                jit_group_discard,
+                                                                                jit_group_free); 
+    free(symbols); 
+    return unit; 
+}
+
+/* one group with the whole program, and a lazy stub for each function but main */ 
+static void jit_define_program(Codegen_ctx *ctx, LLVMOrcJITDylibRef dylib)
+{
+    Jit_group* group = jit_alloc(NULL, sizeof(Jit_group)); 
+    group->ctx = ctx; 
+    group->module = LLVMCloneModule(ctx->module); 
+    group->count = 0; 
+    size_t capacity = 16; 
+    group->names = jit_alloc(NULL, capacity * sizeof(char*)); 
+
+    LLVMJITSymbolFlags flags = {LLVMJITSymbolGenericFlagsExported | LLVMJITSymbolGenericFlagsCallable, 0}; 
+    LLVMOrcCSymbolAliasMapPair* aliases = jit_alloc(NULL, capacity * sizeof(LLVMOrcCSymbolAliasMapPair)); 
+    size_t aliases_count = 0; 
+    for (LLVMValueRef fn = LLVMGetFirstFunction(ctx->module); fn; fn = LLVMGetNextFunction(fn))
+    {
+        if (LLVMIsDeclaration(fn))
+            continue; 
+        if (group->count == capacity)
+        {
+            capacity *= 2; 
+            group->names = jit_alloc(group->names, capacity * sizeof(char*)); 
+            aliases = jit_alloc(aliases, capacity * sizeof(LLVMOrcCSymbolAliasMapPair)); 
+        }
+        const char* name = LLVMGetValueName(fn); 
+        group->names[group->count++] = jit_strdup(name); 
+        if (!has_stub(name))
+            continue; 
+
+        char* body = body_name(name); 
+        aliases[aliases_count].Name = LLVMOrcLLJITMangleAndIntern(ctx->jit, name); 
+        aliases[aliases_count].Entry.Name = LLVMOrcLLJITMangleAndIntern(ctx->jit, body); 
+        aliases[aliases_count].Entry.Flags = flags; 
+        aliases_count++; 
+        free(body); 
+    }
+
+    jit_check(LLVMOrcJITDylibDefine(dylib, jit_group_unit(group)), "define the program"); 
+    if (aliases_count)
+        jit_check(LLVMOrcJITDylibDefine(dylib, LLVMOrcLazyReexports(ctx->jit_call_through, ctx->jit_stubs, dylib,
+                                                                    aliases, aliases_count)),
+                  "define the lazy stubs"); 
+    free(aliases); 
+}
+
+/* the runtime is part of the compiler, the programs call the compiler's copy. 
+ * anything else (libm, memcpy) is looked up in the process */ 
+static void jit_define_runtime(Codegen_ctx *ctx, LLVMOrcJITDylibRef dylib)
+{
+    LLVMOrcDefinitionGeneratorRef process; 
+    jit_check(LLVMOrcCreateDynamicLibrarySearchGeneratorForProcess(&process, LLVMOrcLLJITGetGlobalPrefix(ctx->jit), NULL, NULL),
+              "search the process"); 
+    LLVMOrcJITDylibAddGenerator(dylib, process); 
+
+    LLVMJITCSymbolMapPair symbols[RT_FN_NB]; 
+    LLVMJITSymbolFlags flags = {LLVMJITSymbolGenericFlagsExported | LLVMJITSymbolGenericFlagsCallable, 0}; 
+    for (size_t i = 0; i < RT_FN_NB; i++)
+    {
+        symbols[i].Name = LLVMOrcLLJITMangleAndIntern(ctx->jit, code_gen_runtime_name(i)); 
+        symbols[i].Sym.Address = (LLVMOrcExecutorAddress)code_gen_runtime_address(i); 
+        symbols[i].Sym.Flags = flags; 
+    }
+    jit_check(LLVMOrcJITDylibDefine(dylib, LLVMOrcAbsoluteSymbols(symbols, RT_FN_NB)), "define the runtime"); 
+}
+
+static void jit_create(Codegen_ctx *ctx)
+{
+    LLVMOrcLLJITBuilderRef builder = LLVMOrcCreateLLJITBuilder(); 
+    LLVMOrcLLJITBuilderSetJITTargetMachineBuilder(builder,
+        LLVMOrcJITTargetMachineBuilderCreateFromTargetMachine(code_gen_create_target_machine(ctx->opt_level))); 
+    jit_check(LLVMOrcCreateLLJIT(&ctx->jit, builder), "start"); 
+
+    const char* triple = LLVMOrcLLJITGetTripleString(ctx->jit); 
+    jit_check(LLVMOrcCreateLocalLazyCallThroughManager(triple, LLVMOrcLLJITGetExecutionSession(ctx->jit),
+                                                       (LLVMOrcJITTargetAddress)(uintptr_t)jit_call_through_failed,
+                                                       &ctx->jit_call_through),
+              "create the lazy stubs"); 
+    ctx->jit_stubs = LLVMOrcCreateLocalIndirectStubsManager(triple); 
+
+    LLVMSetTarget(ctx->module, triple); 
+    LLVMSetDataLayout(ctx->module, LLVMOrcLLJITGetDataLayoutStr(ctx->jit)); 
+}
+
+/* compiles main if it isn't yet, its callees are only stubs until they run */ 
+static int jit_run_main(Codegen_ctx *ctx, double* run_seconds)
+{
+    LLVMOrcExecutorAddress address; 
+    jit_check(LLVMOrcLLJITLookup(ctx->jit, &address, "main"), "find main"); 
+    int (*program_main)(void) = (int (*)(void))address; 
+
+    struct timespec start, end; 
+    clock_gettime(CLOCK_MONOTONIC, &start); 
+    int status = program_main(); 
+    frascal_rt_flush(); 
+    clock_gettime(CLOCK_MONOTONIC, &end); 
+
+    *run_seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9; 
+    return status; 
+}
+
+int code_gen_run(Codegen_ctx *ctx, double* run_seconds)
+{
+    jit_create(ctx); 
+    LLVMOrcJITDylibRef dylib = LLVMOrcLLJITGetMainJITDylib(ctx->jit); 
+    jit_define_runtime(ctx, dylib); 
+
+    jit_define_program(ctx, dylib); 
+    return jit_run_main(ctx, run_seconds); 
+}
+
+int code_gen_run_object(Codegen_ctx *ctx, LLVMMemoryBufferRef object, double* run_seconds)
+{
+    jit_create(ctx); 
+    LLVMOrcJITDylibRef dylib = LLVMOrcLLJITGetMainJITDylib(ctx->jit); 
+    jit_define_runtime(ctx, dylib); 
+    jit_check(LLVMOrcLLJITAddObjectFile(ctx->jit, dylib, object), "load the object"); 
+    return jit_run_main(ctx, run_seconds); 
+}
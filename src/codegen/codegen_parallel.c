@@ -0,0 +1,158 @@
+#include <codegen.h> 
+#include <llvm-c/BitReader.h>
+#include <llvm-c/BitWriter.h>
+#include <llvm-c/Linker.h>
+
+#include "parallel.h"
+
+/* the function bodies are generated on worker threads, each run of 
+ * consecutive functions in its own llvm context and module. the modules 
+ * travel back as bitcode and are linked into the main module in source order. 
+ * the split only depends on the number of functions, so the result is the 
+ * same whatever the number of threads and the scheduling */ 
+
+#define CODEGEN_PARALLEL_CHUNKS 64 /* a module per function costs more than it gains */ 
+
+typedef struct Chunk_job_s {
+    size_t first; 
+    size_t count; 
+
+    /* results */ 
+    LLVMMemoryBufferRef bitcode;    /* NULL if a function failed */ 
+    int status; 
+    char* diagnostics; 
+    size_t diagnostics_size; 
+} Chunk_job; 
+
+typedef struct Parallel_codegen_s {
+    Codegen_ctx* parent; 
+    Intern_pool* names; 
+    AST_function_node** fns; 
+    St_entry** entries;     /* prototypes in the parent's table */ 
+    Chunk_job* chunks; 
+} Parallel_codegen; 
+
+/* errors unwind here, the worker's context is cleaned up by the caller */ 
+static int define_guarded(Error_handler* handler, Codegen_ctx* ctx, Parallel_codegen* codegen, Chunk_job* chunk)
+{
+    int status = setjmp(handler->env); 
+    if (status)
+        return status; 
+
+    for (size_t i = chunk->first; i < chunk->first + chunk->count; i++)
+    {
+        /* a function sees itself and the ones before it, 
+         * its own prototype is imported like a call to itself would */ 
+        St_entry* shared_entry = codegen->entries[i]; 
+        Function_type* fn_type = (Function_type*)shared_entry->type; 
+        ctx->visible_order = shared_entry->order; 
+        St_entry* fn_entry = find_fun(ctx, shared_entry->name, fn_type->param_types, fn_type->param_count); 
+        code_gen_define_function(ctx, codegen->fns[i], fn_entry); 
+    }
+    return 0; 
+}
+
+static void code_gen_chunk_job(void* arg, size_t index)
+{
+    Parallel_codegen* codegen = arg; 
+    Chunk_job* chunk = &codegen->chunks[index]; 
+
+    /* only reads the names, the parent is waiting. the calling thread of 
+     * parallel_for runs jobs too, its own pool and handler are put back after */ 
+    Intern_pool* own_names = intern_pool_current(); 
+    intern_pool_use(codegen->names); 
+
+    Error_handler handler; 
+    handler.out = open_memstream(&chunk->diagnostics, &chunk->diagnostics_size); 
+    if (!handler.out)
+    {
+        perror("open_memstream"); 
+        exit(1); 
+    }
+    Error_handler* own_handler = error_set_handler(&handler); 
+
+    Codegen_ctx ctx; 
+    code_gen_init_worker(&ctx, codegen->parent); 
+
+    chunk->status = define_guarded(&handler, &ctx, codegen, chunk); 
+    if (!chunk->status)
+        chunk->bitcode = LLVMWriteBitcodeToMemoryBuffer(ctx.module); 
+
+    code_gen_cleanup(&ctx); 
+    error_set_handler(own_handler); 
+    fclose(handler.out); 
+    intern_pool_use(own_names); 
+}
+
+void code_gen_subprograms_parallel(Codegen_ctx *ctx, AST_function_node** fns, St_entry** entries, size_t count)
+{
+    size_t chunks_count = count < CODEGEN_PARALLEL_CHUNKS ? count : CODEGEN_PARALLEL_CHUNKS; 
+    Chunk_job* chunks = calloc(chunks_count, sizeof(Chunk_job)); 
+    /* the linker replaces the prototypes, they are found again by name */ 
+    char** llvm_names = calloc(count, sizeof(char*)); 
+    if (!chunks || !llvm_names)
+    {
+        fprintf(stderr, "Error: out of memory\n"); 
+        exit(1); 
+    }
+    for (size_t i = 0; i < chunks_count; i++)
+    {
+        chunks[i].first = count * i / chunks_count; 
+        chunks[i].count = count * (i + 1) / chunks_count - chunks[i].first; 
+    }
+    for (size_t i = 0; i < count; i++)
+        llvm_names[i] = strdup(LLVMGetValueName(entries[i]->value_ref)); 
+
+    Parallel_codegen codegen = {ctx, intern_pool_current(), fns, entries, chunks}; 
+    parallel_for(chunks_count, ctx->codegen_threads, code_gen_chunk_job, &codegen); 
+
+    /* the first failing function in source order is the one reported */ 
+    int status = 0; 
+    char* diagnostics = NULL; 
+    for (size_t i = 0; i < chunks_count && !status; i++)
+    {
+        if (chunks[i].status)
+        {
+            status = chunks[i].status; 
+            diagnostics = chunks[i].diagnostics; 
+            chunks[i].diagnostics = NULL; 
+            continue; 
+        }
+
+        LLVMModuleRef module; 
+        if (LLVMParseBitcodeInContext2(ctx->context, chunks[i].bitcode, &module))
+        {
+            status = 3; 
+            diagnostics = strdup("Error : can't read back a function module\n"); 
+        }
+        /* the source module is destroyed by the link */ 
+        else if (LLVMLinkModules2(ctx->module, module))
+        {
+            status = 3; 
+            diagnostics = strdup("Error : can't link a function module\n"); 
+        }
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!status)
+            entries[i]->value_ref = LLVMGetNamedFunction(ctx->module, llvm_names[i]); 
+        free(llvm_names[i]); 
+    }
+    for (size_t i = 0; i < chunks_count; i++)
+    {
+        if (chunks[i].bitcode)
+            LLVMDisposeMemoryBuffer(chunks[i].bitcode); 
+        free(chunks[i].diagnostics); 
+    }
+    free(llvm_names); 
+    free(chunks); 
+
+    if (status)
+    {
+        /* reported on the parent's stream */ 
+        fputs(diagnostics, error_stream()); 
+        free(diagnostics); 
+        error_unwind(status); 
+    }
+}
@@ -0,0 +1,191 @@
+#include <codegen.h>
+#include "runtime/frascal_rt.h"
+
+/* parameter types of the runtime functions */ 
+typedef enum Rt_param_e {
+    RT_PARAM_VOID, /* return type only */ 
+    RT_PARAM_I32,
+    RT_PARAM_FLOAT,
+    RT_PARAM_BOOL,
+    RT_PARAM_CHAR,
+    RT_PARAM_PTR,
+    RT_PARAM_SIZE,
+} Rt_param; 
+
+#define RT_PARAMS_MAX 2
+
+typedef struct Runtime_prototype_s {
+    const char* name; 
+    Rt_param ret; 
+    Rt_param params[RT_PARAMS_MAX]; 
+    size_t params_count; 
+    bool cold; /* a failure path that doesn't come back */ 
+    void* address; /* the compiler's copy, called by --run */ 
+} Runtime_prototype; 
+
+/* mirrors runtime/frascal_rt.h */ 
+static const Runtime_prototype prototypes[RT_FN_NB] = {
+    [RT_EMIT_INT]    = {"frascal_rt_emit_int", RT_PARAM_VOID, {RT_PARAM_I32}, 1, false, (void*)frascal_rt_emit_int},
+    [RT_EMIT_FLOAT]  = {"frascal_rt_emit_float", RT_PARAM_VOID, {RT_PARAM_FLOAT}, 1, false, (void*)frascal_rt_emit_float},
+    [RT_EMIT_BOOL]   = {"frascal_rt_emit_bool", RT_PARAM_VOID, {RT_PARAM_BOOL}, 1, false, (void*)frascal_rt_emit_bool},
+    [RT_EMIT_CHAR]   = {"frascal_rt_emit_char", RT_PARAM_VOID, {RT_PARAM_CHAR}, 1, false, (void*)frascal_rt_emit_char},
+    [RT_EMIT_STR]    = {"frascal_rt_emit_str", RT_PARAM_VOID, {RT_PARAM_PTR, RT_PARAM_SIZE}, 2, false, (void*)frascal_rt_emit_str},
+    [RT_READ_INT]    = {"frascal_rt_read_int", RT_PARAM_I32, {0}, 0, false, (void*)frascal_rt_read_int},
+    [RT_READ_FLOAT]  = {"frascal_rt_read_float", RT_PARAM_FLOAT, {0}, 0, false, (void*)frascal_rt_read_float},
+    [RT_READ_BOOL]   = {"frascal_rt_read_bool", RT_PARAM_BOOL, {0}, 0, false, (void*)frascal_rt_read_bool},
+    [RT_READ_CHAR]   = {"frascal_rt_read_char", RT_PARAM_CHAR, {0}, 0, false, (void*)frascal_rt_read_char},
+    [RT_BOUNDS_FAIL] = {"frascal_rt_bounds_fail", RT_PARAM_VOID, {RT_PARAM_I32, RT_PARAM_I32}, 2, true, (void*)frascal_rt_bounds_fail},
+}; 
+
+static LLVMTypeRef param_type(Codegen_ctx *ctx, Rt_param param)
+{
+    switch (param)
+    {
+        case RT_PARAM_VOID:  return LLVMVoidTypeInContext(ctx->context); 
+        case RT_PARAM_I32:   return LLVMInt32TypeInContext(ctx->context); 
+        case RT_PARAM_FLOAT: return LLVMFloatTypeInContext(ctx->context); 
+        case RT_PARAM_BOOL:  return LLVMInt1TypeInContext(ctx->context); 
+        case RT_PARAM_CHAR:  return LLVMInt8TypeInContext(ctx->context); 
+        case RT_PARAM_PTR:   return LLVMPointerType(LLVMInt8TypeInContext(ctx->context), 0); 
+        case RT_PARAM_SIZE:  return LLVMInt64TypeInContext(ctx->context); 
+    }
+    return NULL; 
+}
+
+static void add_attribute(Codegen_ctx *ctx, LLVMValueRef fn_ref, LLVMAttributeIndex index, const char* name)
+{
+    unsigned kind = LLVMGetEnumAttributeKindForName(name, strlen(name)); 
+    LLVMAddAttributeAtIndex(fn_ref, index, LLVMCreateEnumAttribute(ctx->context, kind, 0)); 
+}
+
+LLVMValueRef code_gen_runtime_fn(Codegen_ctx *ctx, Runtime_fn fn)
+{
+    if (ctx->runtime_refs[fn])
+        return ctx->runtime_refs[fn]; 
+
+    const Runtime_prototype* prot = &prototypes[fn]; 
+    /* declared by the function modules of the workers, linked in since */ 
+    LLVMValueRef linked = LLVMGetNamedFunction(ctx->module, prot->name); 
+    if (linked)
+        return ctx->runtime_refs[fn] = linked; 
+
+    LLVMTypeRef params[RT_PARAMS_MAX]; 
+    for (size_t i = 0; i < prot->params_count; i++)
+        params[i] = param_type(ctx, prot->params[i]); 
+    LLVMTypeRef fn_type = LLVMFunctionType(param_type(ctx, prot->ret), params, prot->params_count, false); 
+    LLVMValueRef fn_ref = LLVMAddFunction(ctx->module, prot->name, fn_type); 
+
+    add_attribute(ctx, fn_ref, LLVMAttributeFunctionIndex, "nounwind"); 
+    if (prot->cold)
+    {
+        add_attribute(ctx, fn_ref, LLVMAttributeFunctionIndex, "cold"); 
+        add_attribute(ctx, fn_ref, LLVMAttributeFunctionIndex, "noreturn"); 
+    }
+    /* the c abi widens bool and char arguments in the caller and results in the callee */ 
+    if (prot->ret == RT_PARAM_BOOL)
+        add_attribute(ctx, fn_ref, LLVMAttributeReturnIndex, "zeroext"); 
+    else if (prot->ret == RT_PARAM_CHAR)
+        add_attribute(ctx, fn_ref, LLVMAttributeReturnIndex, "signext"); 
+    for (size_t i = 0; i < prot->params_count; i++)
+    {
+        if (prot->params[i] == RT_PARAM_BOOL)
+            add_attribute(ctx, fn_ref, i + 1, "zeroext"); 
+        else if (prot->params[i] == RT_PARAM_CHAR)
+            add_attribute(ctx, fn_ref, i + 1, "signext"); 
+        else if (prot->params[i] == RT_PARAM_PTR)
+        {
+            add_attribute(ctx, fn_ref, i + 1, "nocapture"); 
+            add_attribute(ctx, fn_ref, i + 1, "readonly"); 
+        }
+    }
+
+    ctx->runtime_refs[fn] = fn_ref; 
+    return fn_ref; 
+}
+
+const char* code_gen_runtime_name(Runtime_fn fn)
+{
+    return prototypes[fn].name; 
+}
+
+void* code_gen_runtime_address(Runtime_fn fn)
+{
+    return prototypes[fn].address; 
+}
+
+LLVMValueRef code_gen_runtime_call(Codegen_ctx *ctx, Runtime_fn fn, LLVMValueRef* args, unsigned args_count)
+{
+    LLVMValueRef fn_ref = code_gen_runtime_fn(ctx, fn); 
+    return LLVMBuildCall2(ctx->builder, LLVMGlobalGetValueType(fn_ref), fn_ref, args, args_count, ""); 
+}
+
+#define STRINGS_INITIAL_CAPACITY 64 /* must be a power of 2 */ 
+
+static void strings_grow(Codegen_ctx *ctx)
+{
+    size_t capacity = ctx->strings_capacity ? ctx->strings_capacity * 2 : STRINGS_INITIAL_CAPACITY; 
+    Codegen_string* slots = calloc(capacity, sizeof(Codegen_string)); 
+    if (!slots)
+    {
+        fprintf(stderr, "Error: out of memory\n"); 
+        exit(1); 
+    }
+    for (size_t i = 0; i < ctx->strings_capacity; i++)
+    {
+        if (!ctx->strings[i].global)
+            continue; 
+        size_t index = ctx->strings[i].hash & (capacity - 1); 
+        while (slots[index].global)
+            index = (index + 1) & (capacity - 1); 
+        slots[index] = ctx->strings[i]; 
+    }
+
+    free(ctx->strings); 
+    ctx->strings = slots; 
+    ctx->strings_capacity = capacity; 
+}
+
+/* a program prints as many strings as it likes, they are hashed like the identifiers */ 
+LLVMValueRef code_gen_string(Codegen_ctx *ctx, const char* str, size_t len)
+{
+    /* keep the load under 1/2 */ 
+    if (ctx->strings_count * 2 >= ctx->strings_capacity)
+        strings_grow(ctx); 
+
+    uint32_t hash = intern_hash(str, len); 
+    size_t index = hash & (ctx->strings_capacity - 1); 
+    LLVMValueRef global = NULL; 
+    while (ctx->strings[index].global)
+    {
+        Codegen_string* slot = &ctx->strings[index]; 
+        if (slot->hash == hash)
+        {
+            size_t slot_len; 
+            const char* slot_str = LLVMGetAsString(LLVMGetInitializer(slot->global), &slot_len); 
+            if (slot_len == len && memcmp(slot_str, str, len) == 0)
+            {
+                global = slot->global; 
+                break; 
+            }
+        }
+        index = (index + 1) & (ctx->strings_capacity - 1); 
+    }
+
+    if (!global)
+    {
+        LLVMValueRef init = LLVMConstStringInContext(ctx->context, str, len, true); 
+        global = LLVMAddGlobal(ctx->module, LLVMTypeOf(init), "str"); 
+        LLVMSetInitializer(global, init); 
+        LLVMSetGlobalConstant(global, true); 
+        LLVMSetLinkage(global, LLVMPrivateLinkage); 
+        /* the workers' copies can be merged once linked */ 
+        LLVMSetUnnamedAddress(global, LLVMGlobalUnnamedAddr); 
+        LLVMSetAlignment(global, 1); 
+        ctx->strings[index] = (Codegen_string){global, hash}; 
+        ctx->strings_count++; 
+    }
+
+    LLVMValueRef zero = LLVMConstInt(LLVMInt32TypeInContext(ctx->context), 0, false); 
+    LLVMValueRef indices[] = {zero, zero}; 
+    return LLVMConstInBoundsGEP2(LLVMGlobalGetValueType(global), global, indices, 2); 
+}
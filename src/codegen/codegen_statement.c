@@ -1,23 +1,179 @@
 #include "codegen.h"
+#include "runtime/frascal_rt.h"
+
+#define SWITCH_MIN_CASES 3 /* shorter if chains keep their branches */
 
 static void code_gen_for_stmt(Codegen_ctx *ctx, AST_node* root); 
-static void insert_last_block_if_needed(Codegen_ctx *ctx, Linkedlist* buffer); /* helper function for if code gen */ 
+static void insert_last_block_if_needed(Codegen_ctx *ctx, Vector* buffer); /* helper function for if code gen */ 
 static void code_gen_if_stmt(Codegen_ctx *ctx, AST_node* root); 
 static void code_gen_while_stmt(Codegen_ctx *ctx, AST_node* root); 
 static void code_gen_dowhile_stmt(Codegen_ctx *ctx, AST_node* root); 
 static void code_gen_print_stmt(Codegen_ctx *ctx, AST_node* root); 
+static void code_gen_read_stmt(Codegen_ctx *ctx, AST_node* root);
 
 
-static void insert_last_block_if_needed(Codegen_ctx *ctx, Linkedlist* buffer)
+static void insert_last_block_if_needed(Codegen_ctx *ctx, Vector* buffer)
 {
     if (!ctx->current_block_terminated)
     {
         LLVMBasicBlockRef last_block = LLVMGetInsertBlock(ctx->builder);
-        LL_insert_back(buffer, last_block);
+        VEC_push_back(buffer, last_block);
     }
     ctx->current_block_terminated = false;
 }
 
+/* the same value each time it's evaluated, and evaluating it once is as good */
+static bool same_pure_exp(AST_node* a, AST_node* b)
+{
+    if (a->type != b->type)
+        return false;
+    switch (a->type)
+    {
+        case NODE_ID:
+            return ((AST_id_node*)a)->id == ((AST_id_node*)b)->id;
+        case NODE_CONST:
+        {
+            AST_const_node* ca = (AST_const_node*)a;
+            AST_const_node* cb = (AST_const_node*)b;
+            return ca->val_type == cb->val_type && !memcmp(&ca->value, &cb->value, sizeof(Const_value));
+        }
+        case NODE_OP:
+        {
+            AST_op_node* oa = (AST_op_node*)a;
+            AST_op_node* ob = (AST_op_node*)b;
+            if (oa->op_type != ob->op_type || !same_pure_exp(oa->lhs, ob->lhs))
+                return false;
+            return op_unary(oa->op_type) || same_pure_exp(oa->rhs, ob->rhs);
+        }
+        case NODE_ARR_SUB:
+            return same_pure_exp(((AST_arr_sub_node*)a)->id_node, ((AST_arr_sub_node*)b)->id_node)
+                && same_pure_exp(((AST_arr_sub_node*)a)->exp, ((AST_arr_sub_node*)b)->exp);
+        case NODE_MAT_SUB:
+            return same_pure_exp(((AST_mat_sub_node*)a)->id_node, ((AST_mat_sub_node*)b)->id_node)
+                && same_pure_exp(((AST_mat_sub_node*)a)->exp[0], ((AST_mat_sub_node*)b)->exp[0])
+                && same_pure_exp(((AST_mat_sub_node*)a)->exp[1], ((AST_mat_sub_node*)b)->exp[1]);
+        default:
+            /* calls */
+            return false;
+    }
+}
+
+/* cond is discriminant = constant (either way round) on integers or characters */
+static bool case_of(AST_node* cond, AST_node** discriminant, AST_const_node** value)
+{
+    if (cond->type != NODE_OP || ((AST_op_node*)cond)->op_type != OP_EQUAL)
+        return false;
+    AST_op_node* node = (AST_op_node*)cond;
+    if (node->operand_type != TYPE_INT && node->operand_type != TYPE_CHAR)
+        return false;
+
+    AST_node* exp = node->lhs;
+    AST_node* constant = node->rhs;
+    if (exp->type == NODE_CONST)
+    {
+        exp = node->rhs;
+        constant = node->lhs;
+    }
+    /* no promotion on either side */
+    if (constant->type != NODE_CONST || ast_exp_type(constant) != node->operand_type
+            || ast_exp_type(exp) != node->operand_type)
+        return false;
+
+    if (*discriminant && !same_pure_exp(*discriminant, exp))
+        return false;
+    /* a call isn't even equal to itself */
+    if (!*discriminant && !same_pure_exp(exp, exp))
+        return false;
+    *discriminant = exp;
+    *value = (AST_const_node*)constant;
+    return true;
+}
+
+/* every condition of the chain compares the same expression to a constant */
+static AST_node* switch_discriminant(AST_if_node* node)
+{
+    AST_elif_node* elif_node = (AST_elif_node*)node->elif_branches;
+    if (!elif_node || VEC_size(&elif_node->branches_list) + 1 < SWITCH_MIN_CASES)
+        return NULL;
+
+    AST_node* discriminant = NULL;
+    AST_const_node* value;
+    if (!case_of(node->cond, &discriminant, &value))
+        return NULL;
+    VEC_FOR_EACH(&elif_node->branches_list, item)
+    {
+        if (!case_of(((AST_branch_node*)item)->cond, &discriminant, &value))
+            return NULL;
+    }
+    return discriminant;
+}
+
+static bool case_taken(LLVMValueRef switch_ref, LLVMValueRef value)
+{
+    /* operand 0 is the condition, 1 the default, then value and block pairs */
+    unsigned operands = LLVMGetNumOperands(switch_ref);
+    for (unsigned i = 2; i < operands; i += 2)
+    {
+        if (LLVMGetOperand(switch_ref, i) == value)
+            return true;
+    }
+    return false;
+}
+
+static void code_gen_switch_case(Codegen_ctx *ctx, LLVMValueRef switch_ref, AST_node* cond,
+                                 AST_node* action, Vector* merge_buffer)
+{
+    AST_node* discriminant = NULL;
+    AST_const_node* constant;
+    case_of(cond, &discriminant, &constant);
+    LLVMValueRef value = code_gen_exp(ctx, (AST_node*)constant);
+    /* a repeated value never reaches its branch, the first test catches it */
+    if (case_taken(switch_ref, value))
+        return;
+
+    LLVMValueRef current_function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(ctx->builder));
+    LLVMBasicBlockRef case_block = LLVMAppendBasicBlockInContext(ctx->context, current_function, "case_block");
+    LLVMAddCase(switch_ref, value, case_block);
+    LLVMPositionBuilderAtEnd(ctx->builder, case_block);
+    code_gen_stmt(ctx, action);
+    insert_last_block_if_needed(ctx, merge_buffer);
+}
+
+/* the discriminant is evaluated once, a switch picks the branch */
+static void code_gen_switch_stmt(Codegen_ctx *ctx, AST_if_node* node, AST_node* discriminant)
+{
+    AST_elif_node* elif_node = (AST_elif_node*) node->elif_branches;
+
+    Vector merge_buffer;
+    VEC_init(&merge_buffer, NULL);
+
+    LLVMValueRef current_function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(ctx->builder));
+    LLVMBasicBlockRef else_block = LLVMAppendBasicBlockInContext(ctx->context, current_function, "else_block");
+
+    LLVMValueRef disc = code_gen_exp(ctx, discriminant);
+    LLVMValueRef switch_ref = LLVMBuildSwitch(ctx->builder, disc, else_block, VEC_size(&elif_node->branches_list) + 1);
+
+    code_gen_switch_case(ctx, switch_ref, node->cond, node->action, &merge_buffer);
+    VEC_FOR_EACH(&elif_node->branches_list, item)
+    {
+        AST_branch_node* branch_node = (AST_branch_node*)item;
+        code_gen_switch_case(ctx, switch_ref, branch_node->cond, branch_node->action, &merge_buffer);
+    }
+
+    LLVMPositionBuilderAtEnd(ctx->builder, else_block);
+    code_gen_stmt(ctx, node -> else_action);
+    insert_last_block_if_needed(ctx, &merge_buffer);
+
+    LLVMBasicBlockRef merge_block = LLVMAppendBasicBlockInContext(ctx->context, current_function, "merge_block");
+    VEC_FOR_EACH(&merge_buffer, item)
+    {
+        LLVMPositionBuilderAtEnd(ctx->builder, (LLVMBasicBlockRef)item);
+        LLVMBuildBr(ctx->builder, merge_block);
+    }
+    LLVMPositionBuilderAtEnd(ctx->builder, merge_block);
+    VEC_free(&merge_buffer);
+}
+
 static void code_gen_if_stmt(Codegen_ctx *ctx, AST_node* root)
 {
     if (root == NULL)
@@ -25,111 +181,88 @@ static void code_gen_if_stmt(Codegen_ctx *ctx, AST_node* root)
     AST_if_node* node = (AST_if_node*) root;
     AST_elif_node* elif_node = (AST_elif_node*) node->elif_branches;
 
-    Linkedlist* merge_buffer = LL_create_list();
+    AST_node* discriminant = switch_discriminant(node);
+    if (discriminant)
+    {
+        code_gen_switch_stmt(ctx, node, discriminant);
+        return;
+    }
+
+    Vector merge_buffer;
+    VEC_init(&merge_buffer, NULL);
 
     //get the function from the builder position
     LLVMValueRef current_function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(ctx->builder));
 
-    LLVMBasicBlockRef if_block = LLVMAppendBasicBlock(current_function, "if_block");
-    LLVMBasicBlockRef then_block = LLVMAppendBasicBlock(current_function, "then_block");
+    LLVMBasicBlockRef if_block = LLVMAppendBasicBlockInContext(ctx->context, current_function, "if_block");
+    LLVMBasicBlockRef then_block = LLVMAppendBasicBlockInContext(ctx->context, current_function, "then_block");
 
     LLVMBuildBr(ctx->builder, if_block);
 
     LLVMPositionBuilderAtEnd(ctx->builder, then_block);
     code_gen_stmt(ctx, node -> action);
-    insert_last_block_if_needed(ctx, merge_buffer);
+    insert_last_block_if_needed(ctx, &merge_buffer);
     LLVMPositionBuilderAtEnd(ctx->builder, if_block);
 
     LLVMValueRef prev_cond = code_gen_exp(ctx, node -> cond);
-    if (!AST_IS_BOOL_TYPE(node -> cond))
-    {
-        fprintf(stderr,"Error: the condition for the if statement is not a booleen\n");
-        exit(3);
-    }
     LLVMBasicBlockRef prev_then_block = then_block;
 
     if (elif_node != NULL)
     {
-        LL_FOR_EACH(elif_node -> branches_list, ll_node)
+        VEC_FOR_EACH(&elif_node -> branches_list, item)
         {
-            AST_branch_node* branch_node = (AST_branch_node*)ll_node -> data;
+            AST_branch_node* branch_node = (AST_branch_node*)item;
             LLVMBasicBlockRef elif_block =
-                LLVMAppendBasicBlock(current_function, "elif_block");
+                LLVMAppendBasicBlockInContext(ctx->context, current_function, "elif_block");
             LLVMBasicBlockRef then_block =
-                LLVMAppendBasicBlock(current_function, "then_block");
+                LLVMAppendBasicBlockInContext(ctx->context, current_function, "then_block");
 
             LLVMBuildCondBr(ctx->builder, prev_cond, prev_then_block, elif_block);
             LLVMPositionBuilderAtEnd(ctx->builder, then_block);
             code_gen_stmt(ctx, branch_node -> action);
-            insert_last_block_if_needed(ctx, merge_buffer);
+            insert_last_block_if_needed(ctx, &merge_buffer);
             LLVMPositionBuilderAtEnd(ctx->builder, elif_block);
 
             prev_cond = code_gen_exp(ctx, branch_node -> cond);
-            if (!type_equal(ast_exp_type(branch_node -> cond),TYPE_BOOL))
-            {
-                fprintf(stderr,"Error: the condition for the if statement is not a booleen\n");
-                exit(3);
-            }
             prev_then_block = then_block;
         }
     }
 
-    LLVMBasicBlockRef else_block = LLVMAppendBasicBlock(current_function, "else_block");
+    LLVMBasicBlockRef else_block = LLVMAppendBasicBlockInContext(ctx->context, current_function, "else_block");
 
     LLVMBuildCondBr(ctx->builder, prev_cond, prev_then_block, else_block);
 
     LLVMPositionBuilderAtEnd(ctx->builder, else_block);
     code_gen_stmt(ctx, node -> else_action);
-    insert_last_block_if_needed(ctx, merge_buffer);
+    insert_last_block_if_needed(ctx, &merge_buffer);
 
     //mergin all then blocks
-    LLVMBasicBlockRef merge_block = LLVMAppendBasicBlock(current_function, "merge_block");
-    LL_FOR_EACH(merge_buffer, ll_node)
+    LLVMBasicBlockRef merge_block = LLVMAppendBasicBlockInContext(ctx->context, current_function, "merge_block");
+    VEC_FOR_EACH(&merge_buffer, item)
     {
         //cast it back from void* to basicblockref
-        LLVMBasicBlockRef then_block = ll_node -> data;
+        LLVMBasicBlockRef then_block = item;
         LLVMPositionBuilderAtEnd(ctx->builder, then_block);
         LLVMBuildBr(ctx->builder, merge_block);
     }
     LLVMPositionBuilderAtEnd(ctx->builder, merge_block);
-    LL_free_list(&merge_buffer, NULL);
+    VEC_free(&merge_buffer);
 }
 
-static void code_gen_for_stmt(Codegen_ctx *ctx, AST_node* root)
+/* the loop from the counter already stored in iter to to, it leaves to for_end */ 
+static void code_gen_for_loop(Codegen_ctx *ctx, AST_for_node* node, LLVMValueRef iter, LLVMValueRef to, LLVMBasicBlockRef for_end)
 {
-    if (root == NULL)
-        return;
-
-    AST_for_node* node = (AST_for_node*) root;
-
     LLVMValueRef current_function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(ctx->builder));
 
-    LLVMBasicBlockRef for_cond   = LLVMAppendBasicBlock(current_function, "for_cond");
-    LLVMBasicBlockRef for_body   = LLVMAppendBasicBlock(current_function, "for_body");
-    LLVMBasicBlockRef for_inc    = LLVMAppendBasicBlock(current_function, "for_inc");
-    LLVMBasicBlockRef for_end    = LLVMAppendBasicBlock(current_function, "for_end");
-
-
-    //check all variables are integers
-
-    LLVMValueRef iter = code_gen_lval(ctx, node -> iter);
-    LLVMValueRef from = code_gen_exp(ctx, node -> from);
-    LLVMValueRef to   = code_gen_exp(ctx, node -> to);
-    if (!AST_IS_INT_TYPE(node -> iter) || !AST_IS_INT_TYPE(node -> from) || !AST_IS_INT_TYPE(node -> to))
-    {
-        fprintf(stderr,"Error: Can't work with non integers in a for loop\n");
-        exit(3);
-    }
-
-    //initilize the iterator
-    LLVMBuildStore(ctx->builder, from, iter);
+    LLVMBasicBlockRef for_cond   = LLVMAppendBasicBlockInContext(ctx->context, current_function, "for_cond");
+    LLVMBasicBlockRef for_body   = LLVMAppendBasicBlockInContext(ctx->context, current_function, "for_body");
+    LLVMBasicBlockRef for_inc    = LLVMAppendBasicBlockInContext(ctx->context, current_function, "for_inc");
 
     LLVMBuildBr(ctx->builder, for_cond);
-    LLVMPositionBuilderAtEnd(ctx->builder, for_cond);
 
     //for loop condition
     LLVMPositionBuilderAtEnd(ctx->builder, for_cond);
-    LLVMValueRef iter_val = LLVMBuildLoad2(ctx->builder, LLVMInt32Type(), iter, "iter_val");
+    LLVMValueRef iter_val = LLVMBuildLoad2(ctx->builder, LLVMInt32TypeInContext(ctx->context), iter, "iter_val");
     LLVMValueRef cond = LLVMBuildICmp(ctx->builder, LLVMIntSLE, iter_val, to, "for_cond");
     LLVMBuildCondBr(ctx->builder, cond, for_body, for_end);
 
@@ -142,9 +275,42 @@ static void code_gen_for_stmt(Codegen_ctx *ctx, AST_node* root)
 
     //increment block
     LLVMPositionBuilderAtEnd(ctx->builder, for_inc);
-    LLVMValueRef next_val = LLVMBuildAdd(ctx->builder, iter_val, LLVMConstInt(LLVMInt32Type(), 1, false), "nextval");
+    LLVMValueRef next_val = LLVMBuildAdd(ctx->builder, iter_val, LLVMConstInt(LLVMInt32TypeInContext(ctx->context), 1, false), "nextval");
     LLVMBuildStore(ctx->builder, next_val, iter);
     LLVMBuildBr(ctx->builder, for_cond); //jump back to the condition
+}
+
+static void code_gen_for_stmt(Codegen_ctx *ctx, AST_node* root)
+{
+    if (root == NULL)
+        return;
+
+    AST_for_node* node = (AST_for_node*) root;
+
+    LLVMValueRef current_function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(ctx->builder));
+
+    LLVMValueRef iter = code_gen_lval(ctx, node -> iter);
+    LLVMValueRef from = code_gen_exp(ctx, node -> from);
+    LLVMValueRef to   = code_gen_exp(ctx, node -> to);
+
+    Bounds_loop* bounds = code_gen_bounds_enter_loop(ctx, node, from, to); 
+
+    //initilize the iterator
+    LLVMBuildStore(ctx->builder, from, iter);
+
+    /* with checks hoisted out of it the loop has a second version, 
+     * checking its body on every iteration: a failing check ends the 
+     * program at its own iteration */ 
+    LLVMBasicBlockRef for_checked = code_gen_bounds_version_loop(ctx, bounds); 
+    LLVMBasicBlockRef for_end = LLVMAppendBasicBlockInContext(ctx->context, current_function, "for_end");
+    code_gen_for_loop(ctx, node, iter, to, for_end); 
+    if (for_checked)
+    {
+        code_gen_bounds_drop_hoisted(bounds); 
+        LLVMPositionBuilderAtEnd(ctx->builder, for_checked); 
+        code_gen_for_loop(ctx, node, iter, to, for_end); 
+    }
+    code_gen_bounds_leave_loop(ctx, bounds); 
 
     //finished the loop
     LLVMPositionBuilderAtEnd(ctx->builder, for_end);
@@ -159,19 +325,14 @@ static void code_gen_while_stmt(Codegen_ctx *ctx, AST_node* root)
 
     LLVMValueRef current_function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(ctx-> builder));
 
-    LLVMBasicBlockRef while_cond   = LLVMAppendBasicBlock(current_function, "while_cond");
-    LLVMBasicBlockRef while_body   = LLVMAppendBasicBlock(current_function, "while_body");
-    LLVMBasicBlockRef while_end    = LLVMAppendBasicBlock(current_function, "while_end");
+    LLVMBasicBlockRef while_cond   = LLVMAppendBasicBlockInContext(ctx->context, current_function, "while_cond");
+    LLVMBasicBlockRef while_body   = LLVMAppendBasicBlockInContext(ctx->context, current_function, "while_body");
+    LLVMBasicBlockRef while_end    = LLVMAppendBasicBlockInContext(ctx->context, current_function, "while_end");
 
     LLVMBuildBr(ctx->builder, while_cond);
     LLVMPositionBuilderAtEnd(ctx->builder, while_cond);
 
     LLVMValueRef cond = code_gen_exp(ctx, node -> cond);
-    if (!AST_IS_BOOL_TYPE(node -> cond))
-    {
-        fprintf(stderr,"Error: the condition for the if statement is not a booleen\n");
-        exit(3);
-    }
     LLVMBuildCondBr(ctx->builder, cond, while_body, while_end);
 
     LLVMPositionBuilderAtEnd(ctx->builder, while_body);
@@ -192,9 +353,9 @@ static void code_gen_dowhile_stmt(Codegen_ctx *ctx, AST_node* root)
 
     LLVMValueRef current_function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(ctx->builder));
 
-    LLVMBasicBlockRef dowhile_body   = LLVMAppendBasicBlock(current_function, "dowhile_body");
-    LLVMBasicBlockRef dowhile_cond   = LLVMAppendBasicBlock(current_function, "dowhile_cond");
-    LLVMBasicBlockRef dowhile_end    = LLVMAppendBasicBlock(current_function, "dowhile_end");
+    LLVMBasicBlockRef dowhile_body   = LLVMAppendBasicBlockInContext(ctx->context, current_function, "dowhile_body");
+    LLVMBasicBlockRef dowhile_cond   = LLVMAppendBasicBlockInContext(ctx->context, current_function, "dowhile_cond");
+    LLVMBasicBlockRef dowhile_end    = LLVMAppendBasicBlockInContext(ctx->context, current_function, "dowhile_end");
 
     LLVMBuildBr(ctx->builder, dowhile_body);
     LLVMPositionBuilderAtEnd(ctx->builder, dowhile_body);
@@ -205,49 +366,90 @@ static void code_gen_dowhile_stmt(Codegen_ctx *ctx, AST_node* root)
 
     LLVMPositionBuilderAtEnd(ctx->builder, dowhile_cond);
     LLVMValueRef cond = code_gen_exp(ctx, node -> cond);
-    if (!AST_IS_BOOL_TYPE(node -> cond))
-    {
-        fprintf(stderr,"Error: the condition for the if statement is not a booleen\n");
-        exit(3);
-    }
     LLVMBuildCondBr(ctx->builder, cond, dowhile_end, dowhile_body);
 
     LLVMPositionBuilderAtEnd(ctx->builder, dowhile_end);
 }
 
-#define FMT_LEN 512
-#define MAX_PRINT_ARGS 128
-static void gen_fmtstr(Type** args_type, size_t args_count, char* fmt_str)
+/* value already has the type of lval */
+static void store_lval(Codegen_ctx *ctx, AST_node* lval, LLVMValueRef lval_ref, LLVMValueRef value)
 {
-    if (args_count >= MAX_PRINT_ARGS)
+    /* the range analysis proved the value fits */
+    LLVMTypeRef narrowed = code_gen_narrowed_elem(ctx, lval);
+    if (narrowed)
+        value = LLVMBuildTrunc(ctx->builder, value, narrowed, "narrowed_elem");
+
+    LLVMBuildStore(ctx->builder, value, lval_ref);
+}
+
+#define PRINT_TEXT_LEN 256
+
+/* constant text waiting to be emitted, the separators and the constant
+ * arguments of an ecrire are written with one call */
+typedef struct Print_text_s {
+    char data[PRINT_TEXT_LEN];
+    size_t len;
+} Print_text;
+
+static void print_text_flush(Codegen_ctx *ctx, Print_text* text)
+{
+    if (text->len == 1)
     {
-        fprintf(stderr, "Error: a big number of arguments\n");
-        exit(3);
+        LLVMValueRef c = LLVMConstInt(LLVMInt8TypeInContext(ctx->context), (unsigned char)text->data[0], false);
+        code_gen_runtime_call(ctx, RT_EMIT_CHAR, &c, 1);
     }
+    else if (text->len > 1)
+    {
+        LLVMValueRef args[] = {code_gen_string(ctx, text->data, text->len),
+                               LLVMConstInt(LLVMInt64TypeInContext(ctx->context), text->len, false)};
+        code_gen_runtime_call(ctx, RT_EMIT_STR, args, 2);
+    }
+    text->len = 0;
+}
 
-    for (size_t i = 0; i < args_count; i++)
+/* len is at most FRASCAL_RT_NUMBER_LEN */
+static char* print_text_reserve(Codegen_ctx *ctx, Print_text* text, size_t len)
+{
+    if (text->len + len > PRINT_TEXT_LEN)
+        print_text_flush(ctx, text);
+    return text->data + text->len;
+}
+
+static void print_text_append(Codegen_ctx *ctx, Print_text* text, char c)
+{
+    *print_text_reserve(ctx, text, 1) = c;
+    text->len++;
+}
+
+/* formats a constant argument the way the runtime would, false for the others */
+static bool print_constant(Codegen_ctx *ctx, Print_text* text, Value_type type, LLVMValueRef value)
+{
+    if (!LLVMIsAConstantInt(value) && !LLVMIsAConstantFP(value))
+        return false;
+
+    char* out = print_text_reserve(ctx, text, FRASCAL_RT_NUMBER_LEN);
+    switch (type)
     {
-        const char* frag = NULL;
-        if (!TYPE_IS_PRIMITIVE(args_type[i]))
+        case VAL_INT:
+            text->len += frascal_rt_format_int(out, (int32_t)LLVMConstIntGetSExtValue(value));
+            return true;
+        case VAL_FLOAT:
         {
-            fprintf(stderr, "Error: can't print non primitive types\n");
-            exit(3);
+            LLVMBool loses_info;
+            text->len += frascal_rt_format_float(out, (float)LLVMConstRealGetDouble(value, &loses_info));
+            return true;
         }
-        switch (((Primitive_type*)args_type[i])->val_type)
-        {
-            case VAL_INT:   frag = "%d"; break;
-        case VAL_FLOAT: frag = "%f"; break;
-            case VAL_BOOL:  frag = "%s"; break;
-            case VAL_CHAR:  frag = "%c"; break;
-            case VAL_ERR:
-                fprintf(stderr, "Error: bad type\n");
-                break;
-        }
-
-        if (i > 0) strncat(fmt_str, " ", FMT_LEN - strlen(fmt_str) - 1);
-        strncat(fmt_str, frag, FMT_LEN - strlen(fmt_str) - 1);
+        case VAL_BOOL:
+            memcpy(out, LLVMConstIntGetZExtValue(value) ? "vrai" : "faux", 4);
+            text->len += 4;
+            return true;
+        case VAL_CHAR:
+            *out = (char)LLVMConstIntGetZExtValue(value);
+            text->len++;
+            return true;
+        default:
+            return false;
     }
-    strncat(fmt_str, "\n", FMT_LEN - strlen(fmt_str) - 1);
 }
 
 static void code_gen_print_stmt(Codegen_ctx *ctx, AST_node* root)
@@ -258,64 +460,72 @@ static void code_gen_print_stmt(Codegen_ctx *ctx, AST_node* root)
     AST_print_node* print = (AST_print_node*)root;
     AST_args_node* args = (AST_args_node*)print->args;
 
-    size_t args_count = 0;
-    Type** args_type = NULL;
-    LLVMValueRef* args_val = NULL;
-
+    /* every argument is evaluated before anything is written,
+     * a call among them may print too */
+    Vector values;
+    VEC_init(&values, NULL);
     if (args != NULL)
     {
-        args_count = LL_size(args->args_list);
-        args_type = malloc(args_count * sizeof(Type*));
-        args_val = malloc(args_count * sizeof(LLVMValueRef));
-        size_t index = 0;
-        LL_FOR_EACH(args->args_list, ll_node)
+        VEC_FOR_EACH(&args->args_list, item)
         {
-            AST_arg_node* arg = ll_node->data;
-            args_val[index] = code_gen_exp(ctx, arg->exp);
-            args_type[index] = ast_exp_type(arg->exp);
-            index++;
+            VEC_push_back(&values, code_gen_exp(ctx, ((AST_arg_node*)item)->exp));
         }
     }
 
-    char fmt_str[FMT_LEN] = {0};
-    gen_fmtstr(args_type, args_count, fmt_str);
-    LLVMValueRef fmt_global = LLVMBuildGlobalStringPtr(ctx->builder, fmt_str, "fmtstr");
+    Print_text text = {.len = 0};
+    for (size_t i = 0; i < VEC_size(&values); i++)
+    {
+        if (i > 0)
+            print_text_append(ctx, &text, ' ');
+
+        LLVMValueRef value = VEC_at(&values, i);
+        AST_arg_node* arg = VEC_at(&args->args_list, i);
+        Value_type type = ((Primitive_type*)ast_exp_type(arg->exp))->val_type;
+        if (print_constant(ctx, &text, type, value))
+            continue;
+
+        print_text_flush(ctx, &text);
+        switch (type)
+        {
+            case VAL_INT:   code_gen_runtime_call(ctx, RT_EMIT_INT, &value, 1); break;
+            case VAL_FLOAT: code_gen_runtime_call(ctx, RT_EMIT_FLOAT, &value, 1); break;
+            case VAL_BOOL:  code_gen_runtime_call(ctx, RT_EMIT_BOOL, &value, 1); break;
+            case VAL_CHAR:  code_gen_runtime_call(ctx, RT_EMIT_CHAR, &value, 1); break;
+            default:
+                fprintf(error_stream(), "Error: bad type\n");
+                break;
+        }
+    }
+    print_text_append(ctx, &text, '\n');
+    print_text_flush(ctx, &text);
 
-    size_t printf_args_count = args_count + 1;
+    VEC_free(&values);
+}
 
-    LLVMValueRef* printf_args = malloc(printf_args_count * sizeof(LLVMValueRef));
-    printf_args[0] = fmt_global;
+/* the values are read one after the other, lire(n, t[n]) subscripts with the n just read */
+static void code_gen_read_stmt(Codegen_ctx *ctx, AST_node* root)
+{
+    AST_read_node* read = (AST_read_node*)root;
 
-    for (size_t i = 0; i < args_count; i++)
+    VEC_FOR_EACH(&((AST_args_node*)read->args)->args_list, item)
     {
-        if (type_equal(args_type[i], TYPE_BOOL))
-        {
-            LLVMValueRef true_str = LLVMBuildGlobalStringPtr(ctx->builder, "vrai", "true_str");
-            LLVMValueRef false_str = LLVMBuildGlobalStringPtr(ctx->builder, "faux", "false_str");
+        AST_node* dest = ((AST_arg_node*)item)->exp;
+        LLVMValueRef dest_ref = code_gen_lval(ctx, dest);
 
-            LLVMValueRef is_true = LLVMBuildICmp(ctx->builder, LLVMIntNE, args_val[i],
-                                    LLVMConstInt(LLVMInt1Type(), 0, 0), "bool_cmp");
-            printf_args[i + 1] = LLVMBuildSelect(ctx->builder, is_true, true_str, false_str, "bool_str");
-        }
-        else if (type_equal(args_type[i], TYPE_FLOAT))
-        {
-            /* cast float to double so printf can print it */
-            LLVMValueRef double_cast = LLVMBuildFPExt(ctx->builder, args_val[i], LLVMDoubleType(), "double_cast_tmp");
-            printf_args[i + 1] = double_cast;
-        }
-        else
+        Runtime_fn read_fn = RT_READ_INT;
+        switch (((Primitive_type*)ast_exp_type(dest))->val_type)
         {
-            printf_args[i + 1] = args_val[i];
+            case VAL_INT:   read_fn = RT_READ_INT; break;
+            case VAL_FLOAT: read_fn = RT_READ_FLOAT; break;
+            case VAL_BOOL:  read_fn = RT_READ_BOOL; break;
+            case VAL_CHAR:  read_fn = RT_READ_CHAR; break;
+            default:
+                fprintf(error_stream(), "Error: bad type\n");
+                break;
         }
-
+        /* straight into the variable or the element, no temporary */
+        store_lval(ctx, dest, dest_ref, code_gen_runtime_call(ctx, read_fn, NULL, 0));
     }
-
-    LLVMBuildCall2(ctx->builder, ctx->printf_type, ctx->printf_ref, printf_args, printf_args_count, "print_calltmp");
-
-    //clean up
-    free(printf_args);
-    free(args_type);
-    free(args_val);
 }
 
 void code_gen_stmt(Codegen_ctx *ctx, AST_node* root)
@@ -326,7 +536,7 @@ void code_gen_stmt(Codegen_ctx *ctx, AST_node* root)
     if (ctx->current_block_terminated)
     {
         LLVMValueRef current_function = LLVMGetBasicBlockParent(LLVMGetInsertBlock(ctx-> builder));
-        LLVMBasicBlockRef cont = LLVMAppendBasicBlock(current_function, "after_ret");
+        LLVMBasicBlockRef cont = LLVMAppendBasicBlockInContext(ctx->context, current_function, "after_ret");
         LLVMPositionBuilderAtEnd(ctx->builder, cont);
 
         ctx->current_block_terminated = false;
@@ -338,9 +548,9 @@ void code_gen_stmt(Codegen_ctx *ctx, AST_node* root)
         case NODE_STATEMENTS:
             {
                 //iterate over every statement in the linked list
-                LL_FOR_EACH(((AST_statements_node*)root) -> stmts_list, ll_node)
+                VEC_FOR_EACH(&((AST_statements_node*)root) -> stmts_list, item)
                 {
-                    code_gen_stmt(ctx, ll_node -> data);
+                    code_gen_stmt(ctx, item);
                 }
             }
             break;
@@ -354,12 +564,8 @@ void code_gen_stmt(Codegen_ctx *ctx, AST_node* root)
                 Type* dest_type = ast_exp_type(node -> dest);
                 Type* exp_type = ast_exp_type(node -> assign_exp);
 
-                Type* assign_type = type_resolve_assign(dest_type, exp_type);
-
-                LLVMValueRef cexp = code_gen_promote(ctx, val_ref, exp_type, assign_type);
-
-
-                LLVMBuildStore(ctx->builder, cexp, dest_ref);
+                LLVMValueRef cexp = code_gen_promote(ctx, val_ref, exp_type, dest_type);
+                store_lval(ctx, node -> dest, dest_ref, cexp);
             }
             break;
         case NODE_IF:
@@ -376,20 +582,8 @@ void code_gen_stmt(Codegen_ctx *ctx, AST_node* root)
             break;
         case NODE_RETURN:
             {
-                if (!ctx->current_fn_ret_type)
-                {
-                    fprintf(stderr,"Error: return statement in void function\n");
-                    exit(3);
-                }
-
                 AST_return_node* node = (AST_return_node*)root;
                 LLVMValueRef ret_ref = code_gen_exp(ctx, node->exp);
-                Type* ret_type = ast_exp_type(node->exp);
-                if (!type_equal(ret_type, ctx->current_fn_ret_type))
-                {
-                    fprintf(stderr,"Error: return statement with wrong type\n");
-                    exit(3);
-                }
 
                 LLVMBuildRet(ctx->builder, ret_ref);
                 ctx->current_block_terminated = true;
@@ -398,9 +592,11 @@ void code_gen_stmt(Codegen_ctx *ctx, AST_node* root)
         case NODE_PRINT:
             code_gen_print_stmt(ctx, root);
             break;
+        case NODE_READ:
+            code_gen_read_stmt(ctx, root);
+            break;
         default:
 
-        fprintf(stderr, "Error : bad ast node not a statement\n");
-        exit(3);
+        error_fatal(3, "Error : bad ast node not a statement\n");
     }
 }
@@ -1,11 +1,8 @@
 #include <codegen.h> 
 
-static void code_gen_function(Codegen_ctx *ctx, AST_node* function); 
-static Type* create_function_type(Codegen_ctx *ctx, AST_function_node* function, Type** param_types, size_t params_count); 
 static LLVMValueRef create_function(Codegen_ctx *ctx, 
                             AST_function_node* fn, 
                             Type** param_types, 
-                            LLVMTypeRef* llvm_param_types, 
                             size_t params_count); 
 
 void code_gen_subprograms(Codegen_ctx *ctx, AST_node* subprograms)
@@ -14,98 +11,127 @@ void code_gen_subprograms(Codegen_ctx *ctx, AST_node* subprograms)
         return;
 
     AST_subprograms_node* node = (AST_subprograms_node*)subprograms;
-    LL_FOR_EACH(node->functions_list, ll_node)
+    size_t count = VEC_size(&node->functions_list); 
+
+    if (ctx->codegen_threads <= 1 || count < 2)
     {
-        AST_node* fn_node = ll_node->data;
-        code_gen_function(ctx, fn_node);
+        /* a function sees itself and the ones before it */ 
+        VEC_FOR_EACH(&node->functions_list, item)
+        {
+            AST_function_node* fn = item;
+            St_entry* fn_entry = code_gen_declare_function(ctx, fn); 
+            code_gen_define_function(ctx, fn, fn_entry);
+        }
+        return; 
     }
+
+    /* every prototype first, the bodies only read them */ 
+    Vector entries; 
+    VEC_init(&entries, NULL); 
+    VEC_FOR_EACH(&node->functions_list, item)
+    {
+        VEC_push_back(&entries, code_gen_declare_function(ctx, item)); 
+    }
+    code_gen_subprograms_parallel(ctx, 
+                                  (AST_function_node**)VEC_data(&node->functions_list), 
+                                  (St_entry**)VEC_data(&entries), 
+                                  count); 
+    VEC_free(&entries); 
 }
 
-static inline Type* create_function_type(Codegen_ctx *ctx, 
-                                  AST_function_node* fn, 
-                                  Type** param_types, 
-                                  size_t params_count)
+static void add_fn_attribute(Codegen_ctx *ctx, LLVMValueRef func_ref, const char* name)
 {
-    ctx->current_fn_ret_type = code_gen_resolve_type(ctx, fn->ret_type);
-    return type_function_create(ctx->current_fn_ret_type, param_types, params_count);
+    unsigned kind = LLVMGetEnumAttributeKindForName(name, strlen(name)); 
+    LLVMAddAttributeAtIndex(func_ref, LLVMAttributeFunctionIndex, LLVMCreateEnumAttribute(ctx->context, kind, 0)); 
+}
 
+/* what effects_analyze proved, lets the optimizer merge and hoist the calls */ 
+static void add_fn_attributes(Codegen_ctx *ctx, LLVMValueRef func_ref, AST_function_node* fn)
+{
+    if (fn->effect == EFFECT_PURE)
+        add_fn_attribute(ctx, func_ref, "readnone"); 
+    else if (fn->effect == EFFECT_READONLY)
+        add_fn_attribute(ctx, func_ref, "readonly"); 
+    /* nothing unwinds, there are no exceptions */ 
+    add_fn_attribute(ctx, func_ref, "nounwind"); 
+    if (fn->willreturn)
+        add_fn_attribute(ctx, func_ref, "willreturn"); 
+    if (fn->norecurse)
+        add_fn_attribute(ctx, func_ref, "norecurse"); 
 }
 
 static LLVMValueRef create_function(Codegen_ctx *ctx, 
                             AST_function_node* fn, 
                             Type** param_types, 
-                            LLVMTypeRef* llvm_param_types, 
                             size_t params_count) 
 {
-    char* fun_name = ((AST_id_node*)fn->id_node)->id_str;
-    Type* func_type = create_function_type(ctx, fn, param_types, params_count); 
-    LLVMTypeRef llvm_func_type
-        = LLVMFunctionType(type_to_llvm_type(ctx->current_fn_ret_type), 
-                           llvm_param_types, 
-                           params_count, 
-                           0);
-    LLVMValueRef func_ref= LLVMAddFunction(ctx->module, fun_name, llvm_func_type);
-    if (st_insert_fun(ctx->global_sym_tab, fun_name, func_type, func_ref, llvm_func_type)
-            == ST_ALREADY_DECLARED)
-    {
-            fprintf(stderr, "Error : function %s defined twice\n", fun_name);
-            exit(3);
-    }
+    Symbol fun_name = ((AST_id_node*)fn->id_node)->id;
+    Type* ret_type = code_gen_resolve_type(fn->ret_type);
+    Type* func_type = type_function_create(ret_type, param_types, params_count); 
+    LLVMTypeRef llvm_func_type = code_gen_llvm_type(ctx, func_type);
+    LLVMValueRef func_ref= LLVMAddFunction(ctx->module, symbol_name(fun_name), llvm_func_type);
+    add_fn_attributes(ctx, func_ref, fn); 
+    st_insert_fun(ctx->sym_tab, fun_name, func_type, func_ref, llvm_func_type);
     return func_ref; 
 }
 
-static void code_gen_function(Codegen_ctx *ctx, AST_node* function)
+St_entry* code_gen_declare_function(Codegen_ctx *ctx, AST_function_node* fn)
 {
-    if (!function)
-        return;
-    AST_function_node* fn = (AST_function_node*)function;
     AST_params_node* params = (AST_params_node*)fn->params;
-    size_t params_count = 0;
-    Type** param_types = NULL;
-    char** param_names = NULL;
-    LLVMTypeRef* llvm_param_types = NULL;
+
+    /* scratch buffer, its storage is passed as is to the symbol table */
+    Vector param_types;
+    VEC_init(&param_types, NULL);
 
     if (params != NULL)
     {
-        params_count = LL_size(params->params_list);
-        param_types = malloc(params_count * sizeof(Type*));
-        param_names = malloc(params_count * sizeof(char*));
-        llvm_param_types = malloc(params_count * sizeof(LLVMTypeRef));
-
-        size_t index = 0;
         /* iterate over every paramater */
-        LL_FOR_EACH(params->params_list, ll_node)
+        VEC_FOR_EACH(&params->params_list, item)
         {
-            AST_param_node* param = ll_node->data;
-
-            param_names[index] = ((AST_id_node*)param->id_node)->id_str;
-            Type* param_type = code_gen_resolve_type(ctx, param->id_type);
-            param_types[index] = param_type;
-            llvm_param_types[index] = type_to_llvm_type(param_types[index]);
-
-            index++;
+            AST_param_node* param = item;
+            VEC_push_back(&param_types, code_gen_resolve_type(param->id_type));
         }
     }
+    size_t params_count = VEC_size(&param_types);
 
     /* create function type and insert it into the global symbol table */
-    LLVMValueRef func_ref = create_function(ctx, 
-                                            fn, 
-                                            param_types, 
-                                            llvm_param_types, 
-                                            params_count); 
+    create_function(ctx, fn, (Type**)VEC_data(&param_types), params_count); 
+    St_entry* fn_entry = st_find_fun(ctx->sym_tab, 
+                                     ((AST_id_node*)fn->id_node)->id, 
+                                     (Type**)VEC_data(&param_types), 
+                                     params_count); 
+
+    VEC_free(&param_types);
+    return fn_entry; 
+}
 
-    /* create a local symbol table */
-    ctx->current_sym_tab = st_create();
+void code_gen_define_function(Codegen_ctx *ctx, AST_function_node* fn, St_entry* fn_entry)
+{
+    AST_params_node* params = (AST_params_node*)fn->params;
+    Function_type* fn_type = (Function_type*)fn_entry->type; 
+    LLVMValueRef func_ref = fn_entry->value_ref; 
+    ctx->current_fn_ret_type = fn_type->return_type; 
+
+    /* open the function scope */
+    st_push_scope(ctx->sym_tab);
 
-    LLVMBasicBlockRef entry = LLVMAppendBasicBlock(func_ref, "entry");
+    LLVMBasicBlockRef entry = LLVMAppendBasicBlockInContext(ctx->context, func_ref, "entry");
     LLVMPositionBuilderAtEnd(ctx->builder, entry);
 
-    LLVMValueRef param_alloca;
-    for (size_t i = 0; i < params_count; i++)
+    if (params != NULL)
     {
-        param_alloca = LLVMBuildAlloca(ctx->builder, llvm_param_types[i], param_names[i]);
-        LLVMBuildStore(ctx->builder, LLVMGetParam(func_ref, i), param_alloca);
-        st_insert_var(ctx->current_sym_tab, param_names[i], param_types[i], param_alloca);
+        size_t i = 0; 
+        VEC_FOR_EACH(&params->params_list, item)
+        {
+            AST_id_node* param_id = (AST_id_node*)((AST_param_node*)item)->id_node;
+            Type* param_type = fn_type->param_types[i];
+            LLVMValueRef param_alloca = LLVMBuildAlloca(ctx->builder, 
+                                                        code_gen_llvm_type(ctx, param_type), 
+                                                        symbol_name(param_id->id));
+            LLVMBuildStore(ctx->builder, LLVMGetParam(func_ref, i), param_alloca);
+            st_insert_var(ctx->sym_tab, param_id->id, param_type, param_alloca);
+            i++; 
+        }
     }
 
     /* populate local sym table */
@@ -114,19 +140,8 @@ static void code_gen_function(Codegen_ctx *ctx, AST_node* function)
     /* generate statments */
     code_gen_stmt(ctx, fn->statements);
 
-    if (!is_block_terminated(ctx))
-    {
-        fprintf(stderr, "Error: missing a return statement\n");
-        exit(3);
-    }
-
-
     /*clean up */
-    free(param_types);
-    free(llvm_param_types);
-    free(param_names);
-    st_free(ctx->current_sym_tab); /* free the local symbol table */
-    ctx->current_sym_tab = NULL;
+    st_pop_scope(ctx->sym_tab); /* drop the locals */
     ctx->current_fn_ret_type = NULL;
     ctx->current_block_terminated = false;
 }
@@ -0,0 +1,127 @@
+#include <pthread.h>
+
+#include <llvm-c/Target.h>
+#include <llvm-c/TargetMachine.h>
+#include <llvm-c/Transforms/PassBuilder.h>
+
+#include <codegen.h>
+
+static pthread_once_t target_once = PTHREAD_ONCE_INIT; 
+
+/* the registry is global, jobs on other threads may ask at the same time */ 
+static void target_init(void)
+{
+    LLVMInitializeNativeTarget(); 
+    LLVMInitializeNativeAsmPrinter(); 
+}
+
+static LLVMCodeGenOptLevel codegen_level(int opt_level)
+{
+    switch (opt_level)
+    {
+        case 0:  return LLVMCodeGenLevelNone; 
+        case 1:  return LLVMCodeGenLevelLess; 
+        case 2:  return LLVMCodeGenLevelDefault; 
+        default: return LLVMCodeGenLevelAggressive; 
+    }
+}
+
+/* the host, with its cpu and features: the programs run where they are compiled */ 
+LLVMTargetMachineRef code_gen_create_target_machine(int opt_level)
+{
+    pthread_once(&target_once, target_init); 
+
+    char* triple = LLVMGetDefaultTargetTriple(); 
+    char* error = NULL; 
+    LLVMTargetRef target; 
+    if (LLVMGetTargetFromTriple(triple, &target, &error))
+    {
+        LLVMDisposeMessage(triple); 
+        error_fatal(1, "Error : %s\n", error); 
+    }
+    char* cpu = LLVMGetHostCPUName(); 
+    char* features = LLVMGetHostCPUFeatures(); 
+    LLVMTargetMachineRef machine = LLVMCreateTargetMachine(target, triple, cpu, features, codegen_level(opt_level),
+                                                           LLVMRelocPIC, LLVMCodeModelDefault); 
+    LLVMDisposeMessage(features); 
+    LLVMDisposeMessage(cpu); 
+    LLVMDisposeMessage(triple); 
+    return machine; 
+}
+
+LLVMTargetMachineRef code_gen_target_machine(Codegen_ctx *ctx)
+{
+    if (!ctx->target_machine)
+        ctx->target_machine = code_gen_create_target_machine(ctx->opt_level); 
+    return ctx->target_machine; 
+}
+
+/* the module's triple and data layout become the machine's */ 
+static LLVMTargetMachineRef code_gen_module_target(Codegen_ctx *ctx)
+{
+    LLVMTargetMachineRef machine = code_gen_target_machine(ctx); 
+    char* triple = LLVMGetTargetMachineTriple(machine); 
+    LLVMSetTarget(ctx->module, triple); 
+    LLVMDisposeMessage(triple); 
+    LLVMTargetDataRef data_layout = LLVMCreateTargetDataLayout(machine); 
+    char* layout = LLVMCopyStringRepOfTargetData(data_layout); 
+    LLVMSetDataLayout(ctx->module, layout); 
+    LLVMDisposeMessage(layout); 
+    LLVMDisposeTargetData(data_layout); 
+    return machine; 
+}
+
+void code_gen_optimize(Codegen_ctx *ctx)
+{
+    if (ctx->opt_level <= 0)
+        return; 
+
+    /* the passes ask the target what's cheap, vector widths first */ 
+    LLVMTargetMachineRef machine = code_gen_module_target(ctx); 
+
+    /* like clang: the vectorizers and the unroller from -O2 on */ 
+    LLVMPassBuilderOptionsRef options = LLVMCreatePassBuilderOptions(); 
+    bool loop_opts = ctx->opt_level >= 2; 
+    LLVMPassBuilderOptionsSetLoopVectorization(options, loop_opts); 
+    LLVMPassBuilderOptionsSetSLPVectorization(options, loop_opts); 
+    LLVMPassBuilderOptionsSetLoopInterleaving(options, loop_opts); 
+    LLVMPassBuilderOptionsSetLoopUnrolling(options, loop_opts); 
+
+    static const char* pipelines[] = {"default<O0>", "default<O1>", "default<O2>", "default<O3>"}; 
+    const char* pipeline = pipelines[ctx->opt_level > 3 ? 3 : ctx->opt_level]; 
+    LLVMErrorRef error = LLVMRunPasses(ctx->module, pipeline, machine, options); 
+    LLVMDisposePassBuilderOptions(options); 
+    if (error)
+    {
+        char* message = LLVMGetErrorMessage(error); 
+        fprintf(error_stream(), "Error : %s\n", message); 
+        LLVMDisposeErrorMessage(message); 
+        error_fatal(1, "Error : the %s pipeline failed\n", pipeline); 
+    }
+}
+
+LLVMMemoryBufferRef code_gen_emit_buffer(Codegen_ctx *ctx, LLVMCodeGenFileType type)
+{
+    LLVMTargetMachineRef machine = code_gen_module_target(ctx); 
+    char* error = NULL; 
+    LLVMMemoryBufferRef buffer; 
+    if (LLVMTargetMachineEmitToMemoryBuffer(machine, ctx->module, type, &error, &buffer))
+        error_fatal(1, "Error : %s\n", error); 
+    return buffer; 
+}
+
+void code_gen_emit_native(Codegen_ctx *ctx, const char* path, LLVMCodeGenFileType type)
+{
+    if (!strcmp(path, "-"))
+    {
+        LLVMMemoryBufferRef buffer = code_gen_emit_buffer(ctx, type); 
+        code_gen_write_stdout(LLVMGetBufferStart(buffer), LLVMGetBufferSize(buffer)); 
+        LLVMDisposeMemoryBuffer(buffer); 
+        return; 
+    }
+
+    LLVMTargetMachineRef machine = code_gen_module_target(ctx); 
+    char* error = NULL; 
+    if (LLVMTargetMachineEmitToFile(machine, ctx->module, (char*)path, type, &error))
+        error_fatal(1, "Error : %s: %s\n", path, error); 
+}
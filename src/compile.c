@@ -0,0 +1,277 @@
+#include "compile.h"
+
+#include <stdio.h> 
+#include <stdlib.h> 
+#include <string.h> 
+#include <errno.h> 
+#include <unistd.h> 
+#include <time.h> 
+
+#include "ast.h" //ast should be included before parser
+#include "parser.h"
+#include "lexer.h"
+#include "semantic.h"
+#include "fold.h"
+#include "effects.h"
+#include "ranges.h"
+#include "codegen.h"
+#include "source.h"
+#include "error.h"
+#include "parallel.h"
+#include "link.h"
+#include "cache.h"
+
+/* what a job holds, released whether it succeeded or not */ 
+typedef struct Compilation_s {
+    Compile_job* job; 
+    Error_handler handler; 
+    yyscan_t scanner; 
+    yypstate* parser; 
+    Source source; 
+    bool mapped; 
+    FILE* in; 
+    Semantic_ctx semantic_ctx; 
+    bool semantic_ready; 
+    Codegen_ctx codegen_ctx; 
+    bool codegen_ready; 
+    AST_node* program; 
+    char temp_object[4096]; /* the object of an executable until it's linked */ 
+    char cache_key[CACHE_KEY_SIZE]; /* set when the object is cached */ 
+} Compilation; 
+
+static void compilation_write(Compilation* unit)
+{
+    Compile_job* job = unit->job; 
+    switch (job->output_kind)
+    {
+        case OUTPUT_IR: 
+            code_gen_write_ir(&unit->codegen_ctx, job->output); 
+            break; 
+        case OUTPUT_BITCODE: 
+            code_gen_write_bitcode(&unit->codegen_ctx, job->output); 
+            break; 
+        case OUTPUT_ASSEMBLY: 
+            code_gen_emit_native(&unit->codegen_ctx, job->output, LLVMAssemblyFile); 
+            break; 
+        case OUTPUT_OBJECT: 
+            code_gen_emit_native(&unit->codegen_ctx, job->output, LLVMObjectFile); 
+            break; 
+        case OUTPUT_EXECUTABLE: 
+            if (!link_temp_file(unit->temp_object, sizeof(unit->temp_object), ".o"))
+                error_fatal(1, "Error: can't create a temporary object: %s\n", strerror(errno)); 
+            code_gen_emit_native(&unit->codegen_ctx, unit->temp_object, LLVMObjectFile); 
+            link_executable(unit->temp_object, job->output); 
+            break; 
+    }
+}
+
+static double seconds_since(const struct timespec* start)
+{
+    struct timespec now; 
+    clock_gettime(CLOCK_MONOTONIC, &now); 
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9; 
+}
+
+/* the object hangs on the source, the compiler and what changes the code it emits. 
+ * objects are for the host that compiled them */ 
+static void compilation_cache_key(Compilation* unit)
+{
+    Compile_job* job = unit->job; 
+    Cache_hash hash; 
+    cache_hash_init(&hash); 
+    cache_hash_add(&hash, unit->source.base, unit->source.size); 
+
+    char flags[32]; 
+    snprintf(flags, sizeof(flags), "-O%d%s", job->opt_level, job->bounds_check ? " --bounds-check" : ""); 
+    cache_hash_add_str(&hash, flags); 
+    char* host[] = {LLVMGetDefaultTargetTriple(), LLVMGetHostCPUName(), LLVMGetHostCPUFeatures()}; 
+    for (size_t i = 0; i < sizeof(host) / sizeof(char*); i++)
+    {
+        cache_hash_add_str(&hash, host[i]); 
+        LLVMDisposeMessage(host[i]); 
+    }
+    cache_hash_key(&hash, unit->cache_key); 
+}
+
+/* lazily compiled functions are compiled while main runs, they count in its time. 
+ * a cached program is compiled whole, its object is stored for the next runs */ 
+static void compilation_execute(Compilation* unit, LLVMMemoryBufferRef object, const struct timespec* start)
+{
+    Codegen_ctx* ctx = &unit->codegen_ctx; 
+    bool hit = object != NULL; 
+    if (!hit && *unit->cache_key)
+    {
+        object = code_gen_emit_buffer(ctx, LLVMObjectFile); 
+        cache_store(unit->cache_key, LLVMGetBufferStart(object), LLVMGetBufferSize(object)); 
+    }
+
+    double run_seconds; 
+    if (object)
+        unit->job->exit_status = code_gen_run_object(ctx, object, &run_seconds); 
+    else 
+        unit->job->exit_status = code_gen_run(ctx, &run_seconds); 
+    double compile_seconds = seconds_since(start) - run_seconds; 
+    if (*unit->cache_key)
+        fprintf(error_stream(), "%-18s %10s\n", "object cache", hit ? "hit" : "miss"); 
+    fprintf(error_stream(), "%-18s %10.3f ms\n", "compile time", compile_seconds * 1e3); 
+    fprintf(error_stream(), "%-18s %10.3f ms\n", "run time", run_seconds * 1e3); 
+}
+
+/* true if the program ran from its cached object, nothing else is left to do */ 
+static bool compilation_run_cached(Compilation* unit, const struct timespec* start)
+{
+    compilation_cache_key(unit); 
+    size_t size; 
+    void* data = cache_load(unit->cache_key, &size); 
+    if (!data)
+        return false; 
+
+    LLVMMemoryBufferRef object = LLVMCreateMemoryBufferWithMemoryRangeCopy(data, size, unit->cache_key); 
+    free(data); 
+    code_gen_init_jit(&unit->codegen_ctx); 
+    unit->codegen_ctx.opt_level = unit->job->opt_level; 
+    unit->codegen_ready = true; 
+    compilation_execute(unit, object, start); 
+    return true; 
+}
+
+static void compilation_run(Compilation* unit)
+{
+    Compile_job* job = unit->job; 
+    struct timespec start; 
+    clock_gettime(CLOCK_MONOTONIC, &start); 
+
+    if (yylex_init(&unit->scanner))
+        error_fatal(1, "Error: can't create the scanner\n"); 
+
+    /* regular files are mapped and scanned in place, 
+     * stdin and anything that can't be mapped is streamed */ 
+    if (job->input == NULL)
+        yyset_in(stdin, unit->scanner); 
+    else if ((unit->mapped = source_map(&unit->source, job->input)))
+        /* the mapping ends with the two NULs flex needs to use it without a copy */ 
+        yy_scan_buffer(unit->source.base, unit->source.size + 2, unit->scanner); 
+    else
+    {
+        if (!(unit->in = fopen(job->input, "r")))
+            error_fatal(1, "%s: %s\n", job->input, strerror(errno)); 
+        yyset_in(unit->in, unit->scanner); 
+    }
+
+    /* hashed before scanning, the scanner writes into the mapping. 
+     * streamed sources aren't cached */ 
+    if (job->run && job->cache && unit->mapped && compilation_run_cached(unit, &start))
+        return; 
+
+    /* streamed input is pushed to the parser token by token as it arrives */ 
+    unit->parser = yypstate_new(); 
+    if (unit->mapped)
+        yypull_parse(unit->parser, unit->scanner, &unit->program); 
+    else 
+        parse_stream(unit->parser, unit->scanner, &unit->program); 
+
+    /* every error is reported by the semantic pass, codegen only lowers */ 
+    semantic_init(&unit->semantic_ctx); 
+    unit->semantic_ready = true; 
+    semantic_check(&unit->semantic_ctx, unit->program); 
+
+    size_t folded = 0; 
+    if (!job->check_only)
+    {
+        /* folding drops the calls that are pure and return */ 
+        effects_analyze(unit->program, job->bounds_check); 
+        folded = fold_program(unit->program, job->bounds_check); 
+        ranges_narrow(unit->program, job->range_report ? error_stream() : NULL); 
+
+        if (job->run)
+            code_gen_init_jit(&unit->codegen_ctx); 
+        else 
+            code_gen_init(&unit->codegen_ctx); 
+        unit->codegen_ctx.codegen_threads = job->codegen_threads; 
+        unit->codegen_ctx.bounds_check = job->bounds_check; 
+        unit->codegen_ctx.opt_level = job->opt_level; 
+        unit->codegen_ready = true; 
+
+        code_gen_ir(&unit->codegen_ctx, unit->program);
+        code_gen_optimize(&unit->codegen_ctx); 
+        if (job->run)
+            compilation_execute(unit, NULL, &start); 
+        else 
+            compilation_write(unit); 
+    }
+
+    if (job->ast_stats)
+    {
+        AST_stats_print(error_stream()); 
+        fprintf(error_stream(), "%-18s %10zu (removed by folding)\n", "folded nodes", folded); 
+    }
+}
+
+/* errors unwind here, the unit itself lives in the caller */ 
+static int compilation_guarded_run(Compilation* unit)
+{
+    int status = setjmp(unit->handler.env); 
+    if (status)
+        return status; 
+
+    compilation_run(unit); 
+    return 0; 
+}
+
+void compile_job(Compile_job* job)
+{
+    Compilation unit; 
+    memset(&unit, 0, sizeof(Compilation)); 
+    unit.job = job; 
+
+    unit.handler.out = open_memstream(&job->diagnostics, &job->diagnostics_size); 
+    if (!unit.handler.out)
+    {
+        perror("open_memstream"); 
+        exit(1); 
+    }
+    error_set_handler(&unit.handler); 
+
+    job->status = compilation_guarded_run(&unit); 
+
+    error_set_handler(NULL); 
+    fclose(unit.handler.out); 
+
+    /* the ast doesn't point into the source */ 
+    if (unit.mapped)
+        source_unmap(&unit.source); 
+    if (unit.in)
+        fclose(unit.in); 
+    if (unit.parser)
+        yypstate_delete(unit.parser); 
+    if (unit.scanner)
+        yylex_destroy(unit.scanner); 
+
+    if (*unit.temp_object)
+        unlink(unit.temp_object); 
+    AST_arena_release(); 
+    intern_release(); 
+    if (unit.codegen_ready)
+        code_gen_cleanup(&unit.codegen_ctx);  
+    if (unit.semantic_ready)
+        semantic_cleanup(&unit.semantic_ctx); 
+    /* the ast annotations and the symbol tables point to the pooled types */ 
+    type_pool_release(); 
+}
+
+void compile_job_free(Compile_job* job)
+{
+    free(job->diagnostics); 
+    job->diagnostics = NULL; 
+    job->diagnostics_size = 0; 
+}
+
+static void compile_job_at(void* jobs, size_t index)
+{
+    compile_job(&((Compile_job*)jobs)[index]); 
+}
+
+void compile_jobs(Compile_job* jobs, size_t count, int workers)
+{
+    parallel_for(count, workers, compile_job_at, jobs); 
+}
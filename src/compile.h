@@ -0,0 +1,43 @@
+#ifndef COMPILE_H
+#define COMPILE_H
+
+#include <stdbool.h> 
+#include <stddef.h> 
+
+/* what a job writes to its output */ 
+typedef enum Output_kind_e {
+    OUTPUT_IR,          /* textual llvm ir, --emit=ll */ 
+    OUTPUT_BITCODE,     /* llvm bitcode, --emit=bc */ 
+    OUTPUT_ASSEMBLY,    /* host assembly, --emit=asm */ 
+    OUTPUT_OBJECT,      /* native object file, --emit=obj or -c */ 
+    OUTPUT_EXECUTABLE,  /* linked with the runtime, -o without -c */ 
+} Output_kind; 
+
+/* one source file to compile, every job has its own scanner, parser, 
+ * ast arena, intern pool and llvm context so jobs can run in parallel */ 
+typedef struct Compile_job_s {
+    const char* input;      /* NULL reads stdin */ 
+    const char* output;     /* where the result is written, "-" is stdout */ 
+    Output_kind output_kind; 
+    bool ast_stats;         /* print the ast memory usage */ 
+    int codegen_threads;    /* generate the subprograms on this many threads */ 
+    bool check_only;        /* stop after the semantic pass, llvm is never touched */ 
+    bool range_report;      /* list the arrays stored on fewer bits */ 
+    bool bounds_check;      /* subscripts out of their array stop the program */ 
+    int opt_level;          /* -O0 to -O3 */ 
+    bool run;               /* --run: execute main in process, nothing is written */ 
+    bool cache;             /* --cache: with run, reuse the object of the same program, see cache.h */ 
+
+    /* results */ 
+    int status;             /* 0, or the exit code of the error that stopped it */ 
+    int exit_status;        /* what main returned, with run */ 
+    char* diagnostics;      /* everything the job reported, NUL terminated */ 
+    size_t diagnostics_size; 
+} Compile_job; 
+
+void compile_job(Compile_job* job); 
+/* runs the jobs on a pool of workers threads, returns once they are all done */ 
+void compile_jobs(Compile_job* jobs, size_t count, int workers); 
+void compile_job_free(Compile_job* job); 
+
+#endif
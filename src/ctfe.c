@@ -0,0 +1,476 @@
+#include "ctfe.h"
+#include "fold.h"
+#include "builtins.h"
+
+typedef struct Ctfe_var_s {
+    Symbol name; 
+    Type* type; 
+    Const_value value; 
+    bool set; /* reading a variable before its first store is undefined */ 
+} Ctfe_var; 
+
+typedef struct Ctfe_frame_s {
+    Ctfe_var* vars; /* the parameters then the locals */ 
+    size_t count; 
+    Const_value ret; 
+} Ctfe_frame; 
+
+typedef struct Ctfe_s {
+    size_t steps; 
+    size_t depth; 
+} Ctfe; 
+
+typedef enum Ctfe_exec_e {
+    EXEC_NEXT,
+    EXEC_RETURN,
+    EXEC_FAIL,
+} Ctfe_exec; 
+
+static bool eval_exp(Ctfe* ctfe, Ctfe_frame* frame, AST_node* exp, Const_value* out); 
+static Ctfe_exec exec_stmt(Ctfe* ctfe, Ctfe_frame* frame, AST_node* stmt); 
+
+static inline Value_type val_type_of(Type* type)
+{
+    return ((Primitive_type*)type)->val_type; 
+}
+
+static inline bool is_primitive_node(AST_node* type_node)
+{
+    return TYPE_IS_PRIMITIVE(((AST_type_node*)type_node)->id_type); 
+}
+
+/* evaluable bodies don't print, don't index and only call evaluable functions */ 
+static bool body_evaluable(AST_node* root)
+{
+    if (!root)
+        return true; 
+
+    switch (root->type)
+    {
+        case NODE_STATEMENTS:
+            VEC_FOR_EACH(&((AST_statements_node*)root)->stmts_list, item)
+            {
+                if (!body_evaluable(item))
+                    return false; 
+            }
+            return true; 
+        case NODE_ASSIGN:
+            return body_evaluable(((AST_assign_node*)root)->dest)
+                && body_evaluable(((AST_assign_node*)root)->assign_exp); 
+        case NODE_IF:
+        {
+            AST_if_node* node = (AST_if_node*)root; 
+            if (!body_evaluable(node->cond) || !body_evaluable(node->action) || !body_evaluable(node->else_action))
+                return false; 
+            if (node->elif_branches)
+            {
+                VEC_FOR_EACH(&((AST_elif_node*)node->elif_branches)->branches_list, item)
+                {
+                    AST_branch_node* branch = item; 
+                    if (!body_evaluable(branch->cond) || !body_evaluable(branch->action))
+                        return false; 
+                }
+            }
+            return true; 
+        }
+        case NODE_FOR:
+        {
+            AST_for_node* node = (AST_for_node*)root; 
+            return body_evaluable(node->from) && body_evaluable(node->to) && body_evaluable(node->statements); 
+        }
+        case NODE_WHILE:
+            return body_evaluable(((AST_while_node*)root)->cond)
+                && body_evaluable(((AST_while_node*)root)->statements); 
+        case NODE_DOWHILE:
+            return body_evaluable(((AST_dowhile_node*)root)->cond)
+                && body_evaluable(((AST_dowhile_node*)root)->statements); 
+        case NODE_RETURN:
+            return body_evaluable(((AST_return_node*)root)->exp); 
+        case NODE_OP:
+            return body_evaluable(((AST_op_node*)root)->lhs) && body_evaluable(((AST_op_node*)root)->rhs); 
+        case NODE_CALL:
+        {
+            AST_call_node* call = (AST_call_node*)root; 
+            if (call->callee && !((AST_function_node*)call->callee)->evaluable)
+                return false; 
+            if (call->args)
+            {
+                VEC_FOR_EACH(&((AST_args_node*)call->args)->args_list, item)
+                {
+                    if (!body_evaluable(((AST_arg_node*)item)->exp))
+                        return false; 
+                }
+            }
+            return true; 
+        }
+        case NODE_CONST:
+        case NODE_ID:
+            return true; 
+        default:
+            /* ecrire, lire, subscripts */ 
+            return false; 
+    }
+}
+
+static bool signature_evaluable(AST_function_node* fn)
+{
+    if (!is_primitive_node(fn->ret_type))
+        return false; 
+    if (fn->params)
+    {
+        VEC_FOR_EACH(&((AST_params_node*)fn->params)->params_list, item)
+        {
+            if (!is_primitive_node(((AST_param_node*)item)->id_type))
+                return false; 
+        }
+    }
+    if (fn->declarations)
+    {
+        VEC_FOR_EACH(&((AST_declarations_node*)fn->declarations)->var_decls_list, item)
+        {
+            if (!is_primitive_node(((AST_var_declaration_node*)item)->id_type))
+                return false; 
+        }
+    }
+    return true; 
+}
+
+void ctfe_analyze(AST_node* program_node)
+{
+    AST_node* subprograms = ((AST_program_node*)program_node)->subprograms; 
+    if (!subprograms)
+        return; 
+    Vector* functions = &((AST_subprograms_node*)subprograms)->functions_list; 
+
+    /* every function is assumed evaluable then the ones that call a
+     * non evaluable function are dropped until nothing changes,
+     * recursive functions stay evaluable */ 
+    VEC_FOR_EACH(functions, item)
+    {
+        AST_function_node* fn = item; 
+        fn->evaluable = signature_evaluable(fn); 
+    }
+
+    bool changed = true; 
+    while (changed)
+    {
+        changed = false; 
+        VEC_FOR_EACH(functions, item)
+        {
+            AST_function_node* fn = item; 
+            if (fn->evaluable && !body_evaluable(fn->statements))
+            {
+                fn->evaluable = false; 
+                changed = true; 
+            }
+        }
+    }
+}
+
+static inline bool step(Ctfe* ctfe)
+{
+    return ++ctfe->steps <= CTFE_MAX_STEPS; 
+}
+
+static Ctfe_var* find_var(Ctfe_frame* frame, Symbol name)
+{
+    if (!frame)
+        return NULL; 
+    for (size_t i = 0; i < frame->count; i++)
+    {
+        if (frame->vars[i].name == name)
+            return &frame->vars[i]; 
+    }
+    return NULL; 
+}
+
+/* the only implicit conversion is int to real */ 
+static Const_value promote(Const_value value, Type* from, Type* to)
+{
+    if (to == TYPE_FLOAT && from == TYPE_INT)
+        value.fval = (float)value.ival; 
+    return value; 
+}
+
+static bool run_function(Ctfe* ctfe, AST_function_node* fn, Const_value* args, Const_value* out)
+{
+    if (ctfe->depth >= CTFE_MAX_DEPTH)
+        return false; 
+
+    AST_params_node* params = (AST_params_node*)fn->params; 
+    AST_declarations_node* decls = (AST_declarations_node*)fn->declarations; 
+    size_t params_count = params ? VEC_size(&params->params_list) : 0; 
+    size_t count = params_count + (decls ? VEC_size(&decls->var_decls_list) : 0); 
+
+    Ctfe_frame frame = { calloc(count ? count : 1, sizeof(Ctfe_var)), count, {0} }; 
+    if (!frame.vars)
+    {
+        fprintf(stderr, "Error: out of memory\n"); 
+        exit(1); 
+    }
+    size_t i = 0; 
+    if (params)
+    {
+        VEC_FOR_EACH(&params->params_list, item)
+        {
+            AST_param_node* param = item; 
+            frame.vars[i].name = ((AST_id_node*)param->id_node)->id; 
+            frame.vars[i].type = ((AST_type_node*)param->id_type)->id_type; 
+            frame.vars[i].value = args[i]; 
+            frame.vars[i].set = true; 
+            i++; 
+        }
+    }
+    if (decls)
+    {
+        VEC_FOR_EACH(&decls->var_decls_list, item)
+        {
+            AST_var_declaration_node* decl = item; 
+            frame.vars[i].name = ((AST_id_node*)decl->id_node)->id; 
+            frame.vars[i].type = ((AST_type_node*)decl->id_type)->id_type; 
+            i++; 
+        }
+    }
+
+    ctfe->depth++; 
+    Ctfe_exec exec = exec_stmt(ctfe, &frame, fn->statements); 
+    ctfe->depth--; 
+
+    free(frame.vars); 
+    if (exec != EXEC_RETURN)
+        return false; 
+    *out = frame.ret; 
+    return true; 
+}
+
+static bool eval_call(Ctfe* ctfe, Ctfe_frame* frame, AST_call_node* call, Const_value* out)
+{
+    if (call->callee && !((AST_function_node*)call->callee)->evaluable)
+        return false; 
+
+    /* overloads are picked by the exact argument types, nothing is promoted */ 
+    Function_type* fn_type = (Function_type*)call->fun_type; 
+    Const_value* args = calloc(fn_type->param_count ? fn_type->param_count : 1, sizeof(Const_value)); 
+    if (!args)
+    {
+        fprintf(stderr, "Error: out of memory\n"); 
+        exit(1); 
+    }
+    bool ok = true; 
+    size_t i = 0; 
+    if (call->args)
+    {
+        VEC_FOR_EACH(&((AST_args_node*)call->args)->args_list, item)
+        {
+            if (!(ok = eval_exp(ctfe, frame, ((AST_arg_node*)item)->exp, &args[i++])))
+                break; 
+        }
+    }
+
+    if (ok && call->callee)
+        ok = run_function(ctfe, (AST_function_node*)call->callee, args, out); 
+    else if (ok)
+    {
+        const Builtin_prototype* builtin = builtins_find(((AST_id_node*)call->id_node)->id, 
+                                                         fn_type->param_types, fn_type->param_count); 
+        ok = builtin && builtins_eval(builtin, args, out); 
+    }
+    free(args); 
+    return ok; 
+}
+
+static bool eval_exp(Ctfe* ctfe, Ctfe_frame* frame, AST_node* exp, Const_value* out)
+{
+    if (!exp || !step(ctfe))
+        return false; 
+
+    switch (exp->type)
+    {
+        case NODE_CONST:
+            *out = ((AST_const_node*)exp)->value; 
+            return true; 
+        case NODE_ID:
+        {
+            Ctfe_var* var = find_var(frame, ((AST_id_node*)exp)->id); 
+            if (!var || !var->set)
+                return false; 
+            *out = var->value; 
+            return true; 
+        }
+        case NODE_OP:
+        {
+            AST_op_node* node = (AST_op_node*)exp; 
+            Const_value l, r = {0}; 
+            if (!eval_exp(ctfe, frame, node->lhs, &l))
+                return false; 
+            l = promote(l, ast_exp_type(node->lhs), node->operand_type); 
+            /* short circuit, like the generated code */ 
+            if ((node->op_type == OP_AND && !l.bval) || (node->op_type == OP_OR && l.bval))
+            {
+                *out = l; 
+                return true; 
+            }
+            if (op_binary(node->op_type))
+            {
+                if (!eval_exp(ctfe, frame, node->rhs, &r))
+                    return false; 
+                r = promote(r, ast_exp_type(node->rhs), node->operand_type); 
+            }
+            return fold_eval_op(node->op_type, val_type_of(node->operand_type), l, r, out); 
+        }
+        case NODE_CALL:
+            return eval_call(ctfe, frame, (AST_call_node*)exp, out); 
+        default:
+            return false; 
+    }
+}
+
+static bool eval_cond(Ctfe* ctfe, Ctfe_frame* frame, AST_node* cond, bool* out)
+{
+    Const_value value; 
+    if (!eval_exp(ctfe, frame, cond, &value))
+        return false; 
+    *out = value.bval; 
+    return true; 
+}
+
+/* same order as the generated loop: the bounds are read once, the
+ * increment starts from the value the condition saw */ 
+static Ctfe_exec exec_for(Ctfe* ctfe, Ctfe_frame* frame, AST_for_node* node)
+{
+    Ctfe_var* iter = find_var(frame, ((AST_id_node*)node->iter)->id); 
+    Const_value from, to; 
+    if (!iter || !eval_exp(ctfe, frame, node->from, &from) || !eval_exp(ctfe, frame, node->to, &to))
+        return EXEC_FAIL; 
+
+    iter->value = from; 
+    iter->set = true; 
+    while (true)
+    {
+        if (!step(ctfe))
+            return EXEC_FAIL; 
+        int value = iter->value.ival; 
+        if (value > to.ival)
+            return EXEC_NEXT; 
+        Ctfe_exec exec = exec_stmt(ctfe, frame, node->statements); 
+        if (exec != EXEC_NEXT)
+            return exec; 
+        iter->value.ival = (int)((unsigned)value + 1u); 
+    }
+}
+
+static Ctfe_exec exec_if(Ctfe* ctfe, Ctfe_frame* frame, AST_if_node* node)
+{
+    bool taken; 
+    if (!eval_cond(ctfe, frame, node->cond, &taken))
+        return EXEC_FAIL; 
+    if (taken)
+        return exec_stmt(ctfe, frame, node->action); 
+
+    if (node->elif_branches)
+    {
+        VEC_FOR_EACH(&((AST_elif_node*)node->elif_branches)->branches_list, item)
+        {
+            AST_branch_node* branch = item; 
+            if (!eval_cond(ctfe, frame, branch->cond, &taken))
+                return EXEC_FAIL; 
+            if (taken)
+                return exec_stmt(ctfe, frame, branch->action); 
+        }
+    }
+    return exec_stmt(ctfe, frame, node->else_action); 
+}
+
+static Ctfe_exec exec_stmt(Ctfe* ctfe, Ctfe_frame* frame, AST_node* root)
+{
+    if (!root)
+        return EXEC_NEXT; 
+    if (!step(ctfe))
+        return EXEC_FAIL; 
+
+    switch (root->type)
+    {
+        case NODE_STATEMENTS:
+            VEC_FOR_EACH(&((AST_statements_node*)root)->stmts_list, item)
+            {
+                Ctfe_exec exec = exec_stmt(ctfe, frame, item); 
+                if (exec != EXEC_NEXT)
+                    return exec; 
+            }
+            return EXEC_NEXT; 
+        case NODE_ASSIGN:
+        {
+            AST_assign_node* node = (AST_assign_node*)root; 
+            Ctfe_var* var = node->dest->type == NODE_ID ? find_var(frame, ((AST_id_node*)node->dest)->id) : NULL; 
+            Const_value value; 
+            if (!var || !eval_exp(ctfe, frame, node->assign_exp, &value))
+                return EXEC_FAIL; 
+            var->value = promote(value, ast_exp_type(node->assign_exp), var->type); 
+            var->set = true; 
+            return EXEC_NEXT; 
+        }
+        case NODE_IF:
+            return exec_if(ctfe, frame, (AST_if_node*)root); 
+        case NODE_FOR:
+            return exec_for(ctfe, frame, (AST_for_node*)root); 
+        case NODE_WHILE:
+        {
+            AST_while_node* node = (AST_while_node*)root; 
+            while (true)
+            {
+                bool taken; 
+                if (!step(ctfe) || !eval_cond(ctfe, frame, node->cond, &taken))
+                    return EXEC_FAIL; 
+                if (!taken)
+                    return EXEC_NEXT; 
+                Ctfe_exec exec = exec_stmt(ctfe, frame, node->statements); 
+                if (exec != EXEC_NEXT)
+                    return exec; 
+            }
+        }
+        case NODE_DOWHILE:
+        {
+            /* repeter ... jusqua cond */ 
+            AST_dowhile_node* node = (AST_dowhile_node*)root; 
+            while (true)
+            {
+                bool done; 
+                if (!step(ctfe))
+                    return EXEC_FAIL; 
+                Ctfe_exec exec = exec_stmt(ctfe, frame, node->statements); 
+                if (exec != EXEC_NEXT)
+                    return exec; 
+                if (!eval_cond(ctfe, frame, node->cond, &done))
+                    return EXEC_FAIL; 
+                if (done)
+                    return EXEC_NEXT; 
+            }
+        }
+        case NODE_RETURN:
+            if (!eval_exp(ctfe, frame, ((AST_return_node*)root)->exp, &frame->ret))
+                return EXEC_FAIL; 
+            return EXEC_RETURN; 
+        default:
+            return EXEC_FAIL; 
+    }
+}
+
+bool ctfe_eval_call(AST_call_node* call, Value_type* val_type, Const_value* value)
+{
+    if (call->callee && !((AST_function_node*)call->callee)->evaluable)
+        return false; 
+    if (call->args)
+    {
+        VEC_FOR_EACH(&((AST_args_node*)call->args)->args_list, item)
+        {
+            if (((AST_arg_node*)item)->exp->type != NODE_CONST)
+                return false; 
+        }
+    }
+
+    Ctfe ctfe = {0, 0}; 
+    if (!eval_call(&ctfe, NULL, call, value))
+        return false; 
+    *val_type = val_type_of(call->ret_type); 
+    return true; 
+}
@@ -0,0 +1,20 @@
+#ifndef CTFE_H
+#define CTFE_H
+
+#include "ast.h"
+
+/* compile time evaluation of the calls to pure functions, the functions 
+ * are interpreted on the annotated ast with the semantics of the generated code */ 
+
+#define CTFE_MAX_STEPS 1000000 /* statements, expressions and loop iterations per evaluated call */ 
+#define CTFE_MAX_DEPTH 256     /* nested calls */ 
+
+/* marks the evaluable functions: primitive parameters, locals and result, 
+ * no ecrire, and calls to builtins or evaluable functions only */ 
+void ctfe_analyze(AST_node* program_node); 
+
+/* evaluates a call with constant arguments, false if the callee isn't 
+ * evaluable, a limit was reached or the call would trap at run time */ 
+bool ctfe_eval_call(AST_call_node* call, Value_type* val_type, Const_value* value); 
+
+#endif
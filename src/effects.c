@@ -0,0 +1,328 @@
+#include <limits.h>
+#include <stdint.h>
+
+#include "effects.h"
+
+/* a pour loop with constant bounds whose body doesn't write the counter */ 
+typedef struct Effects_loop_s {
+    Symbol counter; 
+    int lo; 
+    int hi; 
+    struct Effects_loop_s* outer; 
+} Effects_loop; 
+
+typedef struct Effects_scan_s {
+    AST_function_node* fn; /* the function being scanned */ 
+    Fn_effect effect; 
+    bool recursive; 
+    bool terminates; 
+    bool bounds_check; /* the subscripts are checked at run time */ 
+    Effects_loop* loops; /* the innermost enclosing loop */ 
+} Effects_scan; 
+
+static inline Fn_effect effect_join(Fn_effect a, Fn_effect b)
+{
+    return a > b ? a : b; 
+}
+
+/* a counter assigned by the body of its pour loop may never reach the bound */ 
+bool effects_writes_var(AST_node* root, Symbol name)
+{
+    if (!root)
+        return false; 
+
+    switch (root->type)
+    {
+        case NODE_STATEMENTS:
+            VEC_FOR_EACH(&((AST_statements_node*)root)->stmts_list, item)
+            {
+                if (effects_writes_var(item, name))
+                    return true; 
+            }
+            return false; 
+        case NODE_ASSIGN:
+        {
+            AST_node* dest = ((AST_assign_node*)root)->dest; 
+            return dest->type == NODE_ID && ((AST_id_node*)dest)->id == name; 
+        }
+        case NODE_IF:
+        {
+            AST_if_node* node = (AST_if_node*)root; 
+            if (effects_writes_var(node->action, name) || effects_writes_var(node->else_action, name))
+                return true; 
+            if (node->elif_branches)
+            {
+                VEC_FOR_EACH(&((AST_elif_node*)node->elif_branches)->branches_list, item)
+                {
+                    if (effects_writes_var(((AST_branch_node*)item)->action, name))
+                        return true; 
+                }
+            }
+            return false; 
+        }
+        case NODE_FOR:
+        {
+            AST_for_node* node = (AST_for_node*)root; 
+            return ((AST_id_node*)node->iter)->id == name || effects_writes_var(node->statements, name); 
+        }
+        case NODE_READ:
+            VEC_FOR_EACH(&((AST_args_node*)((AST_read_node*)root)->args)->args_list, item)
+            {
+                AST_node* dest = ((AST_arg_node*)item)->exp; 
+                if (dest->type == NODE_ID && ((AST_id_node*)dest)->id == name)
+                    return true; 
+            }
+            return false; 
+        case NODE_WHILE:
+            return effects_writes_var(((AST_while_node*)root)->statements, name); 
+        case NODE_DOWHILE:
+            return effects_writes_var(((AST_dowhile_node*)root)->statements, name); 
+        default:
+            /* expressions only write the callee's frame */ 
+            return false; 
+    }
+}
+
+/* index is var + offset, or only offset when var is SYMBOL_NONE */ 
+bool effects_index_affine(AST_node* index, Symbol* var, int* offset)
+{
+    switch (index->type)
+    {
+        case NODE_CONST:
+            if (((AST_const_node*)index)->val_type != VAL_INT)
+                return false; 
+            *var = SYMBOL_NONE; 
+            *offset = ((AST_const_node*)index)->value.ival; 
+            return true; 
+        case NODE_ID:
+            *var = ((AST_id_node*)index)->id; 
+            *offset = 0; 
+            return true; 
+        case NODE_OP:
+        {
+            AST_op_node* node = (AST_op_node*)index; 
+            if (node->res_type != TYPE_INT || (node->op_type != OP_ADD && node->op_type != OP_SUB))
+                return false; 
+            AST_node* id = node->lhs; 
+            AST_node* num = node->rhs; 
+            if (node->op_type == OP_ADD && id->type == NODE_CONST)
+            {
+                id = node->rhs; 
+                num = node->lhs; 
+            }
+            if (id->type != NODE_ID || num->type != NODE_CONST || ((AST_const_node*)num)->val_type != VAL_INT)
+                return false; 
+            int value = ((AST_const_node*)num)->value.ival; 
+            if (node->op_type == OP_SUB && value == INT_MIN)
+                return false; 
+            *var = ((AST_id_node*)id)->id; 
+            *offset = node->op_type == OP_SUB ? -value : value; 
+            return true; 
+        }
+        default:
+            return false; 
+    }
+}
+
+static void scan(Effects_scan* scan_ctx, AST_node* root); 
+
+static bool const_int(AST_node* exp, int* value)
+{
+    Symbol var; 
+    return effects_index_affine(exp, &var, value) && var == SYMBOL_NONE; 
+}
+
+/* true if every value of index is proven to be in [0, size) */ 
+static bool index_proven(Effects_scan* scan_ctx, AST_node* index, size_t size)
+{
+    Symbol var; 
+    int offset; 
+    if (!effects_index_affine(index, &var, &offset))
+        return false; 
+    int64_t lo = offset, hi = offset; 
+    if (var != SYMBOL_NONE)
+    {
+        Effects_loop* loop = scan_ctx->loops; 
+        while (loop && loop->counter != var)
+            loop = loop->outer; 
+        if (!loop)
+            return false; 
+        lo += loop->lo; 
+        hi += loop->hi; 
+    }
+    return lo >= 0 && hi < (int64_t)size; 
+}
+
+/* a failed bounds check ends the program, the subscript can't be dropped */ 
+static void scan_index(Effects_scan* scan_ctx, AST_node* index, size_t size)
+{
+    scan(scan_ctx, index); 
+    if (scan_ctx->bounds_check && !index_proven(scan_ctx, index, size))
+    {
+        scan_ctx->effect = EFFECT_ANY; 
+        scan_ctx->terminates = false; 
+    }
+}
+
+static void scan_args(Effects_scan* scan_ctx, AST_node* args)
+{
+    if (!args)
+        return; 
+    VEC_FOR_EACH(&((AST_args_node*)args)->args_list, item)
+    {
+        scan(scan_ctx, ((AST_arg_node*)item)->exp); 
+    }
+}
+
+static void scan_call(Effects_scan* scan_ctx, AST_call_node* call)
+{
+    scan_args(scan_ctx, call->args); 
+
+    /* builtins are pure and return */ 
+    AST_function_node* callee = (AST_function_node*)call->callee; 
+    if (!callee)
+        return; 
+
+    /* a function only calls itself or the ones before it,
+     * so a call back into it can only be a direct one */ 
+    if (callee == scan_ctx->fn)
+    {
+        scan_ctx->recursive = true; 
+        return; 
+    }
+    scan_ctx->effect = effect_join(scan_ctx->effect, callee->effect); 
+    scan_ctx->terminates = scan_ctx->terminates && callee->willreturn; 
+}
+
+static void scan(Effects_scan* scan_ctx, AST_node* root)
+{
+    if (!root)
+        return; 
+
+    switch (root->type)
+    {
+        case NODE_STATEMENTS:
+            VEC_FOR_EACH(&((AST_statements_node*)root)->stmts_list, item)
+            {
+                scan(scan_ctx, item); 
+            }
+            break; 
+        case NODE_ASSIGN:
+            /* the destination is a local, only its subscripts are evaluated */ 
+            scan(scan_ctx, ((AST_assign_node*)root)->dest); 
+            scan(scan_ctx, ((AST_assign_node*)root)->assign_exp); 
+            break; 
+        case NODE_IF:
+        {
+            AST_if_node* node = (AST_if_node*)root; 
+            scan(scan_ctx, node->cond); 
+            scan(scan_ctx, node->action); 
+            scan(scan_ctx, node->else_action); 
+            if (node->elif_branches)
+            {
+                VEC_FOR_EACH(&((AST_elif_node*)node->elif_branches)->branches_list, item)
+                {
+                    scan(scan_ctx, ((AST_branch_node*)item)->cond); 
+                    scan(scan_ctx, ((AST_branch_node*)item)->action); 
+                }
+            }
+            break; 
+        }
+        case NODE_FOR:
+        {
+            AST_for_node* node = (AST_for_node*)root; 
+            Symbol counter = ((AST_id_node*)node->iter)->id; 
+            scan(scan_ctx, node->from); 
+            scan(scan_ctx, node->to); 
+            /* the bounds are read once, the loop ends unless the body
+             * moves the counter or it wraps, up to the largest integer */ 
+            bool writes_counter = effects_writes_var(node->statements, counter); 
+            Effects_loop loop = {counter, 0, 0, scan_ctx->loops}; 
+            bool to_known = const_int(node->to, &loop.hi); 
+            if (!writes_counter && const_int(node->from, &loop.lo) && to_known && loop.lo <= loop.hi)
+                scan_ctx->loops = &loop; 
+            scan(scan_ctx, node->statements); 
+            scan_ctx->loops = loop.outer; 
+            if (writes_counter || !to_known || loop.hi == INT_MAX)
+                scan_ctx->terminates = false; 
+            break; 
+        }
+        case NODE_WHILE:
+            scan(scan_ctx, ((AST_while_node*)root)->cond); 
+            scan(scan_ctx, ((AST_while_node*)root)->statements); 
+            scan_ctx->terminates = false; 
+            break; 
+        case NODE_DOWHILE:
+            scan(scan_ctx, ((AST_dowhile_node*)root)->cond); 
+            scan(scan_ctx, ((AST_dowhile_node*)root)->statements); 
+            scan_ctx->terminates = false; 
+            break; 
+        case NODE_RETURN:
+            scan(scan_ctx, ((AST_return_node*)root)->exp); 
+            break; 
+        case NODE_PRINT:
+            scan_args(scan_ctx, ((AST_print_node*)root)->args); 
+            scan_ctx->effect = EFFECT_ANY; 
+            break; 
+        case NODE_READ:
+            /* consumes the input, like printing it can't be repeated or dropped.
+             * bad input ends the program inside the call */ 
+            scan_args(scan_ctx, ((AST_read_node*)root)->args); 
+            scan_ctx->effect = EFFECT_ANY; 
+            scan_ctx->terminates = false; 
+            break; 
+        case NODE_OP:
+            scan(scan_ctx, ((AST_op_node*)root)->lhs); 
+            scan(scan_ctx, ((AST_op_node*)root)->rhs); 
+            break; 
+        case NODE_CALL:
+            scan_call(scan_ctx, (AST_call_node*)root); 
+            break; 
+        case NODE_ARR_SUB:
+        {
+            AST_arr_sub_node* node = (AST_arr_sub_node*)root; 
+            scan_index(scan_ctx, node->exp, ((Array_type*)ast_exp_type(node->id_node))->size); 
+            break; 
+        }
+        case NODE_MAT_SUB:
+        {
+            AST_mat_sub_node* node = (AST_mat_sub_node*)root; 
+            Matrix_type* type = (Matrix_type*)ast_exp_type(node->id_node); 
+            scan_index(scan_ctx, node->exp[0], type->size[0]); 
+            scan_index(scan_ctx, node->exp[1], type->size[1]); 
+            break; 
+        }
+        default:
+            break; 
+    }
+}
+
+void effects_analyze(AST_node* program_node, bool bounds_check)
+{
+    AST_node* subprograms = ((AST_program_node*)program_node)->subprograms; 
+    if (!subprograms)
+        return; 
+
+    /* callees come first, one pass in declaration order sees them final.
+     * arrays are passed by value and the globals are out of reach,
+     * a function only touches its own frame unless it prints */ 
+    VEC_FOR_EACH(&((AST_subprograms_node*)subprograms)->functions_list, item)
+    {
+        AST_function_node* fn = item; 
+        Effects_scan scan_ctx = {fn, EFFECT_PURE, false, true, bounds_check, NULL}; 
+        scan(&scan_ctx, fn->statements); 
+
+        fn->effect = scan_ctx.effect; 
+        fn->norecurse = !scan_ctx.recursive; 
+        /* the recursion depth isn't bounded */ 
+        fn->willreturn = scan_ctx.terminates && !scan_ctx.recursive; 
+    }
+}
+
+bool effects_call_removable(AST_call_node* call)
+{
+    AST_function_node* callee = (AST_function_node*)call->callee; 
+    if (!callee)
+        return true; 
+    return callee->effect != EFFECT_ANY && callee->willreturn; 
+}
@@ -0,0 +1,22 @@
+#ifndef EFFECTS_H
+#define EFFECTS_H
+
+#include "ast.h"
+
+/* classifies every subprogram over the call graph: its effect (pure,
+ * read only or effectful), whether it can call itself back and whether
+ * it always returns. the codegen turns them into function attributes.
+ * with bounds_check, a subscript that isn't proven in range may end
+ * the program. the tree has to be annotated by the semantic pass */ 
+void effects_analyze(AST_node* program_node, bool bounds_check); 
+
+/* true if the statements assign name, directly or as a pour counter */ 
+bool effects_writes_var(AST_node* stmts, Symbol name); 
+
+/* index is var + offset, or only offset when var is SYMBOL_NONE */ 
+bool effects_index_affine(AST_node* index, Symbol* var, int* offset); 
+
+/* a call that can be dropped when its result isn't used */ 
+bool effects_call_removable(AST_call_node* call); 
+
+#endif
@@ -0,0 +1,35 @@
+#include "error.h"
+
+#include <stdlib.h> 
+#include <stdarg.h> 
+
+static _Thread_local Error_handler* current_handler = NULL; 
+
+Error_handler* error_set_handler(Error_handler* handler)
+{
+    Error_handler* previous = current_handler; 
+    current_handler = handler; 
+    return previous; 
+}
+
+FILE* error_stream(void)
+{
+    return current_handler ? current_handler->out : stderr; 
+}
+
+void error_fatal(int code, const char* format, ...)
+{
+    va_list args; 
+    va_start(args, format); 
+    vfprintf(error_stream(), format, args); 
+    va_end(args); 
+
+    error_unwind(code); 
+}
+
+void error_unwind(int code)
+{
+    if (!current_handler)
+        exit(code); 
+    longjmp(current_handler->env, code); 
+}
@@ -1,6 +1,26 @@
 #ifndef ERROR_H
 #define ERROR_H
 
-/* not implemented yet */
+#include <stdio.h> 
+#include <setjmp.h> 
+
+/* fatal diagnostics 
+ * a compilation installs a handler on its thread, errors are written to the 
+ * handler's stream and unwind to it, so one bad file doesn't stop the others. 
+ * without a handler they go to stderr and exit like before */ 
+
+typedef struct Error_handler_s {
+    jmp_buf env;    /* setjmp returns the exit code of the error */ 
+    FILE* out;      /* diagnostics of the compilation */ 
+} Error_handler; 
+
+/* NULL restores the default (stderr + exit), returns the previous handler */ 
+Error_handler* error_set_handler(Error_handler* handler); 
+FILE*   error_stream(void); 
+
+_Noreturn void error_fatal(int code, const char* format, ...) 
+    __attribute__((format(printf, 2, 3))); 
+/* same without a message, when it was already written to error_stream() */ 
+_Noreturn void error_unwind(int code); 
 
 #endif
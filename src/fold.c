@@ -0,0 +1,662 @@
+#include <limits.h>
+
+#include "fold.h"
+#include "ctfe.h"
+#include "effects.h"
+
+typedef struct Fold_ctx_s {
+    size_t removed; /* nodes dropped from the tree so far */ 
+    bool bounds_check; /* the subscripts are checked at run time */ 
+} Fold_ctx; 
+
+static AST_node* fold_exp(Fold_ctx* ctx, AST_node* exp); 
+static AST_node* fold_stmt(Fold_ctx* ctx, AST_node* stmt); 
+
+/* nodes in a statement or an expression subtree */ 
+static size_t count_nodes(AST_node* root)
+{
+    if (!root)
+        return 0; 
+
+    size_t count = 1; 
+    switch (root->type)
+    {
+        case NODE_STATEMENTS:
+            VEC_FOR_EACH(&((AST_statements_node*)root)->stmts_list, item)
+            {
+                count += count_nodes(item); 
+            }
+            break; 
+        case NODE_ASSIGN:
+            count += count_nodes(((AST_assign_node*)root)->dest); 
+            count += count_nodes(((AST_assign_node*)root)->assign_exp); 
+            break; 
+        case NODE_IF:
+        {
+            AST_if_node* node = (AST_if_node*)root; 
+            count += count_nodes(node->cond) + count_nodes(node->action); 
+            count += count_nodes(node->elif_branches) + count_nodes(node->else_action); 
+        }
+        break; 
+        case NODE_ELIF:
+            VEC_FOR_EACH(&((AST_elif_node*)root)->branches_list, item)
+            {
+                count += count_nodes(item); 
+            }
+            break; 
+        case NODE_BRANCH:
+            count += count_nodes(((AST_branch_node*)root)->cond); 
+            count += count_nodes(((AST_branch_node*)root)->action); 
+            break; 
+        case NODE_FOR:
+        {
+            AST_for_node* node = (AST_for_node*)root; 
+            count += count_nodes(node->iter) + count_nodes(node->from); 
+            count += count_nodes(node->to) + count_nodes(node->statements); 
+        }
+        break; 
+        case NODE_WHILE:
+            count += count_nodes(((AST_while_node*)root)->cond); 
+            count += count_nodes(((AST_while_node*)root)->statements); 
+            break; 
+        case NODE_DOWHILE:
+            count += count_nodes(((AST_dowhile_node*)root)->cond); 
+            count += count_nodes(((AST_dowhile_node*)root)->statements); 
+            break; 
+        case NODE_RETURN:
+            count += count_nodes(((AST_return_node*)root)->exp); 
+            break; 
+        case NODE_PRINT:
+            count += count_nodes(((AST_print_node*)root)->args); 
+            break; 
+        case NODE_READ:
+            count += count_nodes(((AST_read_node*)root)->args); 
+            break; 
+        case NODE_ARGS:
+            VEC_FOR_EACH(&((AST_args_node*)root)->args_list, item)
+            {
+                count += count_nodes(item); 
+            }
+            break; 
+        case NODE_ARG:
+            count += count_nodes(((AST_arg_node*)root)->exp); 
+            break; 
+        case NODE_OP:
+            count += count_nodes(((AST_op_node*)root)->lhs); 
+            count += count_nodes(((AST_op_node*)root)->rhs); 
+            break; 
+        case NODE_CALL:
+            count += count_nodes(((AST_call_node*)root)->id_node); 
+            count += count_nodes(((AST_call_node*)root)->args); 
+            break; 
+        case NODE_ARR_SUB:
+            count += count_nodes(((AST_arr_sub_node*)root)->id_node); 
+            count += count_nodes(((AST_arr_sub_node*)root)->exp); 
+            break; 
+        case NODE_MAT_SUB:
+            count += count_nodes(((AST_mat_sub_node*)root)->id_node); 
+            count += count_nodes(((AST_mat_sub_node*)root)->exp[0]); 
+            count += count_nodes(((AST_mat_sub_node*)root)->exp[1]); 
+            break; 
+        default:
+            break; 
+    }
+    return count; 
+}
+
+/* new has to be made of old's nodes and a few new leaves */ 
+static AST_node* replace(Fold_ctx* ctx, AST_node* old, AST_node* new)
+{
+    ctx->removed += count_nodes(old) - count_nodes(new); 
+    return new; 
+}
+
+/* under --bounds-check only a constant index in range can't end the program */ 
+static bool index_may_fail(Fold_ctx* ctx, AST_node* index, size_t size)
+{
+    if (!ctx->bounds_check)
+        return false; 
+    return index->type != NODE_CONST || ((AST_const_node*)index)->val_type != VAL_INT 
+        || ((AST_const_node*)index)->value.ival < 0 || (size_t)((AST_const_node*)index)->value.ival >= size; 
+}
+
+/* a call may print or not return, a checked subscript may fail, 
+ * any other expression can be dropped */ 
+static bool has_side_effects(Fold_ctx* ctx, AST_node* exp)
+{
+    if (!exp)
+        return false; 
+    switch (exp->type)
+    {
+        case NODE_CALL:
+        {
+            AST_call_node* call = (AST_call_node*)exp; 
+            if (!effects_call_removable(call))
+                return true; 
+            if (call->args)
+            {
+                VEC_FOR_EACH(&((AST_args_node*)call->args)->args_list, item)
+                {
+                    if (has_side_effects(ctx, ((AST_arg_node*)item)->exp))
+                        return true; 
+                }
+            }
+            return false; 
+        }
+        case NODE_OP:
+            return has_side_effects(ctx, ((AST_op_node*)exp)->lhs) || has_side_effects(ctx, ((AST_op_node*)exp)->rhs); 
+        case NODE_ARR_SUB:
+        {
+            AST_arr_sub_node* node = (AST_arr_sub_node*)exp; 
+            return has_side_effects(ctx, node->exp)
+                || index_may_fail(ctx, node->exp, ((Array_type*)ast_exp_type(node->id_node))->size); 
+        }
+        case NODE_MAT_SUB:
+        {
+            AST_mat_sub_node* node = (AST_mat_sub_node*)exp; 
+            Matrix_type* type = (Matrix_type*)ast_exp_type(node->id_node); 
+            return has_side_effects(ctx, node->exp[0]) || has_side_effects(ctx, node->exp[1])
+                || index_may_fail(ctx, node->exp[0], type->size[0]) 
+                || index_may_fail(ctx, node->exp[1], type->size[1]); 
+        }
+        default:
+            return false; 
+    }
+}
+
+static inline bool is_const(AST_node* node, Value_type val_type)
+{
+    return node && node->type == NODE_CONST && ((AST_const_node*)node)->val_type == val_type; 
+}
+
+/* an integer or a real equal to value */ 
+static bool is_number(AST_node* node, int value)
+{
+    if (is_const(node, VAL_INT))
+        return ((AST_const_node*)node)->value.ival == value; 
+    if (is_const(node, VAL_FLOAT))
+        return ((AST_const_node*)node)->value.fval == (float)value; 
+    return false; 
+}
+
+static bool is_bool(AST_node* node, bool value)
+{
+    return is_const(node, VAL_BOOL) && ((AST_const_node*)node)->value.bval == value; 
+}
+
+/* a constant operand promoted to the operation's operand type */ 
+static bool const_operand(AST_node* node, Value_type operand, Const_value* value)
+{
+    if (!node || node->type != NODE_CONST)
+        return false; 
+
+    AST_const_node* c = (AST_const_node*)node; 
+    if (c->val_type == operand)
+    {
+        *value = c->value; 
+        return true; 
+    }
+    if (operand == VAL_FLOAT && c->val_type == VAL_INT)
+    {
+        value->fval = (float)c->value.ival; 
+        return true; 
+    }
+    return false; 
+}
+
+/* 32 bits two's complement, like the generated code */ 
+static bool fold_int(Op_type op, int l, int r, Const_value* res)
+{
+    unsigned ul = l, ur = r; 
+    switch (op)
+    {
+        case OP_ADD:  res->ival = (int)(ul + ur); return true; 
+        case OP_SUB:  res->ival = (int)(ul - ur); return true; 
+        case OP_MUL:  res->ival = (int)(ul * ur); return true; 
+        case OP_UMIN: res->ival = (int)(0u - ul); return true; 
+        case OP_IDIV:
+        case OP_MOD:
+            /* these trap at run time, they are left to it */ 
+            if (r == 0 || (l == INT_MIN && r == -1))
+                return false; 
+            res->ival = op == OP_IDIV ? l / r : l % r; 
+            return true; 
+        case OP_GREATER:       res->bval = l > r;  return true; 
+        case OP_LESS:          res->bval = l < r;  return true; 
+        case OP_GREATER_EQUAL: res->bval = l >= r; return true; 
+        case OP_LESS_EQUAL:    res->bval = l <= r; return true; 
+        case OP_EQUAL:         res->bval = l == r; return true; 
+        case OP_NOT_EQUAL:     res->bval = l != r; return true; 
+        default:
+            return false; 
+    }
+}
+
+/* single precision and ordered comparisons, like the generated code */ 
+static bool fold_float(Op_type op, float l, float r, Const_value* res)
+{
+    switch (op)
+    {
+        case OP_ADD:  res->fval = l + r; return true; 
+        case OP_SUB:  res->fval = l - r; return true; 
+        case OP_MUL:  res->fval = l * r; return true; 
+        case OP_DIV:  res->fval = l / r; return true; 
+        case OP_UMIN: res->fval = -l;    return true; 
+        case OP_GREATER:       res->bval = l > r;  return true; 
+        case OP_LESS:          res->bval = l < r;  return true; 
+        case OP_GREATER_EQUAL: res->bval = l >= r; return true; 
+        case OP_LESS_EQUAL:    res->bval = l <= r; return true; 
+        case OP_EQUAL:         res->bval = l == r; return true; 
+        case OP_NOT_EQUAL:     res->bval = l < r || l > r; return true; 
+        default:
+            return false; 
+    }
+}
+
+static bool fold_bool(Op_type op, bool l, bool r, Const_value* res)
+{
+    switch (op)
+    {
+        case OP_AND:       res->bval = l && r; return true; 
+        case OP_OR:        res->bval = l || r; return true; 
+        case OP_NOT:       res->bval = !l;     return true; 
+        case OP_EQUAL:     res->bval = l == r; return true; 
+        case OP_NOT_EQUAL: res->bval = l != r; return true; 
+        default:
+            return false; 
+    }
+}
+
+static bool fold_char(Op_type op, char l, char r, Const_value* res)
+{
+    switch (op)
+    {
+        case OP_GREATER:       res->bval = l > r;  return true; 
+        case OP_LESS:          res->bval = l < r;  return true; 
+        case OP_GREATER_EQUAL: res->bval = l >= r; return true; 
+        case OP_LESS_EQUAL:    res->bval = l <= r; return true; 
+        case OP_EQUAL:         res->bval = l == r; return true; 
+        case OP_NOT_EQUAL:     res->bval = l != r; return true; 
+        default:
+            return false; 
+    }
+}
+
+bool fold_eval_op(Op_type op, Value_type operand, Const_value l, Const_value r, Const_value* res)
+{
+    switch (operand)
+    {
+        case VAL_INT:   return fold_int(op, l.ival, r.ival, res); 
+        case VAL_FLOAT: return fold_float(op, l.fval, r.fval, res); 
+        case VAL_BOOL:  return fold_bool(op, l.bval, r.bval, res); 
+        case VAL_CHAR:  return fold_char(op, l.cval, r.cval, res); 
+        default:
+            return false; 
+    }
+}
+
+static bool fold_const_op(AST_op_node* node, Value_type* res_type, Const_value* res)
+{
+    if (!node->operand_type || !TYPE_IS_PRIMITIVE(node->operand_type))
+        return false; 
+
+    Value_type operand = ((Primitive_type*)node->operand_type)->val_type; 
+    Const_value l, r = {0}; 
+    if (!const_operand(node->lhs, operand, &l))
+        return false; 
+    if (op_binary(node->op_type) && !const_operand(node->rhs, operand, &r))
+        return false; 
+
+    *res_type = op_rel(node->op_type) ? VAL_BOOL : operand; 
+    return fold_eval_op(node->op_type, operand, l, r, res); 
+}
+
+/* an operand can only stand for the operation if it needed no promotion,
+ * x + 0.0 is kept for reals since -0.0 + 0.0 is 0.0 */ 
+static AST_node* simplify_op(Fold_ctx* ctx, AST_op_node* node)
+{
+    AST_node* lhs = node->lhs; 
+    AST_node* rhs = node->rhs; 
+    Type* res = node->res_type; 
+#define SAME_TYPE(exp) (ast_exp_type(exp) == res)
+
+    switch (node->op_type)
+    {
+        case OP_ADD:
+            if (res == TYPE_INT && is_number(rhs, 0) && SAME_TYPE(lhs))
+                return lhs; 
+            if (res == TYPE_INT && is_number(lhs, 0) && SAME_TYPE(rhs))
+                return rhs; 
+            break; 
+        case OP_SUB:
+            if (is_number(rhs, 0) && SAME_TYPE(lhs))
+                return lhs; 
+            break; 
+        case OP_MUL:
+            if (is_number(rhs, 1) && SAME_TYPE(lhs))
+                return lhs; 
+            if (is_number(lhs, 1) && SAME_TYPE(rhs))
+                return rhs; 
+            if (res == TYPE_INT && is_number(rhs, 0) && !has_side_effects(ctx, lhs))
+                return rhs; 
+            if (res == TYPE_INT && is_number(lhs, 0) && !has_side_effects(ctx, rhs))
+                return lhs; 
+            break; 
+        case OP_DIV:
+        case OP_IDIV:
+            if (is_number(rhs, 1) && SAME_TYPE(lhs))
+                return lhs; 
+            break; 
+        case OP_AND:
+            if (is_bool(rhs, true) && SAME_TYPE(lhs))
+                return lhs; 
+            if (is_bool(lhs, true) && SAME_TYPE(rhs))
+                return rhs; 
+            if (is_bool(rhs, false) && !has_side_effects(ctx, lhs))
+                return rhs; 
+            /* the right side isn't evaluated */ 
+            if (is_bool(lhs, false))
+                return lhs; 
+            break; 
+        case OP_OR:
+            if (is_bool(rhs, false) && SAME_TYPE(lhs))
+                return lhs; 
+            if (is_bool(lhs, false) && SAME_TYPE(rhs))
+                return rhs; 
+            if (is_bool(rhs, true) && !has_side_effects(ctx, lhs))
+                return rhs; 
+            if (is_bool(lhs, true))
+                return lhs; 
+            break; 
+        case OP_NOT:
+        case OP_UMIN:
+            /* non non b, - - x */ 
+            if (lhs->type == NODE_OP && ((AST_op_node*)lhs)->op_type == node->op_type)
+                return ((AST_op_node*)lhs)->lhs; 
+            break; 
+        default:
+            break; 
+    }
+#undef SAME_TYPE
+    return (AST_node*)node; 
+}
+
+static AST_node* fold_op(Fold_ctx* ctx, AST_op_node* node)
+{
+    node->lhs = fold_exp(ctx, node->lhs); 
+    node->rhs = fold_exp(ctx, node->rhs); 
+
+    Value_type val_type; 
+    Const_value value; 
+    if (fold_const_op(node, &val_type, &value))
+        return replace(ctx, (AST_node*)node, ast_const_node_create(val_type, value)); 
+
+    AST_node* simplified = simplify_op(ctx, node); 
+    if (simplified != (AST_node*)node)
+        return replace(ctx, (AST_node*)node, simplified); 
+    return simplified; 
+}
+
+static void fold_args(Fold_ctx* ctx, AST_node* args)
+{
+    if (!args)
+        return; 
+    VEC_FOR_EACH(&((AST_args_node*)args)->args_list, item)
+    {
+        AST_arg_node* arg = item; 
+        arg->exp = fold_exp(ctx, arg->exp); 
+    }
+}
+
+static AST_node* fold_exp(Fold_ctx* ctx, AST_node* root)
+{
+    if (!root)
+        return NULL; 
+
+    switch (root->type)
+    {
+        case NODE_OP:
+            return fold_op(ctx, (AST_op_node*)root); 
+        case NODE_CALL:
+        {
+            AST_call_node* call = (AST_call_node*)root; 
+            fold_args(ctx, call->args); 
+
+            Value_type val_type; 
+            Const_value value; 
+            if (ctfe_eval_call(call, &val_type, &value))
+                return replace(ctx, root, ast_const_node_create(val_type, value)); 
+        }
+        break; 
+        case NODE_ARR_SUB:
+        {
+            AST_arr_sub_node* node = (AST_arr_sub_node*)root; 
+            node->exp = fold_exp(ctx, node->exp); 
+        }
+        break; 
+        case NODE_MAT_SUB:
+        {
+            AST_mat_sub_node* node = (AST_mat_sub_node*)root; 
+            node->exp[0] = fold_exp(ctx, node->exp[0]); 
+            node->exp[1] = fold_exp(ctx, node->exp[1]); 
+        }
+        break; 
+        default:
+            break; 
+    }
+    return root; 
+}
+
+/* branches with a constant faux condition are dropped, the first constant
+ * vrai one becomes the else. without any branch left the if is its else */ 
+static AST_node* fold_if(Fold_ctx* ctx, AST_if_node* node)
+{
+    AST_elif_node* elif_node = (AST_elif_node*)node->elif_branches; 
+
+    /* the first branch lives in the if node itself, it has no branch node */ 
+    Vector branches; 
+    VEC_init(&branches, NULL); 
+    node->cond = fold_exp(ctx, node->cond); 
+    node->action = fold_stmt(ctx, node->action); 
+    VEC_push_back(&branches, NULL); 
+    if (elif_node)
+    {
+        VEC_FOR_EACH(&elif_node->branches_list, item)
+        {
+            AST_branch_node* branch = item; 
+            branch->cond = fold_exp(ctx, branch->cond); 
+            branch->action = fold_stmt(ctx, branch->action); 
+            VEC_push_back(&branches, branch); 
+        }
+    }
+    node->else_action = fold_stmt(ctx, node->else_action); 
+
+    AST_node* else_action = node->else_action; 
+    size_t count = VEC_size(&branches); 
+    size_t live = 0; 
+    AST_node* first_cond = NULL; 
+    AST_node* first_action = NULL; 
+    for (size_t i = 0; i < count; i++)
+    {
+        AST_branch_node* branch = VEC_at(&branches, i); 
+        AST_node* cond = branch ? branch->cond : node->cond; 
+        AST_node* action = branch ? branch->action : node->action; 
+
+        if (is_bool(cond, false))
+            continue; 
+        if (is_bool(cond, true))
+        {
+            else_action = action; 
+            break; 
+        }
+        if (live == 0)
+        {
+            first_cond = cond; 
+            first_action = action; 
+        }
+        /* a live branch after the first one always has its branch node */ 
+        VEC_data(&branches)[live++] = branch; 
+    }
+
+    if (live == count && else_action == node->else_action)
+    {
+        VEC_free(&branches); 
+        return (AST_node*)node; 
+    }
+
+    size_t before = count_nodes((AST_node*)node); 
+    AST_node* result = else_action; 
+    if (live > 0)
+    {
+        node->cond = first_cond; 
+        node->action = first_action; 
+        node->else_action = else_action; 
+        if (live == 1)
+            node->elif_branches = NULL; 
+        else
+        {
+            VEC_clear(&elif_node->branches_list); 
+            for (size_t i = 1; i < live; i++)
+                ast_elif_node_insert((AST_node*)elif_node, VEC_at(&branches, i)); 
+        }
+        result = (AST_node*)node; 
+    }
+    ctx->removed += before - count_nodes(result); 
+    VEC_free(&branches); 
+    return result; 
+}
+
+static bool is_empty_block(AST_node* stmts)
+{
+    return !stmts || VEC_empty(&((AST_statements_node*)stmts)->stmts_list); 
+}
+
+/* a loop with constant bounds that either never runs or runs an empty body
+ * only leaves the iterator at the value it exits with */ 
+static AST_node* fold_for(Fold_ctx* ctx, AST_for_node* node)
+{
+    node->from = fold_exp(ctx, node->from); 
+    node->to = fold_exp(ctx, node->to); 
+    node->statements = fold_stmt(ctx, node->statements); 
+
+    if (!is_const(node->from, VAL_INT) || !is_const(node->to, VAL_INT))
+        return (AST_node*)node; 
+
+    int from = ((AST_const_node*)node->from)->value.ival; 
+    int to = ((AST_const_node*)node->to)->value.ival; 
+    AST_node* exit_value; 
+    if (from > to)
+        exit_value = node->from; 
+    else if (is_empty_block(node->statements) && to < INT_MAX)
+        exit_value = ast_const_node_create(VAL_INT, (Const_value){ .ival = to + 1 }); 
+    else
+        return (AST_node*)node; 
+
+    return replace(ctx, (AST_node*)node, ast_assign_node_create(node->iter, exit_value)); 
+}
+
+/* statements that fold away are dropped and blocks are spliced into the enclosing one */ 
+static void fold_stmts(Fold_ctx* ctx, AST_statements_node* node)
+{
+    Vector folded; 
+    VEC_init(&folded, NULL); 
+    VEC_FOR_EACH(&node->stmts_list, item)
+    {
+        AST_node* stmt = fold_stmt(ctx, item); 
+        if (!stmt)
+            continue; 
+        if (stmt->type != NODE_STATEMENTS)
+        {
+            VEC_push_back(&folded, stmt); 
+            continue; 
+        }
+        VEC_FOR_EACH(&((AST_statements_node*)stmt)->stmts_list, inner)
+        {
+            VEC_push_back(&folded, inner); 
+        }
+        ctx->removed++; 
+    }
+
+    /* never more than before, the list keeps its storage */ 
+    VEC_clear(&node->stmts_list); 
+    VEC_FOR_EACH(&folded, item)
+    {
+        ast_statements_node_insert((AST_node*)node, item); 
+    }
+    VEC_free(&folded); 
+}
+
+static AST_node* fold_stmt(Fold_ctx* ctx, AST_node* root)
+{
+    if (!root)
+        return NULL; 
+
+    switch (root->type)
+    {
+        case NODE_STATEMENTS:
+            fold_stmts(ctx, (AST_statements_node*)root); 
+            break; 
+        case NODE_ASSIGN:
+        {
+            AST_assign_node* node = (AST_assign_node*)root; 
+            node->dest = fold_exp(ctx, node->dest); 
+            node->assign_exp = fold_exp(ctx, node->assign_exp); 
+        }
+        break; 
+        case NODE_IF:
+            return fold_if(ctx, (AST_if_node*)root); 
+        case NODE_FOR:
+            return fold_for(ctx, (AST_for_node*)root); 
+        case NODE_WHILE:
+        {
+            AST_while_node* node = (AST_while_node*)root; 
+            node->cond = fold_exp(ctx, node->cond); 
+            node->statements = fold_stmt(ctx, node->statements); 
+            if (is_bool(node->cond, false))
+                return replace(ctx, root, NULL); 
+        }
+        break; 
+        case NODE_DOWHILE:
+        {
+            AST_dowhile_node* node = (AST_dowhile_node*)root; 
+            node->statements = fold_stmt(ctx, node->statements); 
+            node->cond = fold_exp(ctx, node->cond); 
+        }
+        break; 
+        case NODE_RETURN:
+        {
+            AST_return_node* node = (AST_return_node*)root; 
+            node->exp = fold_exp(ctx, node->exp); 
+        }
+        break; 
+        case NODE_PRINT:
+            fold_args(ctx, ((AST_print_node*)root)->args); 
+            break; 
+        case NODE_READ:
+            /* only the subscripts of the destinations fold */ 
+            fold_args(ctx, ((AST_read_node*)root)->args); 
+            break; 
+        default:
+            break; 
+    }
+    return root; 
+}
+
+size_t fold_program(AST_node* program_node, bool bounds_check)
+{
+    Fold_ctx ctx = {0, bounds_check}; 
+    AST_program_node* program = (AST_program_node*)program_node; 
+
+    ctfe_analyze(program_node); 
+
+    if (program->subprograms)
+    {
+        VEC_FOR_EACH(&((AST_subprograms_node*)program->subprograms)->functions_list, item)
+        {
+            AST_function_node* fn = item; 
+            fn->statements = fold_stmt(&ctx, fn->statements); 
+        }
+    }
+    program->statements = fold_stmt(&ctx, program->statements); 
+    return ctx.removed; 
+}
@@ -0,0 +1,18 @@
+#ifndef FOLD_H
+#define FOLD_H
+
+#include "ast.h"
+
+/* folds constant expressions and algebraic identities with the 
+ * type_resolve_op rules, evaluates the calls to pure functions with 
+ * constant arguments, drops the branches of constant conditions and 
+ * the loops that can't run. with bounds_check the subscripts that may 
+ * fail are kept. the tree has to be annotated by the semantic pass and 
+ * effects_analyze, returns the number of nodes removed */ 
+size_t fold_program(AST_node* program_node, bool bounds_check); 
+
+/* evaluates op on operands already promoted to the operand type, 
+ * false if it can't be folded (it would trap at run time) */ 
+bool fold_eval_op(Op_type op, Value_type operand, Const_value l, Const_value r, Const_value* res); 
+
+#endif
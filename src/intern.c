@@ -0,0 +1,175 @@
+#include "intern.h"
+
+#include <stdlib.h> 
+#include <string.h> 
+
+#include "arena.h"
+
+#define INTERN_INITIAL_CAPACITY 1024 /* must be a power of 2 */ 
+
+typedef struct Intern_entry_s {
+    const char* str; 
+    size_t len; 
+    uint32_t hash; 
+} Intern_entry; 
+
+struct Intern_pool_s {
+    Arena strings; 
+    Intern_entry* entries;  /* indexed by symbol, entries[0] is unused */ 
+    size_t entries_count; 
+    size_t entries_capacity; 
+    Symbol* slots;          /* open addressing table of symbols, 0 is empty */ 
+    size_t slots_capacity; 
+}; 
+
+/* each compilation interns into the pool of its thread, created on first use */ 
+static _Thread_local Intern_pool* pool = NULL; 
+
+static void* intern_alloc(void* ptr, size_t size)
+{
+    ptr = realloc(ptr, size); 
+    if (!ptr)
+    {
+        fprintf(stderr, "Error: out of memory\n"); 
+        exit(1); 
+    }
+    return ptr; 
+}
+
+uint32_t intern_hash(const char* str, size_t len)
+{
+    /* fnv-1a */ 
+    uint32_t hash = 2166136261u; 
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char)str[i]; 
+        hash *= 16777619u; 
+    }
+    return hash; 
+}
+
+static void intern_grow(void)
+{
+    size_t capacity = pool->slots_capacity ? pool->slots_capacity * 2 : INTERN_INITIAL_CAPACITY; 
+    Symbol* new_slots = calloc(capacity, sizeof(Symbol)); 
+    if (!new_slots)
+    {
+        fprintf(stderr, "Error: out of memory\n"); 
+        exit(1); 
+    }
+
+    for (Symbol sym = 1; sym < pool->entries_count; sym++)
+    {
+        size_t index = pool->entries[sym].hash & (capacity - 1); 
+        while (new_slots[index])
+            index = (index + 1) & (capacity - 1); 
+        new_slots[index] = sym; 
+    }
+
+    free(pool->slots); 
+    pool->slots = new_slots; 
+    pool->slots_capacity = capacity; 
+}
+
+/* the slot of str, empty if it isn't interned */ 
+static size_t intern_slot(const char* str, size_t len, uint32_t hash)
+{
+    size_t index = hash & (pool->slots_capacity - 1); 
+    while (pool->slots[index])
+    {
+        Intern_entry* entry = &pool->entries[pool->slots[index]]; 
+        if (entry->hash == hash && entry->len == len && !memcmp(entry->str, str, len))
+            break; 
+        index = (index + 1) & (pool->slots_capacity - 1); 
+    }
+    return index; 
+}
+
+Symbol intern_n(const char* str, size_t len)
+{
+    if (!pool)
+    {
+        pool = calloc(1, sizeof(Intern_pool)); 
+        if (!pool)
+        {
+            fprintf(stderr, "Error: out of memory\n"); 
+            exit(1); 
+        }
+    }
+
+    /* keep the load under 1/2 */ 
+    if (pool->entries_count * 2 >= pool->slots_capacity)
+        intern_grow(); 
+    if (pool->entries_count == 0)
+        pool->entries_count = 1; /* reserve SYMBOL_NONE */ 
+
+    uint32_t hash = intern_hash(str, len); 
+    size_t index = intern_slot(str, len, hash); 
+    if (pool->slots[index])
+        return pool->slots[index]; 
+
+    if (pool->entries_count >= pool->entries_capacity)
+    {
+        pool->entries_capacity = pool->entries_capacity ? pool->entries_capacity * 2 : INTERN_INITIAL_CAPACITY; 
+        pool->entries = intern_alloc(pool->entries, pool->entries_capacity * sizeof(Intern_entry)); 
+    }
+
+    Symbol sym = pool->entries_count++; 
+    pool->entries[sym].str = arena_strndup(&pool->strings, str, len); 
+    pool->entries[sym].len = len; 
+    pool->entries[sym].hash = hash; 
+    pool->slots[index] = sym; 
+
+    return sym; 
+}
+
+Symbol intern(const char* str)
+{
+    return intern_n(str, strlen(str)); 
+}
+
+Symbol intern_find(const char* str)
+{
+    if (!pool || !pool->slots_capacity)
+        return SYMBOL_NONE; 
+    size_t len = strlen(str); 
+    return pool->slots[intern_slot(str, len, intern_hash(str, len))]; 
+}
+
+const char* symbol_name(Symbol sym)
+{
+    if (!pool || sym == SYMBOL_NONE || sym >= pool->entries_count)
+        return "<none>"; 
+    return pool->entries[sym].str; 
+}
+
+size_t intern_count(void)
+{
+    return pool && pool->entries_count ? pool->entries_count - 1 : 0; 
+}
+
+size_t intern_bytes(void)
+{
+    return pool ? pool->strings.bytes_used : 0; 
+}
+
+void intern_release(void)
+{
+    if (!pool)
+        return; 
+    arena_release(&pool->strings); 
+    free(pool->entries); 
+    free(pool->slots); 
+    free(pool); 
+    pool = NULL; 
+}
+
+Intern_pool* intern_pool_current(void)
+{
+    return pool; 
+}
+
+void intern_pool_use(Intern_pool* shared)
+{
+    pool = shared; 
+}
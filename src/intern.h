@@ -0,0 +1,36 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stdint.h> 
+#include <stddef.h> 
+#include <stdio.h> 
+
+/* every distinct identifier is stored once and named by a 32 bit id, 
+ * comparing identifiers is comparing ids */ 
+typedef uint32_t Symbol; 
+#define SYMBOL_NONE 0 /* never returned by intern */ 
+
+/* symbols are only meaningful in the pool of the thread that interned them */ 
+typedef struct Intern_pool_s Intern_pool; 
+
+Symbol      intern(const char* str); 
+Symbol      intern_n(const char* str, size_t len); 
+/* the symbol of str if it was interned, SYMBOL_NONE otherwise. 
+ * it never writes to the pool, a lent pool can be searched */ 
+Symbol      intern_find(const char* str); 
+/* the hash of the pool's table, for the other tables keyed by strings */ 
+uint32_t    intern_hash(const char* str, size_t len); 
+/* the returned string lives until intern_release */ 
+const char* symbol_name(Symbol sym); 
+
+size_t      intern_count(void); 
+size_t      intern_bytes(void); 
+/* frees the pool of the calling thread */ 
+void        intern_release(void); 
+
+/* lend a pool to helper threads so they can read the names, 
+ * nothing may be interned while it's shared */ 
+Intern_pool* intern_pool_current(void); 
+void        intern_pool_use(Intern_pool* pool); 
+
+#endif
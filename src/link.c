@@ -0,0 +1,70 @@
+#include "link.h"
+
+#include <stdio.h> 
+#include <stdlib.h> 
+#include <string.h> 
+#include <errno.h> 
+#include <unistd.h> 
+#include <spawn.h> 
+#include <sys/wait.h> 
+
+#include "error.h"
+
+extern char** environ; 
+
+/* set by the makefile to the archive it builds */ 
+#ifndef FRASCAL_RUNTIME_LIB
+#define FRASCAL_RUNTIME_LIB "runtime/libfrascalrt.a"
+#endif
+
+const char* link_runtime_path(void)
+{
+    const char* path = getenv("FRASCAL_RUNTIME"); 
+    return path && *path ? path : FRASCAL_RUNTIME_LIB; 
+}
+
+bool link_temp_file(char* path, size_t size, const char* suffix)
+{
+    const char* dir = getenv("TMPDIR"); 
+    if (!dir || !*dir)
+        dir = "/tmp"; 
+    int len = snprintf(path, size, "%s/frascal-XXXXXX%s", dir, suffix); 
+    if (len < 0 || (size_t)len >= size)
+    {
+        *path = '\0'; 
+        errno = ENAMETOOLONG; 
+        return false; 
+    }
+
+    int fd = mkstemps(path, strlen(suffix)); 
+    if (fd < 0)
+    {
+        *path = '\0'; 
+        return false; 
+    }
+    close(fd); 
+    return true; 
+}
+
+void link_executable(const char* object, const char* output)
+{
+    const char* driver = getenv("CC"); 
+    if (!driver || !*driver)
+        driver = "cc"; 
+
+    /* the objects are pic, the driver's default (pie or not) fits them */ 
+    char* argv[] = {(char*)driver, (char*)object, (char*)link_runtime_path(), "-lm", "-o", (char*)output, NULL}; 
+    pid_t pid; 
+    int error = posix_spawnp(&pid, driver, NULL, NULL, argv, environ); 
+    if (error)
+        error_fatal(1, "Error : can't run %s: %s\n", driver, strerror(error)); 
+
+    int status; 
+    while (waitpid(pid, &status, 0) < 0)
+    {
+        if (errno != EINTR)
+            error_fatal(1, "Error : waiting for %s: %s\n", driver, strerror(errno)); 
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status))
+        error_fatal(1, "Error : %s failed to link %s\n", driver, output); 
+}
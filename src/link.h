@@ -0,0 +1,19 @@
+#ifndef LINK_H
+#define LINK_H
+
+#include <stdbool.h> 
+#include <stddef.h> 
+
+/* the runtime archive the programs are linked with, 
+ * $FRASCAL_RUNTIME or the one built next to the compiler */ 
+const char* link_runtime_path(void); 
+
+/* a fresh empty file of the temporary directory ending with suffix, 
+ * its path is written to path. returns false if it can't be created */ 
+bool link_temp_file(char* path, size_t size, const char* suffix); 
+
+/* links object with the runtime into the executable output in one run of 
+ * the system compiler driver ($CC, cc by default). errors are fatal */ 
+void link_executable(const char* object, const char* output); 
+
+#endif
@@ -1,5 +1,25 @@
 #include "linkedlist.h"
 
+static LL_Node* LL_list_node(Linkedlist* ll, void* data)
+{
+    if (ll -> arena == NULL)
+        return LL_create_node(data); 
+
+    LL_Node* node = arena_alloc(ll -> arena, sizeof(LL_Node)); 
+
+    node -> data = data; 
+    node -> next = NULL; 
+    node -> prev = NULL; 
+
+    return node; 
+}
+
+static void LL_release_node(Linkedlist* ll, LL_Node* node)
+{
+    if (ll -> arena == NULL)
+        free(node); 
+}
+
 LL_Node* LL_create_node(void* data)
 {
     LL_Node* node = malloc(sizeof(LL_Node)); 
@@ -28,6 +48,19 @@ Linkedlist* LL_create_list()
     ll -> head = NULL; 
     ll -> back = NULL; 
     ll -> size = 0; 
+    ll -> arena = NULL; 
+
+    return ll; 
+}
+
+Linkedlist* LL_create_list_arena(Arena* arena) 
+{
+    Linkedlist* ll = arena_alloc(arena, sizeof(Linkedlist)); 
+
+    ll -> head = NULL; 
+    ll -> back = NULL; 
+    ll -> size = 0; 
+    ll -> arena = arena; 
 
     return ll; 
 }
@@ -41,7 +74,9 @@ void LL_clear(Linkedlist* ll, void (*free_data)(void*))
     while (node != NULL)
     {
         LL_Node* tmp = node -> next; 
-        LL_free_node(node, free_data); 
+        if (node -> data != NULL && free_data != NULL)
+            free_data(node -> data); 
+        LL_release_node(ll, node); 
         node = tmp; 
     }
     ll -> head = NULL; 
@@ -57,7 +92,8 @@ void LL_free_list(Linkedlist** ll, void (*free_data)(void*))
     }
 
     LL_clear(*ll, free_data); 
-    free(*ll); 
+    if ((*ll) -> arena == NULL)
+        free(*ll); 
     *ll = NULL; 
 }
 
@@ -66,7 +102,7 @@ void LL_insert_front(Linkedlist* ll, void* data)
     if (ll == NULL)
         return; 
 
-    LL_Node* node = LL_create_node(data); 
+    LL_Node* node = LL_list_node(ll, data); 
     node -> next = ll -> head; 
     if (ll -> head != NULL)
         ll -> head -> prev = node; 
@@ -83,7 +119,7 @@ void LL_insert_back(Linkedlist* ll, void* data)
     if (ll == NULL)
         return; 
 
-    LL_Node* node = LL_create_node(data); 
+    LL_Node* node = LL_list_node(ll, data); 
     node -> prev = ll -> back; 
     if (ll -> back != NULL)
         ll -> back -> next = node; 
@@ -115,7 +151,7 @@ void* LL_pop_back(Linkedlist* ll)
 
     void* ret = tmp -> data; 
 
-    free(tmp); 
+    LL_release_node(ll, tmp); 
 
     return ret; 
 }
@@ -140,7 +176,7 @@ void* LL_pop_front(Linkedlist* ll)
 
     void* ret = tmp -> data; 
 
-    free(tmp); 
+    LL_release_node(ll, tmp); 
 
     return ret; 
 }
@@ -5,6 +5,8 @@
 #include <stdbool.h> 
 #include <stddef.h> 
 
+#include "arena.h"
+
 #define LL_FOR_EACH(llist, node)\
     for(LL_Node*(node) = (llist)->head;(node) != NULL;(node) = (node)->next)
 
@@ -18,12 +20,15 @@ typedef struct Linkelist_s {
     LL_Node* head; 
     LL_Node* back; 
     size_t size;  
+    Arena* arena; /* NULL if the nodes are malloc'd */ 
 } Linkedlist; 
 
 LL_Node*    LL_create_node(void* data); 
 void        LL_free_node(LL_Node* node, void (*free_data)(void*)); 
 
 Linkedlist* LL_create_list(); 
+/* the list and its nodes live in the arena, freeing them is a no-op */ 
+Linkedlist* LL_create_list_arena(Arena* arena); 
 void        LL_clear(Linkedlist* ll, void (*free_data)(void*)); 
 void        LL_free_list(Linkedlist** ll, void (*free_data)(void*)); 
 
@@ -1,42 +1,197 @@
 #include <stdio.h> 
 #include <stdlib.h> 
-#include <errno.h> 
+#include <string.h> 
 
-#include "ast.h" //ast should be included before parser
-#include "parser.h"
-#include "codegen.h"
+#include "compile.h"
+#include "cache.h"
 
-extern FILE* yyin;
+_Noreturn static void usage(void)
+{
+    fprintf(stderr, "usage: frascal [--ast-stats] [--check-only] [--range-report] [--bounds-check] [-O0|-O1|-O2|-O3] [--emit=ll|bc|asm|obj] [-c] [-o file|-] [--run [--cache]] [-j N] [--codegen-threads N] [file.frp ...]\n"); 
+    exit(1); 
+}
+
+/* what --emit writes, and the extension of the files it names */ 
+typedef struct Emit_kind_s {
+    const char* name; 
+    Output_kind kind; 
+    const char* extension; 
+} Emit_kind; 
+
+static const Emit_kind emit_kinds[] = {
+    {"ll",  OUTPUT_IR,       ".ll"}, 
+    {"bc",  OUTPUT_BITCODE,  ".bc"}, 
+    {"asm", OUTPUT_ASSEMBLY, ".s"}, 
+    {"obj", OUTPUT_OBJECT,   ".o"}, 
+}; 
+#define EMIT_KINDS_NB (sizeof(emit_kinds) / sizeof(Emit_kind))
+#define EMIT_OBJECT (&emit_kinds[3])
 
-extern AST_node* program_node; 
+static const Emit_kind* emit_kind(const char* name)
+{
+    for (size_t i = 0; i < EMIT_KINDS_NB; i++)
+        if (!strcmp(emit_kinds[i].name, name))
+            return &emit_kinds[i]; 
+    usage(); 
+}
+
+/* a.frp -> a.ll (or the extension given) next to its source */ 
+static char* output_path(const char* input, const char* extension)
+{
+    size_t len = strlen(input); 
+    const char* dot = strrchr(input, '.'); 
+    const char* slash = strrchr(input, '/'); 
+    if (dot && (!slash || dot > slash))
+        len = dot - input; 
 
+    char* path = malloc(len + strlen(extension) + 1); 
+    if (!path)
+    {
+        fprintf(stderr, "Error: out of memory\n"); 
+        exit(1); 
+    }
+    memcpy(path, input, len); 
+    strcpy(path + len, extension); 
+    return path; 
+}
 
 int main(int argc, char*argv[])
 {
     argc--;  argv++; 
 
-    if (argc < 1)
-        yyin = stdin;  
-    else
+    bool ast_stats = false; /* print the ast memory usage */ 
+    bool check_only = false; /* diagnostics only, no ir is written */ 
+    bool range_report = false; /* list the narrowed arrays */ 
+    bool bounds_check = false; /* check the subscripts at run time */ 
+    int opt_level = 0;      /* -O, the module is written as generated by default */ 
+    int workers = 0;        /* -j, 0 when not given */ 
+    int codegen_threads = 1; /* per file, for its subprograms */ 
+    const Emit_kind* emit = NULL; /* --emit or -c, stop before linking */ 
+    const char* output = NULL; /* -o, an executable unless emit */ 
+    bool run = false;       /* --run, main is executed instead of written */ 
+    bool cache = false;     /* --cache, the objects of --run are kept on disk */ 
+    const char** inputs = calloc(argc + 1, sizeof(char*)); 
+    size_t inputs_count = 0; 
+
+    for (int i = 0; i < argc; i++)
     {
-        if (!(yyin = fopen(argv[0], "r")))
+        if (!strcmp(argv[i], "--ast-stats"))
+            ast_stats = true; 
+        else if (!strcmp(argv[i], "--check-only"))
+            check_only = true; 
+        else if (!strcmp(argv[i], "--range-report"))
+            range_report = true; 
+        else if (!strcmp(argv[i], "--bounds-check"))
+            bounds_check = true; 
+        else if (!strncmp(argv[i], "-O", 2))
+        {
+            if (argv[i][2] < '0' || argv[i][2] > '3' || argv[i][3])
+                usage(); 
+            opt_level = argv[i][2] - '0'; 
+        }
+        else if (!strcmp(argv[i], "--run"))
+            run = true; 
+        else if (!strcmp(argv[i], "--cache"))
+            cache = true; 
+        else if (!strcmp(argv[i], "-c"))
+            emit = EMIT_OBJECT; 
+        else if (!strncmp(argv[i], "--emit=", 7))
+            emit = emit_kind(argv[i] + 7); 
+        else if (!strncmp(argv[i], "-o", 2))
+        {
+            output = argv[i][2] ? argv[i] + 2 : (++i < argc ? argv[i] : NULL); 
+            if (!output)
+                usage(); 
+        }
+        else if (!strncmp(argv[i], "-j", 2))
         {
-            perror(argv[0]); 
-            return 1; 
+            const char* count = argv[i][2] ? argv[i] + 2 : (++i < argc ? argv[i] : NULL); 
+            char* end; 
+            if (!count || (workers = strtol(count, &end, 10)) < 1 || *end)
+                usage(); 
         }
+        else if (!strcmp(argv[i], "--codegen-threads"))
+        {
+            char* end; 
+            if (++i >= argc || (codegen_threads = strtol(argv[i], &end, 10)) < 1 || *end)
+                usage(); 
+        }
+        else 
+            inputs[inputs_count++] = argv[i]; 
+    }
+
+    /* a single file (or stdin) keeps writing out.ll, 
+     * a batch or --emit writes each module next to its source (out.* for stdin). 
+     * -o names the output of a single file, - streams it to stdout */ 
+    bool batch = workers > 0 || inputs_count > 1; 
+    if (inputs_count == 0)
+    {
+        if (batch)
+            usage(); 
+        inputs_count = 1; /* stdin */ 
+    }
+    if (output && inputs_count > 1)
+        usage(); 
+    if (output && !emit && !strcmp(output, "-"))
+        usage(); /* an executable isn't streamed */ 
+    if (run && (batch || output || emit))
+        usage(); /* one program, run in place of any output */ 
+    if (cache && !run)
+        usage(); 
+    if (cache && !cache_available())
+    {
+        fprintf(stderr, "Error: --cache needs a compiler built with FRASCAL_BUILD_ID, see the makefile\n"); 
+        usage(); 
+    }
+
+    Output_kind output_kind = emit ? emit->kind : output ? OUTPUT_EXECUTABLE : OUTPUT_IR; 
+    bool derived_outputs = !output && (batch || emit); 
+    const char* extension = emit ? emit->extension : ".ll"; 
+
+    Compile_job* jobs = calloc(inputs_count, sizeof(Compile_job)); 
+    for (size_t i = 0; i < inputs_count; i++)
+    {
+        jobs[i].input = inputs[i]; 
+        jobs[i].output_kind = output_kind; 
+        if (output)
+            jobs[i].output = output; 
+        else if (derived_outputs)
+            jobs[i].output = output_path(inputs[i] ? inputs[i] : "out", extension); 
+        else 
+            jobs[i].output = "out.ll"; 
+        jobs[i].ast_stats = ast_stats; 
+        jobs[i].codegen_threads = codegen_threads; 
+        jobs[i].check_only = check_only; 
+        jobs[i].range_report = range_report; 
+        jobs[i].bounds_check = bounds_check; 
+        jobs[i].opt_level = opt_level; 
+        jobs[i].run = run; 
+        jobs[i].cache = cache; 
     }
 
-    Codegen_ctx codegen_ctx; 
+    compile_jobs(jobs, inputs_count, workers); 
+
+    /* diagnostics are printed in the order of the inputs, whichever finished first */ 
+    int status = 0; 
+    for (size_t i = 0; i < inputs_count; i++)
+    {
+        if (jobs[i].diagnostics_size)
+        {
+            if (batch)
+                fprintf(stderr, "%s:\n", jobs[i].input); 
+            fputs(jobs[i].diagnostics, stderr); 
+        }
+        if (jobs[i].status && !status)
+            status = jobs[i].status; 
+        else if (run && !jobs[i].status)
+            status = jobs[i].exit_status; 
 
-    /* compiler init */ 
-    code_gen_init(&codegen_ctx); /* codegen */  
+        compile_job_free(&jobs[i]); 
+        if (derived_outputs)
+            free((char*)jobs[i].output); 
+    }
 
-    yyparse(); 
-    code_gen_ir(&codegen_ctx, program_node);
-    /* debug */ 
-    /* AST_tree_print(program_node, 0); */ 
-    
-    AST_tree_free(program_node); 
-    code_gen_cleanup(&codegen_ctx);  
-    return 0; 
+    free(jobs); 
+    free(inputs); 
+    return status; 
 }
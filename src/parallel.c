@@ -0,0 +1,61 @@
+#include "parallel.h"
+
+#include <stdio.h> 
+#include <stdlib.h> 
+#include <pthread.h> 
+
+typedef struct Work_queue_s {
+    size_t count; 
+    size_t next; 
+    pthread_mutex_t lock; 
+    void (*fn)(void* arg, size_t index); 
+    void* arg; 
+} Work_queue; 
+
+static void* parallel_worker(void* arg)
+{
+    Work_queue* queue = arg; 
+    for (;;)
+    {
+        pthread_mutex_lock(&queue->lock); 
+        size_t index = queue->next++; 
+        pthread_mutex_unlock(&queue->lock); 
+
+        if (index >= queue->count)
+            return NULL; 
+        queue->fn(queue->arg, index); 
+    }
+}
+
+void parallel_for(size_t count, int workers, void (*fn)(void* arg, size_t index), void* arg)
+{
+    if (workers < 1)
+        workers = 1; 
+    if ((size_t)workers > count)
+        workers = count; 
+
+    Work_queue queue = {count, 0, PTHREAD_MUTEX_INITIALIZER, fn, arg}; 
+
+    /* the calling thread is the last worker */ 
+    int helpers = workers - 1; 
+    pthread_t* threads = NULL; 
+    if (helpers > 0 && !(threads = malloc(helpers * sizeof(pthread_t))))
+    {
+        fprintf(stderr, "Error: out of memory\n"); 
+        exit(1); 
+    }
+
+    int started = 0; 
+    for (; started < helpers; started++)
+    {
+        if (pthread_create(&threads[started], NULL, parallel_worker, &queue))
+            break; /* whoever is running picks up the rest */ 
+    }
+    parallel_worker(&queue); 
+
+    for (int i = 0; i < started; i++)
+        pthread_join(threads[i], NULL); 
+
+    free(threads); 
+    pthread_mutex_destroy(&queue.lock); 
+}
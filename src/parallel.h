@@ -0,0 +1,11 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h> 
+
+/* calls fn(arg, i) for every i in [0, count) on up to workers threads, 
+ * the calling thread is one of them. indices are handed out in increasing 
+ * order but may finish in any order, returns once they are all done */ 
+void parallel_for(size_t count, int workers, void (*fn)(void* arg, size_t index), void* arg); 
+
+#endif
@@ -1,36 +1,54 @@
-%debug
-%glr-parser
+/* deterministic LALR(1), the debug tables are only built with make DEBUG=1 */
+%expect 0
+%define api.push-pull both
 %{
 #include "types.h"
 #include "ast.h"
 #include <stdlib.h> 
 #include <string.h> 
 #include <stdio.h> 
-AST_node* program_node = NULL; //main program node
+#include "error.h"
+%}
 
-extern int yylex(); 
-void yyerror(const char *s) {fprintf(stderr, "\033[31mError: %s\n", s); exit(2);} 
+%code {
+int yylex(YYSTYPE* yylval, yyscan_t scanner); 
+void yyerror(yyscan_t scanner, AST_node** program, const char *s) 
+{
+    (void)scanner; (void)program; 
+    error_fatal(2, "\033[31mError: %s\n", s); 
+}
 
 //#define YYMAXDEPTH 10000 /*bigger stack size*/ 
-//int yydebug = 1; /*enable debugging*/ 
-%}
+}
 
-/* 
 %code requires { 
-    void parser_init(void);
+    /* the scanner state, opaque here. guarded like in the lexer.h flex generates */ 
+    #ifndef YY_TYPEDEF_YY_SCANNER_T
+    #define YY_TYPEDEF_YY_SCANNER_T
+    typedef void* yyscan_t; 
+    #endif
+}
+
+%code provides {
+    /* push parser: feed the tokens one at a time as they arrive, 
+     * returns YYPUSH_MORE until the program is complete */ 
+    int parser_push_token(yypstate* state, int token, const YYSTYPE* value, 
+                          yyscan_t scanner, AST_node** program); 
+    /* pulls the tokens from the scanner and pushes them, 
+     * the caller owns the state so it can free it if an error unwinds */ 
+    int parse_stream(yypstate* state, yyscan_t scanner, AST_node** program); 
 }
-*/ 
 
 %union {
 
     AST_node* node; /* used for non-terminal symbols for the grammar */
 
     int tok; 
-    char* str; //for identifiers 
+    Symbol sym; //for identifiers (interned) 
     Const_value val; 
 }
 
-%token <str> T_IDENTIFIER 
+%token <sym> T_IDENTIFIER 
 %token <val> T_INTEGER T_FLOAT T_BOOL T_CHAR T_ARRAY
 %token <tok> T_TYPEINT T_TYPEFLOAT T_TYPEBOOL T_TYPECHAR
 %token <tok> T_PLUS T_MINUS T_MULT T_DIV T_IDIV T_MOD T_AND T_OR T_NOT
@@ -40,11 +58,12 @@ void yyerror(const char *s) {fprintf(stderr, "\033[31mError: %s\n", s); exit(2);
 %token <tok> T_IF T_ELSE T_ENDIF T_THEN T_WHILE T_ENDWHILE T_FOR T_ENDFOR T_DE T_TO T_DO
 %token <tok> T_REPEAT T_UNTILL 
 %token <tok> T_PRINT 
+%token <tok> T_READ 
 
 
 // defining non terminals
-%type <node> program optional_statements statements statement assignment for_loop_stmt while_loop_stmt dowhile_loop_stmt expression const_value id_ref if_stmt elif optional_elif optional_else fun_declaration var_declaration declaration declarations new_type_decls new_type_decl array_type_decl matrix_type_decl TDOG optional_TDOG optional_TDOL TDOL TDNT optional_TDNT optional_subprogram_defs subprogram_defs subprogram_def function_def optional_params params param print_stmt optional_args args arg
-return_stmt call_fn arr_sub mat_sub type_ref lvalue statement_block
+%type <node> program optional_statements statements statement assignment for_loop_stmt while_loop_stmt dowhile_loop_stmt expression const_value id_ref if_stmt optional_else fun_declaration var_declaration declaration declarations new_type_decls new_type_decl array_type_decl matrix_type_decl TDOG optional_TDOG optional_TDOL TDOL TDNT optional_TDNT optional_subprogram_defs subprogram_defs subprogram_def function_def optional_params params param print_stmt read_stmt read_args optional_args args arg
+return_stmt call_fn arr_sub mat_sub type_ref lvalue statement_block if_head
 
 
 //precedences 
@@ -65,9 +84,14 @@ return_stmt call_fn arr_sub mat_sub type_ref lvalue statement_block
 %start program
 
 %define parse.error verbose
+/* reentrant: the scanner and the result are passed around, 
+ * files can be parsed on several threads at once */ 
+%define api.pure full
+%param {yyscan_t scanner}
+%parse-param {AST_node** program}
 
 %%
-    program : optional_TDNT optional_subprogram_defs optional_TDOG statement_block {program_node = ast_program_create($1, $2, $3, $4);}
+    program : optional_TDNT optional_subprogram_defs optional_TDOG statement_block {*program = ast_program_create($1, $2, $3, $4);}
 
     optional_TDNT: TDNT {$$ = $1;}
                 | /*empty*/ {$$ = NULL;}
@@ -159,19 +183,17 @@ return_stmt call_fn arr_sub mat_sub type_ref lvalue statement_block
                 | dowhile_loop_stmt {$$ = $1;}
                 | return_stmt {$$ = $1;}
                 | print_stmt {$$ = $1;}
+                | read_stmt {$$ = $1;}
 
     assignment: lvalue T_ASSIGN expression {$$ = ast_assign_node_create($1, $3);}
 
-    if_stmt: T_IF expression T_THEN statement_block optional_elif optional_else T_ENDIF {$$ = ast_if_node_create($2, $4, $5, $6);}
-
-    optional_elif: elif {$$ = $1;}
-                | /*empty*/ {$$ = NULL;}
+    if_stmt: if_head optional_else T_ENDIF {ast_if_node_set_else($1, $2); $$ = $1;}
 
-    elif: elif T_ELSE T_IF expression T_THEN statement_block{
-                    ast_elif_node_insert($1, ast_branch_node_create($4, $6)); 
-                    }
-                | T_ELSE T_IF expression T_THEN statement_block{
-                    $$ = ast_elif_node_create(ast_branch_node_create($3, $5)); 
+    /* the elif branches are folded into the head so T_ELSE is always shifted, 
+     * the token after it (T_IF or T_BEGIN) picks elif or else */ 
+    if_head: T_IF expression T_THEN statement_block {$$ = ast_if_node_create($2, $4, NULL, NULL);}
+                | if_head T_ELSE T_IF expression T_THEN statement_block{
+                    ast_if_node_add_elif($1, ast_branch_node_create($4, $6)); 
                     }
 
     optional_else: T_ELSE statement_block {$$ = $2;}
@@ -185,6 +207,11 @@ return_stmt call_fn arr_sub mat_sub type_ref lvalue statement_block
 
     print_stmt: T_PRINT T_LPAREN optional_args T_RPAREN {$$ = ast_print_node_create($3);}
 
+    read_stmt: T_READ T_LPAREN read_args T_RPAREN {$$ = ast_read_node_create($3);}
+
+    read_args: read_args T_COMMA lvalue {ast_args_insert($1, ast_arg_create($3));}
+        | lvalue {$$ = ast_args_create(ast_arg_create($1));}
+
     return_stmt: T_RETURN expression {$$ = ast_return_node_create($2);}
 
     optional_args: args {$$ = $1;}
@@ -227,3 +254,23 @@ return_stmt call_fn arr_sub mat_sub type_ref lvalue statement_block
 
 
 %%
+
+int parser_push_token(yypstate* state, int token, const YYSTYPE* value, 
+                      yyscan_t scanner, AST_node** program)
+{
+    return yypush_parse(state, token, value, scanner, program); 
+}
+
+int parse_stream(yypstate* state, yyscan_t scanner, AST_node** program)
+{
+    YYSTYPE value; 
+    int status; 
+
+    do 
+    {
+        int token = yylex(&value, scanner); 
+        status = parser_push_token(state, token, &value, scanner, program); 
+    } while (status == YYPUSH_MORE); 
+
+    return status; 
+}
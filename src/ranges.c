@@ -0,0 +1,411 @@
+#include <stdint.h>
+
+#include "ranges.h"
+#include "builtins.h"
+
+typedef struct Range_s {
+    int64_t lo; 
+    int64_t hi; 
+    bool empty; /* nothing was assigned yet */ 
+} Range; 
+
+typedef struct Range_var_s {
+    Symbol name; 
+    AST_var_declaration_node* decl; /* NULL for a parameter */ 
+    bool is_array;  /* its range is the one of its elements */ 
+    bool escapes;   /* used as a whole value, keeps its layout */ 
+    Range range; 
+} Range_var; 
+
+typedef struct Range_scope_s {
+    Range_var* vars; /* the integer variables and arrays of integers */ 
+    size_t count; 
+    size_t pass; 
+    bool changed; 
+} Range_scope; 
+
+static const Range range_full = {INT32_MIN, INT32_MAX, false}; 
+static const Range range_none = {0, 0, true}; 
+
+static inline Range range_of(int64_t lo, int64_t hi)
+{
+    /* the generated code wraps, a bound out of int is anything */ 
+    if (lo < INT32_MIN || hi > INT32_MAX)
+        return range_full; 
+    return (Range){lo, hi, false}; 
+}
+
+static inline Range range_join(Range a, Range b)
+{
+    if (a.empty)
+        return b; 
+    if (b.empty)
+        return a; 
+    return (Range){a.lo < b.lo ? a.lo : b.lo, a.hi > b.hi ? a.hi : b.hi, false}; 
+}
+
+static inline int64_t magnitude(Range r)
+{
+    return -r.lo > r.hi ? -r.lo : r.hi; 
+}
+
+static bool is_int_storage(Type* type, bool* is_array)
+{
+    *is_array = false; 
+    if (TYPE_IS_ARRAY(type))
+    {
+        *is_array = true; 
+        type = ((Array_type*)type)->element_type; 
+    }
+    else if (TYPE_IS_MATRIX(type))
+    {
+        *is_array = true; 
+        type = ((Matrix_type*)type)->element_type; 
+    }
+    return type == TYPE_INT; 
+}
+
+static void scope_add(Range_scope* scope, Symbol name, Type* type, AST_var_declaration_node* decl)
+{
+    bool is_array; 
+    if (!is_int_storage(type, &is_array))
+        return; 
+    /* parameters come from the caller, anything fits */ 
+    scope->vars[scope->count++] = (Range_var){name, decl, is_array, false, decl ? range_none : range_full}; 
+}
+
+static Range_var* scope_find(Range_scope* scope, Symbol name)
+{
+    for (size_t i = 0; i < scope->count; i++)
+    {
+        if (scope->vars[i].name == name)
+            return &scope->vars[i]; 
+    }
+    return NULL; 
+}
+
+/* joins value into var, bounds that keep growing are widened so the passes end */ 
+static void var_store(Range_scope* scope, Range_var* var, Range value)
+{
+    if (!var)
+        return; 
+    Range joined = range_join(var->range, value); 
+    if (joined.empty || (!var->range.empty && joined.lo == var->range.lo && joined.hi == var->range.hi))
+        return; 
+    if (scope->pass >= RANGES_WIDEN_PASS && !var->range.empty)
+    {
+        if (joined.lo < var->range.lo)
+            joined.lo = INT32_MIN; 
+        if (joined.hi > var->range.hi)
+            joined.hi = INT32_MAX; 
+    }
+    var->range = joined; 
+    scope->changed = true; 
+}
+
+static Range eval_exp(Range_scope* scope, AST_node* exp); 
+
+static Range eval_op(Range_scope* scope, AST_op_node* node)
+{
+    Range l = eval_exp(scope, node->lhs); 
+    Range r = op_binary(node->op_type) ? eval_exp(scope, node->rhs) : range_none; 
+    if (node->res_type != TYPE_INT)
+        return range_full; 
+    if (l.empty || (op_binary(node->op_type) && r.empty))
+        return range_none; 
+
+    switch (node->op_type)
+    {
+        case OP_ADD:
+            return range_of(l.lo + r.lo, l.hi + r.hi); 
+        case OP_SUB:
+            return range_of(l.lo - r.hi, l.hi - r.lo); 
+        case OP_UMIN:
+            return range_of(-l.hi, -l.lo); 
+        case OP_MUL:
+        {
+            int64_t p[4] = {l.lo * r.lo, l.lo * r.hi, l.hi * r.lo, l.hi * r.hi}; 
+            int64_t lo = p[0], hi = p[0]; 
+            for (int i = 1; i < 4; i++)
+            {
+                lo = p[i] < lo ? p[i] : lo; 
+                hi = p[i] > hi ? p[i] : hi; 
+            }
+            return range_of(lo, hi); 
+        }
+        case OP_IDIV:
+        {
+            /* truncated, never larger than the dividend */ 
+            int64_t m = magnitude(l); 
+            return range_of(-m, m); 
+        }
+        case OP_MOD:
+        {
+            /* smaller than the divisor, with the sign of the dividend */ 
+            int64_t m = magnitude(r) - 1; 
+            int64_t ml = magnitude(l); 
+            m = ml < m ? ml : m; 
+            if (m < 0)
+                m = 0; 
+            return range_of(l.lo >= 0 ? 0 : -m, l.hi <= 0 ? 0 : m); 
+        }
+        default:
+            return range_full; 
+    }
+}
+
+static Range eval_args(Range_scope* scope, AST_node* args)
+{
+    if (args)
+    {
+        VEC_FOR_EACH(&((AST_args_node*)args)->args_list, item)
+        {
+            eval_exp(scope, ((AST_arg_node*)item)->exp); 
+        }
+    }
+    return range_full; 
+}
+
+static Range eval_exp(Range_scope* scope, AST_node* exp)
+{
+    if (!exp)
+        return range_none; 
+
+    switch (exp->type)
+    {
+        case NODE_CONST:
+        {
+            AST_const_node* node = (AST_const_node*)exp; 
+            if (node->val_type != VAL_INT)
+                return range_full; 
+            return range_of(node->value.ival, node->value.ival); 
+        }
+        case NODE_ID:
+        {
+            Range_var* var = scope_find(scope, ((AST_id_node*)exp)->id); 
+            if (!var)
+                return range_full; 
+            if (var->is_array)
+            {
+                var->escapes = true; 
+                return range_full; 
+            }
+            return var->range; 
+        }
+        case NODE_ARR_SUB:
+        case NODE_MAT_SUB:
+        {
+            AST_node* id_node; 
+            if (exp->type == NODE_ARR_SUB)
+            {
+                eval_exp(scope, ((AST_arr_sub_node*)exp)->exp); 
+                id_node = ((AST_arr_sub_node*)exp)->id_node; 
+            }
+            else
+            {
+                eval_exp(scope, ((AST_mat_sub_node*)exp)->exp[0]); 
+                eval_exp(scope, ((AST_mat_sub_node*)exp)->exp[1]); 
+                id_node = ((AST_mat_sub_node*)exp)->id_node; 
+            }
+            Range_var* var = scope_find(scope, ((AST_id_node*)id_node)->id); 
+            return var ? var->range : range_full; 
+        }
+        case NODE_OP:
+            return eval_op(scope, (AST_op_node*)exp); 
+        case NODE_CALL:
+        {
+            AST_call_node* call = (AST_call_node*)exp; 
+            eval_args(scope, call->args); 
+            if (call->callee)
+                return range_full; 
+            Function_type* fn_type = (Function_type*)call->fun_type; 
+            const Builtin_prototype* builtin = builtins_find(((AST_id_node*)call->id_node)->id, 
+                                                             fn_type->param_types, fn_type->param_count); 
+            if (!builtin || !builtin->ret_range)
+                return range_full; 
+            return range_of(builtin->ret_range->lo, builtin->ret_range->hi); 
+        }
+        default:
+            return range_full; 
+    }
+}
+
+static Range_var* dest_var(Range_scope* scope, AST_node* dest)
+{
+    AST_node* id_node = dest; 
+    if (dest->type == NODE_ARR_SUB)
+        id_node = ((AST_arr_sub_node*)dest)->id_node; 
+    else if (dest->type == NODE_MAT_SUB)
+        id_node = ((AST_mat_sub_node*)dest)->id_node; 
+
+    Range_var* var = scope_find(scope, ((AST_id_node*)id_node)->id); 
+    /* a whole array is replaced */ 
+    if (var && var->is_array && dest->type == NODE_ID)
+        var->escapes = true; 
+    return var; 
+}
+
+static void eval_stmt(Range_scope* scope, AST_node* stmt)
+{
+    if (!stmt)
+        return; 
+
+    switch (stmt->type)
+    {
+        case NODE_STATEMENTS:
+            VEC_FOR_EACH(&((AST_statements_node*)stmt)->stmts_list, item)
+            {
+                eval_stmt(scope, item); 
+            }
+            break; 
+        case NODE_ASSIGN:
+        {
+            AST_assign_node* node = (AST_assign_node*)stmt; 
+            /* evaluates the subscripts */ 
+            eval_exp(scope, node->dest); 
+            Range value = eval_exp(scope, node->assign_exp); 
+            var_store(scope, dest_var(scope, node->dest), value); 
+            break; 
+        }
+        case NODE_IF:
+        {
+            AST_if_node* node = (AST_if_node*)stmt; 
+            eval_exp(scope, node->cond); 
+            eval_stmt(scope, node->action); 
+            if (node->elif_branches)
+            {
+                VEC_FOR_EACH(&((AST_elif_node*)node->elif_branches)->branches_list, item)
+                {
+                    eval_exp(scope, ((AST_branch_node*)item)->cond); 
+                    eval_stmt(scope, ((AST_branch_node*)item)->action); 
+                }
+            }
+            eval_stmt(scope, node->else_action); 
+            break; 
+        }
+        case NODE_FOR:
+        {
+            AST_for_node* node = (AST_for_node*)stmt; 
+            Range from = eval_exp(scope, node->from); 
+            Range to = eval_exp(scope, node->to); 
+            /* from up to to in the body, one past the last value once it's done */ 
+            Range counter = from; 
+            if (!from.empty && !to.empty)
+                counter = range_of(from.lo, from.hi > to.hi + 1 ? from.hi : to.hi + 1); 
+            var_store(scope, dest_var(scope, node->iter), counter); 
+            eval_stmt(scope, node->statements); 
+            break; 
+        }
+        case NODE_WHILE:
+            eval_exp(scope, ((AST_while_node*)stmt)->cond); 
+            eval_stmt(scope, ((AST_while_node*)stmt)->statements); 
+            break; 
+        case NODE_DOWHILE:
+            eval_stmt(scope, ((AST_dowhile_node*)stmt)->statements); 
+            eval_exp(scope, ((AST_dowhile_node*)stmt)->cond); 
+            break; 
+        case NODE_RETURN:
+            eval_exp(scope, ((AST_return_node*)stmt)->exp); 
+            break; 
+        case NODE_PRINT:
+            eval_args(scope, ((AST_print_node*)stmt)->args); 
+            break; 
+        case NODE_READ:
+            /* anything can come from the input */ 
+            VEC_FOR_EACH(&((AST_args_node*)((AST_read_node*)stmt)->args)->args_list, item)
+            {
+                AST_node* dest = ((AST_arg_node*)item)->exp; 
+                eval_exp(scope, dest); 
+                var_store(scope, dest_var(scope, dest), range_full); 
+            }
+            break; 
+        default:
+            break; 
+    }
+}
+
+static size_t narrow_scope(const char* scope_name, AST_node* params, AST_node* decls, AST_node* stmts, FILE* report)
+{
+    size_t vars_count = 0; 
+    if (params)
+        vars_count += VEC_size(&((AST_params_node*)params)->params_list); 
+    if (decls)
+        vars_count += VEC_size(&((AST_declarations_node*)decls)->var_decls_list); 
+    if (vars_count == 0)
+        return 0; 
+
+    Range_scope scope = {0}; 
+    scope.vars = malloc(vars_count * sizeof(Range_var)); 
+    if (!scope.vars)
+    {
+        fprintf(stderr, "Error: out of memory\n"); 
+        exit(1); 
+    }
+    if (params)
+    {
+        VEC_FOR_EACH(&((AST_params_node*)params)->params_list, item)
+        {
+            AST_param_node* param = item; 
+            scope_add(&scope, ((AST_id_node*)param->id_node)->id, ((AST_type_node*)param->id_type)->id_type, NULL); 
+        }
+    }
+    if (decls)
+    {
+        VEC_FOR_EACH(&((AST_declarations_node*)decls)->var_decls_list, item)
+        {
+            AST_var_declaration_node* decl = item; 
+            scope_add(&scope, ((AST_id_node*)decl->id_node)->id, ((AST_type_node*)decl->id_type)->id_type, decl); 
+        }
+    }
+
+    do
+    {
+        scope.changed = false; 
+        eval_stmt(&scope, stmts); 
+        scope.pass++; 
+    } while (scope.changed); 
+
+    size_t narrowed = 0; 
+    for (size_t i = 0; i < scope.count; i++)
+    {
+        Range_var* var = &scope.vars[i]; 
+        if (!var->decl || !var->is_array || var->escapes)
+            continue; 
+
+        /* never stored, its elements are undefined anyway */ 
+        Range r = var->range.empty ? range_of(0, 0) : var->range; 
+        if (r.lo >= INT8_MIN && r.hi <= INT8_MAX)
+            var->decl->narrow_bits = 8; 
+        else if (r.lo >= INT16_MIN && r.hi <= INT16_MAX)
+            var->decl->narrow_bits = 16; 
+        else
+            continue; 
+
+        narrowed++; 
+        if (report)
+            fprintf(report, "%s: %s stored on %u bits, elements in [%lld, %lld]\n",
+                    scope_name, symbol_name(var->name), var->decl->narrow_bits,
+                    (long long)r.lo, (long long)r.hi); 
+    }
+    free(scope.vars); 
+    return narrowed; 
+}
+
+size_t ranges_narrow(AST_node* program_node, FILE* report)
+{
+    AST_program_node* program = (AST_program_node*)program_node; 
+    size_t narrowed = 0; 
+
+    /* functions don't see the globals, every scope is analysed alone */ 
+    if (program->subprograms)
+    {
+        VEC_FOR_EACH(&((AST_subprograms_node*)program->subprograms)->functions_list, item)
+        {
+            AST_function_node* fn = item; 
+            narrowed += narrow_scope(symbol_name(((AST_id_node*)fn->id_node)->id),
+                                     fn->params, fn->declarations, fn->statements, report); 
+        }
+    }
+    narrowed += narrow_scope("main", NULL, program->declarations, program->statements, report); 
+    return narrowed; 
+}
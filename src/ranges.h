@@ -0,0 +1,19 @@
+#ifndef RANGES_H
+#define RANGES_H
+
+#include <stdio.h>
+
+#include "ast.h"
+
+#define RANGES_WIDEN_PASS 3 /* bounds still growing after this many passes jump to the integer limits */ 
+
+/* value range analysis of the integer variables and array elements of
+ * each scope, flow insensitive: a variable holds the union of everything
+ * assigned to it. integer arrays that are only used through subscripts
+ * and whose elements fit are stored on 8 or 16 bits (narrow_bits of their
+ * declaration). the tree has to be annotated by the semantic pass,
+ * the narrowed arrays are listed on report if it isn't NULL,
+ * returns how many were narrowed */ 
+size_t ranges_narrow(AST_node* program_node, FILE* report); 
+
+#endif
@@ -0,0 +1,394 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "frascal_rt.h"
+
+#define FLOAT_FAST_LIMIT 159 /* biased exponent of 2^32, larger floats go through snprintf */ 
+
+static struct {
+    size_t len; 
+    bool line_buffered; /* the output is a terminal */ 
+    char data[FRASCAL_RT_BUFFER_SIZE]; 
+} out; 
+
+#define READ_TOKEN_LEN 128 /* longest real number lire accepts */ 
+#define READ_FAST_MANTISSA (1 << 24) /* mantissas up to it are exact floats */ 
+#define READ_FAST_EXPONENT 10 /* and so are the powers of ten up to it */ 
+
+static struct {
+    size_t pos; 
+    size_t len; 
+    char data[FRASCAL_RT_BUFFER_SIZE]; 
+} in; 
+
+static const float powers_of_ten[READ_FAST_EXPONENT + 1] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f, 
+}; 
+
+static const char digit_pairs[] =
+    "00010203040506070809" "10111213141516171819" "20212223242526272829"
+    "30313233343536373839" "40414243444546474849" "50515253545556575859"
+    "60616263646566676869" "70717273747576777879" "80818283848586878889"
+    "90919293949596979899"; 
+
+static void write_all(const char* data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t written = write(STDOUT_FILENO, data, len); 
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue; 
+            /* nobody to report to, the rest is lost like with stdio */ 
+            return; 
+        }
+        data += written; 
+        len -= written; 
+    }
+}
+
+void frascal_rt_flush(void)
+{
+    write_all(out.data, out.len); 
+    out.len = 0; 
+}
+
+__attribute__((constructor))
+static void frascal_rt_init(void)
+{
+    out.line_buffered = isatty(STDOUT_FILENO); 
+    atexit(frascal_rt_flush); 
+}
+
+/* room for len more bytes */ 
+static inline char* reserve(size_t len)
+{
+    if (out.len + len > FRASCAL_RT_BUFFER_SIZE)
+        frascal_rt_flush(); 
+    return out.data + out.len; 
+}
+
+/* writes the digits of value backward from end, returns the first one */ 
+static char* format_digits(char* end, uint64_t value)
+{
+    while (value >= 100)
+    {
+        unsigned pair = (value % 100) * 2; 
+        value /= 100; 
+        *--end = digit_pairs[pair + 1]; 
+        *--end = digit_pairs[pair]; 
+    }
+    if (value >= 10)
+    {
+        *--end = digit_pairs[value * 2 + 1]; 
+        *--end = digit_pairs[value * 2]; 
+    }
+    else
+        *--end = '0' + value; 
+    return end; 
+}
+
+size_t frascal_rt_format_int(char* str, int32_t value)
+{
+    char digits[16]; 
+    char* end = digits + sizeof(digits); 
+    /* the magnitude of INT32_MIN only fits unsigned */ 
+    uint32_t magnitude = value < 0 ? -(uint32_t)value : (uint32_t)value; 
+    char* first = format_digits(end, magnitude); 
+    if (value < 0)
+        *--first = '-'; 
+
+    size_t len = end - first; 
+    memcpy(str, first, len); 
+    return len; 
+}
+
+/* a float is m * 2^e with m on 24 bits, below 2^32 the value in
+ * millionths fits 64 bits and is rounded exactly, half to even like
+ * printf does, the 6 decimals are then plain integer digits */ 
+size_t frascal_rt_format_float(char* str, float value)
+{
+    uint32_t bits; 
+    memcpy(&bits, &value, sizeof(bits)); 
+    bool negative = bits >> 31; 
+    unsigned exponent = (bits >> 23) & 0xff; 
+    uint64_t mantissa = bits & 0x7fffff; 
+
+    if (exponent >= FLOAT_FAST_LIMIT)
+        return snprintf(str, FRASCAL_RT_NUMBER_LEN, "%f", (double)value); 
+
+    int shift; 
+    if (exponent == 0)
+        shift = -149; 
+    else
+    {
+        mantissa |= 1u << 23; 
+        shift = (int)exponent - 150; 
+    }
+
+    uint64_t millionths = mantissa * 1000000; 
+    if (shift >= 0)
+        millionths <<= shift; 
+    else if (shift <= -64)
+        millionths = 0; /* below 2^-20, the product rounds to 0 */ 
+    else
+    {
+        uint64_t rest = millionths & ((UINT64_C(1) << -shift) - 1); 
+        uint64_t half = UINT64_C(1) << (-shift - 1); 
+        millionths >>= -shift; 
+        if (rest > half || (rest == half && (millionths & 1)))
+            millionths++; 
+    }
+
+    char digits[32]; 
+    char* end = digits + sizeof(digits); 
+    char* first = end - 6; 
+    uint64_t decimals = millionths % 1000000; 
+    for (char* digit = end; digit != first; decimals /= 10)
+        *--digit = '0' + decimals % 10; 
+    *--first = '.'; 
+    first = format_digits(first, millionths / 1000000); 
+    if (negative)
+        *--first = '-'; 
+
+    size_t len = end - first; 
+    memcpy(str, first, len); 
+    return len; 
+}
+
+void frascal_rt_emit_int(int32_t value)
+{
+    out.len += frascal_rt_format_int(reserve(FRASCAL_RT_NUMBER_LEN), value); 
+}
+
+void frascal_rt_emit_float(float value)
+{
+    out.len += frascal_rt_format_float(reserve(FRASCAL_RT_NUMBER_LEN), value); 
+}
+
+void frascal_rt_emit_bool(bool value)
+{
+    memcpy(reserve(4), value ? "vrai" : "faux", 4); 
+    out.len += 4; 
+}
+
+void frascal_rt_emit_char(char c)
+{
+    *reserve(1) = c; 
+    out.len++; 
+    if (c == '\n' && out.line_buffered)
+        frascal_rt_flush(); 
+}
+
+void frascal_rt_emit_str(const char* str, size_t len)
+{
+    if (len > FRASCAL_RT_BUFFER_SIZE)
+    {
+        frascal_rt_flush(); 
+        write_all(str, len); 
+        return; 
+    }
+    memcpy(reserve(len), str, len); 
+    out.len += len; 
+    if (out.line_buffered && memchr(str, '\n', len))
+        frascal_rt_flush(); 
+}
+
+void frascal_rt_bounds_fail(int32_t index, int32_t size)
+{
+    /* what was printed before the bad access comes first */ 
+    frascal_rt_flush(); 
+    fprintf(stderr, "Error: index %d out of the bounds of %d elements\n", (int)index, (int)size); 
+    exit(1); 
+}
+
+/* the next block of the input, false at its end */ 
+static bool refill(void)
+{
+    /* a prompt is shown before waiting for the answer */ 
+    if (out.line_buffered)
+        frascal_rt_flush(); 
+
+    ssize_t count; 
+    do
+        count = read(STDIN_FILENO, in.data, FRASCAL_RT_BUFFER_SIZE); 
+    while (count < 0 && errno == EINTR); 
+
+    in.pos = 0; 
+    in.len = count > 0 ? (size_t)count : 0; 
+    return in.len > 0; 
+}
+
+/* the current character, EOF past the end of the input */ 
+static inline int peek(void)
+{
+    if (in.pos == in.len && !refill())
+        return EOF; 
+    return (unsigned char)in.data[in.pos]; 
+}
+
+static inline bool is_blank(int c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f'; 
+}
+
+static inline bool is_digit(int c)
+{
+    return c >= '0' && c <= '9'; 
+}
+
+static void skip_blanks(void)
+{
+    while (is_blank(peek()))
+        in.pos++; 
+}
+
+__attribute__((noreturn, cold))
+static void read_fail(const char* expected)
+{
+    frascal_rt_flush(); 
+    if (peek() == EOF)
+        fprintf(stderr, "Error: expected %s, the input ended\n", expected); 
+    else
+        fprintf(stderr, "Error: expected %s in the input\n", expected); 
+    exit(1); 
+}
+
+/* a leading sign, true for minus */ 
+static bool read_sign(void)
+{
+    int c = peek(); 
+    if (c == '-' || c == '+')
+        in.pos++; 
+    return c == '-'; 
+}
+
+int32_t frascal_rt_read_int(void)
+{
+    skip_blanks(); 
+    bool negative = read_sign(); 
+    if (!is_digit(peek()))
+        read_fail("an integer"); 
+
+    /* the digits in the block are scanned without going through peek */ 
+    uint64_t limit = negative ? (uint64_t)INT32_MAX + 1 : INT32_MAX; 
+    uint64_t value = 0; 
+    do
+    {
+        const char* digit = in.data + in.pos; 
+        const char* end = in.data + in.len; 
+        while (digit != end && is_digit(*digit))
+        {
+            value = value * 10 + (*digit++ - '0'); 
+            if (value > limit)
+                read_fail("an integer that fits 32 bits"); 
+        }
+        in.pos = digit - in.data; 
+    } while (in.pos == in.len && refill()); 
+
+    return negative ? (int32_t)-(int64_t)value : (int32_t)value; 
+}
+
+/* appends the digits to token and to mantissa while it stays exact,
+ * the others are counted in dropped. returns how many there were */ 
+static size_t read_digits(char* token, size_t* len, uint64_t* mantissa, int* dropped)
+{
+    size_t count = 0; 
+    for (int c = peek(); is_digit(c); c = peek())
+    {
+        /* room for the sign, the point, the e and its sign */ 
+        if (*len == READ_TOKEN_LEN - 4)
+            read_fail("a shorter real number"); 
+        token[(*len)++] = c; 
+        in.pos++; 
+        count++; 
+        if (*mantissa <= READ_FAST_MANTISSA)
+            *mantissa = *mantissa * 10 + (c - '0'); 
+        else
+            (*dropped)++; 
+    }
+    return count; 
+}
+
+/* short numbers are exact in float arithmetic, the others go to strtof
+ * which rounds correctly whatever the number of digits */ 
+float frascal_rt_read_float(void)
+{
+    char token[READ_TOKEN_LEN]; 
+    size_t len = 0; 
+    uint64_t mantissa = 0; 
+    int dropped = 0; 
+
+    skip_blanks(); 
+    bool negative = read_sign(); 
+    if (negative)
+        token[len++] = '-'; 
+
+    size_t digits = read_digits(token, &len, &mantissa, &dropped); 
+    int exponent = 0; 
+    if (peek() == '.')
+    {
+        token[len++] = '.'; 
+        in.pos++; 
+        size_t decimals = read_digits(token, &len, &mantissa, &dropped); 
+        exponent -= decimals; 
+        digits += decimals; 
+    }
+    if (digits == 0)
+        read_fail("a real number"); 
+
+    int c = peek(); 
+    if (c == 'e' || c == 'E')
+    {
+        token[len++] = 'e'; 
+        in.pos++; 
+        bool exponent_negative = read_sign(); 
+        if (exponent_negative)
+            token[len++] = '-'; 
+        uint64_t power = 0; 
+        if (read_digits(token, &len, &power, &dropped) == 0)
+            read_fail("a real number"); 
+        exponent += exponent_negative ? -(int)power : (int)power; 
+    }
+
+    if (dropped == 0 && mantissa <= READ_FAST_MANTISSA
+        && exponent >= -READ_FAST_EXPONENT && exponent <= READ_FAST_EXPONENT)
+    {
+        float value = (float)mantissa; 
+        value = exponent < 0 ? value / powers_of_ten[-exponent] : value * powers_of_ten[exponent]; 
+        return negative ? -value : value; 
+    }
+    token[len] = '\0'; 
+    return strtof(token, NULL); 
+}
+
+bool frascal_rt_read_bool(void)
+{
+    skip_blanks(); 
+    char word[5]; 
+    size_t len = 0; 
+    for (int c = peek(); len < sizeof(word) && ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')); c = peek())
+    {
+        word[len++] = c | 0x20; 
+        in.pos++; 
+    }
+    if (len == 4 && memcmp(word, "vrai", 4) == 0)
+        return true; 
+    if (len == 4 && memcmp(word, "faux", 4) == 0)
+        return false; 
+    read_fail("VRAI or FAUX"); 
+}
+
+char frascal_rt_read_char(void)
+{
+    skip_blanks(); 
+    int c = peek(); 
+    if (c == EOF)
+        read_fail("a character"); 
+    in.pos++; 
+    return c; 
+}
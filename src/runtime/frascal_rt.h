@@ -0,0 +1,46 @@
+#ifndef FRASCAL_RT_H
+#define FRASCAL_RT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* the runtime linked into every frascal program. ecrire is lowered to the
+ * typed emit functions, they append to one buffer that is written to the
+ * standard output when it fills up, at exit, and after each line when the
+ * output is a terminal. lire is lowered to the typed read functions.
+ * programs are single threaded, nothing is locked */ 
+
+#define FRASCAL_RT_BUFFER_SIZE (1 << 18)
+#define FRASCAL_RT_NUMBER_LEN 64 /* longest text of an int or a float */ 
+
+void frascal_rt_emit_int(int32_t value); 
+/* formatted like printf("%f") */ 
+void frascal_rt_emit_float(float value); 
+/* vrai or faux */ 
+void frascal_rt_emit_bool(bool value); 
+void frascal_rt_emit_char(char c); 
+void frascal_rt_emit_str(const char* str, size_t len); 
+
+/* lire reads stdin by blocks of FRASCAL_RT_BUFFER_SIZE and parses the
+ * values out of the block. each one skips the blanks before it, a missing
+ * or malformed value ends the program with an error */ 
+int32_t frascal_rt_read_int(void); 
+float frascal_rt_read_float(void); 
+/* VRAI or FAUX, in any case */ 
+bool frascal_rt_read_bool(void); 
+/* the next character that isn't blank */ 
+char frascal_rt_read_char(void); 
+
+/* writes out what the buffer holds */ 
+void frascal_rt_flush(void); 
+
+/* the failure path of the bounds checks, never returns */ 
+void frascal_rt_bounds_fail(int32_t index, int32_t size); 
+
+/* the text of value without the buffer, returns its length.
+ * the compiler formats the constants of ecrire with it */ 
+size_t frascal_rt_format_int(char* out, int32_t value); 
+size_t frascal_rt_format_float(char* out, float value); 
+
+#endif
@@ -0,0 +1,411 @@
+#include "semantic.h"
+#include "builtins.h"
+#include "error.h"
+
+#define MAX_PRINT_ARGS 128
+
+static void check_new_types(Semantic_ctx* ctx, AST_node* new_types); 
+static void check_function(Semantic_ctx* ctx, AST_function_node* fn); 
+static void check_declarations(Semantic_ctx* ctx, AST_node* decls); 
+static void check_stmt(Semantic_ctx* ctx, AST_node* stmt); 
+static Type* check_exp(Semantic_ctx* ctx, AST_node* exp); 
+static Type* check_lval(Semantic_ctx* ctx, AST_node* lval); 
+
+void semantic_init(Semantic_ctx* ctx)
+{
+    ctx->sym_tab = st_create(); 
+    ctx->current_fn_ret_type = NULL; 
+    builtins_declare(ctx->sym_tab); 
+}
+
+void semantic_cleanup(Semantic_ctx* ctx)
+{
+    st_free(ctx->sym_tab); 
+    ctx->sym_tab = NULL; 
+}
+
+/* annotates a type node with the type it names */ 
+static Type* check_type(Semantic_ctx* ctx, AST_node* type)
+{
+    AST_type_node* node = (AST_type_node*)type; 
+    if (node->type_kind == TYPE_NODE_PRIMITIVE)
+        return node->id_type; 
+
+    St_entry* type_entry = st_find_type(ctx->sym_tab, node->id); 
+    if (!type_entry)
+    {
+        error_fatal(3, "Type %s is not defined\n", symbol_name(node->id)); 
+    }
+    node->id_type = type_entry->type; 
+    return node->id_type; 
+}
+
+static void check_new_types(Semantic_ctx* ctx, AST_node* new_types)
+{
+    if (!new_types)
+        return; 
+    VEC_FOR_EACH(&((AST_ntype_decls_node*)new_types)->new_type_decls_list, item)
+    {
+        AST_node* decl_node = item; 
+        AST_id_node* id_node; 
+        Type* new_type; 
+        switch (decl_node->type)
+        {
+            case NODE_ARRAY_TYPE_DECL:
+            {
+                AST_array_type_decl_node* node = (AST_array_type_decl_node*)decl_node; 
+                id_node = (AST_id_node*)node->id_node; 
+                new_type = type_array_create(check_type(ctx, node->element_type), node->size); 
+            }
+            break; 
+            case NODE_MATRIX_TYPE_DECL:
+            {
+                AST_matrix_type_decl_node* node = (AST_matrix_type_decl_node*)decl_node; 
+                id_node = (AST_id_node*)node->id_node; 
+                new_type = type_matrix_create(check_type(ctx, node->element_type), node->size[0], node->size[1]); 
+            }
+            break; 
+            default:
+                assert(0); 
+        }
+        if (st_insert_type(ctx->sym_tab, id_node->id, new_type) == ST_ALREADY_DECLARED)
+        {
+            error_fatal(3, "Error : type %s declared twice\n", symbol_name(id_node->id)); 
+        }
+    }
+}
+
+/* the last statement executed has to be a return, nested blocks end with their last statement */ 
+static bool ends_with_return(AST_node* stmts)
+{
+    if (!stmts || stmts->type != NODE_STATEMENTS)
+        return stmts && stmts->type == NODE_RETURN; 
+
+    Vector* list = &((AST_statements_node*)stmts)->stmts_list; 
+    if (VEC_size(list) == 0)
+        return false; 
+    return ends_with_return(VEC_at(list, VEC_size(list) - 1)); 
+}
+
+static void check_function(Semantic_ctx* ctx, AST_function_node* fn)
+{
+    AST_params_node* params = (AST_params_node*)fn->params; 
+    Symbol fun_name = ((AST_id_node*)fn->id_node)->id; 
+
+    Vector param_types; 
+    VEC_init(&param_types, NULL); 
+    if (params != NULL)
+    {
+        VEC_FOR_EACH(&params->params_list, item)
+        {
+            VEC_push_back(&param_types, check_type(ctx, ((AST_param_node*)item)->id_type)); 
+        }
+    }
+    size_t params_count = VEC_size(&param_types); 
+
+    /* a function sees itself and the ones before it */ 
+    Type* ret_type = check_type(ctx, fn->ret_type); 
+    Type* fun_type = type_function_create(ret_type, (Type**)VEC_data(&param_types), params_count); 
+    VEC_free(&param_types); 
+    if (st_insert_fun(ctx->sym_tab, fun_name, fun_type, NULL, NULL) == ST_ALREADY_DECLARED)
+    {
+        error_fatal(3, "Error : function %s defined twice\n", symbol_name(fun_name)); 
+    }
+    st_find_fun(ctx->sym_tab, fun_name, ((Function_type*)fun_type)->param_types, params_count)->decl = fn; 
+
+    st_push_scope(ctx->sym_tab); 
+    ctx->current_fn_ret_type = ret_type; 
+
+    if (params != NULL)
+    {
+        size_t i = 0; 
+        VEC_FOR_EACH(&params->params_list, item)
+        {
+            AST_id_node* param_id = (AST_id_node*)((AST_param_node*)item)->id_node; 
+            st_insert_var(ctx->sym_tab, param_id->id, ((Function_type*)fun_type)->param_types[i], NULL); 
+            i++; 
+        }
+    }
+    check_declarations(ctx, fn->declarations); 
+    check_stmt(ctx, fn->statements); 
+
+    if (!ends_with_return(fn->statements))
+    {
+        error_fatal(3, "Error: missing a return statement\n"); 
+    }
+
+    ctx->current_fn_ret_type = NULL; 
+    st_pop_scope(ctx->sym_tab); 
+}
+
+static void check_declarations(Semantic_ctx* ctx, AST_node* decls)
+{
+    if (!decls)
+        return; 
+    VEC_FOR_EACH(&((AST_declarations_node*)decls)->var_decls_list, item)
+    {
+        AST_var_declaration_node* decl_node = item; 
+        AST_id_node* id_node = (AST_id_node*)decl_node->id_node; 
+
+        Type* decl_type = check_type(ctx, decl_node->id_type); 
+        if (st_insert_var(ctx->sym_tab, id_node->id, decl_type, NULL) == ST_ALREADY_DECLARED)
+        {
+            error_fatal(3, "Error : variable %s declared twice\n", symbol_name(id_node->id)); 
+        }
+    }
+}
+
+static void check_cond(Semantic_ctx* ctx, AST_node* cond)
+{
+    if (!type_equal(check_exp(ctx, cond), TYPE_BOOL))
+    {
+        error_fatal(3, "Error: the condition for the if statement is not a booleen\n"); 
+    }
+}
+
+static void check_if(Semantic_ctx* ctx, AST_if_node* node)
+{
+    check_stmt(ctx, node->action); 
+    check_cond(ctx, node->cond); 
+    if (node->elif_branches)
+    {
+        VEC_FOR_EACH(&((AST_elif_node*)node->elif_branches)->branches_list, item)
+        {
+            AST_branch_node* branch = item; 
+            check_stmt(ctx, branch->action); 
+            check_cond(ctx, branch->cond); 
+        }
+    }
+    check_stmt(ctx, node->else_action); 
+}
+
+static void check_print(Semantic_ctx* ctx, AST_print_node* node)
+{
+    AST_args_node* args = (AST_args_node*)node->args; 
+    if (!args)
+        return; 
+    if (VEC_size(&args->args_list) >= MAX_PRINT_ARGS)
+    {
+        error_fatal(3, "Error: a big number of arguments\n"); 
+    }
+    VEC_FOR_EACH(&args->args_list, item)
+    {
+        if (!TYPE_IS_PRIMITIVE(check_exp(ctx, ((AST_arg_node*)item)->exp)))
+        {
+            error_fatal(3, "Error: can't print non primitive types\n"); 
+        }
+    }
+}
+
+static void check_read(Semantic_ctx* ctx, AST_read_node* node)
+{
+    VEC_FOR_EACH(&((AST_args_node*)node->args)->args_list, item)
+    {
+        if (!TYPE_IS_PRIMITIVE(check_lval(ctx, ((AST_arg_node*)item)->exp)))
+        {
+            error_fatal(3, "Error: can't read non primitive types\n"); 
+        }
+    }
+}
+
+static void check_stmt(Semantic_ctx* ctx, AST_node* root)
+{
+    if (root == NULL)
+        return; 
+
+    switch (root->type)
+    {
+        case NODE_STATEMENTS:
+            VEC_FOR_EACH(&((AST_statements_node*)root)->stmts_list, item)
+            {
+                check_stmt(ctx, item); 
+            }
+            break; 
+        case NODE_ASSIGN:
+        {
+            AST_assign_node* node = (AST_assign_node*)root; 
+            Type* dest_type = check_lval(ctx, node->dest); 
+            Type* exp_type = check_exp(ctx, node->assign_exp); 
+            type_resolve_assign(dest_type, exp_type); 
+        }
+        break; 
+        case NODE_IF:
+            check_if(ctx, (AST_if_node*)root); 
+            break; 
+        case NODE_FOR:
+        {
+            AST_for_node* node = (AST_for_node*)root; 
+            Type* iter = check_lval(ctx, node->iter); 
+            Type* from = check_exp(ctx, node->from); 
+            Type* to = check_exp(ctx, node->to); 
+            if (!type_equal(iter, TYPE_INT) || !type_equal(from, TYPE_INT) || !type_equal(to, TYPE_INT))
+            {
+                error_fatal(3, "Error: Can't work with non integers in a for loop\n"); 
+            }
+            check_stmt(ctx, node->statements); 
+        }
+        break; 
+        case NODE_WHILE:
+            check_cond(ctx, ((AST_while_node*)root)->cond); 
+            check_stmt(ctx, ((AST_while_node*)root)->statements); 
+            break; 
+        case NODE_DOWHILE:
+            check_stmt(ctx, ((AST_dowhile_node*)root)->statements); 
+            check_cond(ctx, ((AST_dowhile_node*)root)->cond); 
+            break; 
+        case NODE_RETURN:
+        {
+            if (!ctx->current_fn_ret_type)
+            {
+                error_fatal(3, "Error: return statement in void function\n"); 
+            }
+            Type* ret_type = check_exp(ctx, ((AST_return_node*)root)->exp); 
+            if (!type_equal(ret_type, ctx->current_fn_ret_type))
+            {
+                error_fatal(3, "Error: return statement with wrong type\n"); 
+            }
+        }
+        break; 
+        case NODE_PRINT:
+            check_print(ctx, (AST_print_node*)root); 
+            break; 
+        case NODE_READ:
+            check_read(ctx, (AST_read_node*)root); 
+            break; 
+        default:
+            error_fatal(3, "Error : bad ast node not a statement\n"); 
+    }
+}
+
+static Type* check_op(Semantic_ctx* ctx, AST_op_node* node)
+{
+    Type* left = check_exp(ctx, node->lhs); 
+    Type* right = check_exp(ctx, node->rhs); 
+
+    node->operand_type = type_resolve_op(left, right, node->op_type); 
+    node->res_type = op_rel(node->op_type) ? TYPE_BOOL : node->operand_type; 
+    return node->res_type; 
+}
+
+static Type* check_call(Semantic_ctx* ctx, AST_call_node* call)
+{
+    AST_args_node* args = (AST_args_node*)call->args; 
+    Vector args_type; 
+    VEC_init(&args_type, NULL); 
+    if (args != NULL)
+    {
+        VEC_FOR_EACH(&args->args_list, item)
+        {
+            VEC_push_back(&args_type, check_exp(ctx, ((AST_arg_node*)item)->exp)); 
+        }
+    }
+
+    /* overloads are told apart by their arguments */ 
+    Symbol fun_name = ((AST_id_node*)call->id_node)->id; 
+    St_entry* fn_entry = st_find_fun(ctx->sym_tab, fun_name, (Type**)VEC_data(&args_type), VEC_size(&args_type)); 
+    VEC_free(&args_type); 
+    if (!fn_entry)
+    {
+        error_fatal(3, "Error: %s function is not declared or args does not match\n", symbol_name(fun_name)); 
+    }
+
+    call->fun_type = fn_entry->type; 
+    call->callee = fn_entry->decl; 
+    call->ret_type = ((Function_type*)fn_entry->type)->return_type; 
+    return call->ret_type; 
+}
+
+static void check_index(Semantic_ctx* ctx, AST_node* exp)
+{
+    if (!type_equal(check_exp(ctx, exp), TYPE_INT))
+    {
+        error_fatal(3, "index must be an integer\n"); 
+    }
+}
+
+static Type* check_lval(Semantic_ctx* ctx, AST_node* root)
+{
+    switch (root->type)
+    {
+        case NODE_ID:
+        {
+            AST_id_node* node = (AST_id_node*)root; 
+            St_entry* entry = st_find_var(ctx->sym_tab, node->id); 
+            if (entry == NULL)
+            {
+                error_fatal(3, "Error: %s is not declared\n", symbol_name(node->id)); 
+            }
+            node->id_type = entry->type; 
+            return node->id_type; 
+        }
+        case NODE_ARR_SUB:
+        {
+            AST_arr_sub_node* node = (AST_arr_sub_node*)root; 
+            Type* arr_type = check_lval(ctx, node->id_node); 
+            if (!TYPE_IS_ARRAY(arr_type))
+            {
+                error_fatal(3, "%s not an array\n", symbol_name(((AST_id_node*)node->id_node)->id)); 
+            }
+            node->elem_type = ((Array_type*)arr_type)->element_type; 
+            check_index(ctx, node->exp); 
+            return node->elem_type; 
+        }
+        case NODE_MAT_SUB:
+        {
+            AST_mat_sub_node* node = (AST_mat_sub_node*)root; 
+            Type* mat_type = check_lval(ctx, node->id_node); 
+            if (!TYPE_IS_MATRIX(mat_type))
+            {
+                error_fatal(3, "%s not a matrix\n", symbol_name(((AST_id_node*)node->id_node)->id)); 
+            }
+            node->elem_type = ((Matrix_type*)mat_type)->element_type; 
+            check_index(ctx, node->exp[0]); 
+            check_index(ctx, node->exp[1]); 
+            return node->elem_type; 
+        }
+        default:
+            error_fatal(3, "Not an lvalue\n"); 
+    }
+}
+
+static Type* check_exp(Semantic_ctx* ctx, AST_node* root)
+{
+    if (root == NULL)
+        return NULL; 
+
+    switch (root->type)
+    {
+        case NODE_CONST:
+            return ast_exp_type(root); 
+        case NODE_ID:
+        case NODE_ARR_SUB:
+        case NODE_MAT_SUB:
+            return check_lval(ctx, root); 
+        case NODE_OP:
+            return check_op(ctx, (AST_op_node*)root); 
+        case NODE_CALL:
+            return check_call(ctx, (AST_call_node*)root); 
+        default:
+            error_fatal(3, "Error: bad ast node not an expression.\n"); 
+    }
+}
+
+void semantic_check(Semantic_ctx* ctx, AST_node* program_node)
+{
+    assert(program_node != NULL); 
+    AST_program_node* program = (AST_program_node*)program_node; 
+
+    check_new_types(ctx, program->new_types); 
+
+    if (program->subprograms)
+    {
+        VEC_FOR_EACH(&((AST_subprograms_node*)program->subprograms)->functions_list, item)
+        {
+            check_function(ctx, item); 
+        }
+    }
+
+    /* the main program has no return type, its variables are globals */ 
+    check_declarations(ctx, program->declarations); 
+    check_stmt(ctx, program->statements); 
+}
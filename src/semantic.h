@@ -0,0 +1,22 @@
+#ifndef SEMANTIC_H
+#define SEMANTIC_H
+
+#include "ast.h"
+#include "symboltable.h"
+
+/* resolves names, types and overloads ahead of codegen and annotates the ast: 
+ * type nodes get their Type, ids their type, operations their operand and 
+ * result types, calls the selected overload, subscripts their element type. 
+ * every semantic error is reported here, codegen only lowers. 
+ * nothing in this pass touches llvm */ 
+
+typedef struct Semantic_ctx_s {
+    Symbol_table* sym_tab; 
+    Type* current_fn_ret_type; /* NULL in the main program */ 
+} Semantic_ctx; 
+
+void semantic_init(Semantic_ctx* ctx); 
+void semantic_check(Semantic_ctx* ctx, AST_node* program_node); 
+void semantic_cleanup(Semantic_ctx* ctx); 
+
+#endif
@@ -0,0 +1,61 @@
+#include "source.h"
+
+#include <fcntl.h> 
+#include <unistd.h> 
+#include <sys/mman.h> 
+#include <sys/stat.h> 
+
+bool source_map(Source* src, const char* path)
+{
+    src->base = NULL; 
+    src->size = 0; 
+    src->length = 0; 
+
+    int fd = open(path, O_RDONLY); 
+    if (fd < 0)
+        return false; 
+
+    struct stat st; 
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+    {
+        close(fd); 
+        return false; 
+    }
+
+    size_t page = sysconf(_SC_PAGESIZE); 
+    size_t size = st.st_size; 
+    size_t length = (size + 2 + page - 1) / page * page; 
+
+    /* reserve zeroed memory for the file and the two terminating NULs, 
+     * then map the file over it: reading past the end of a file mapping 
+     * faults, reading the anonymous tail does not */ 
+    char* base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0); 
+    if (base == MAP_FAILED)
+    {
+        close(fd); 
+        return false; 
+    }
+    /* private and writable: flex puts NULs after tokens while scanning */ 
+    if (mmap(base, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        munmap(base, length); 
+        close(fd); 
+        return false; 
+    }
+    close(fd); 
+    madvise(base, size, MADV_SEQUENTIAL); 
+
+    src->base = base; 
+    src->size = size; 
+    src->length = length; 
+    return true; 
+}
+
+void source_unmap(Source* src)
+{
+    if (src->base)
+        munmap(src->base, src->length); 
+    src->base = NULL; 
+    src->size = 0; 
+    src->length = 0; 
+}
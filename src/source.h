@@ -0,0 +1,19 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stdbool.h> 
+#include <stddef.h> 
+
+/* a source file mapped in memory so the scanner can read it in place */ 
+typedef struct Source_s {
+    char* base;     /* file bytes followed by two NUL bytes (flex end of buffer) */ 
+    size_t size;    /* file size */ 
+    size_t length;  /* length of the mapping */ 
+} Source; 
+
+/* returns false if the file can't be mapped (pipe, empty file...) 
+ * the caller should fall back to reading it as a stream */ 
+bool source_map(Source* src, const char* path); 
+void source_unmap(Source* src); 
+
+#endif
@@ -1,29 +1,49 @@
 #include "symboltable.h"
 
-static St_entry* st_create_var_entry(const char* name, Type* type, LLVMValueRef value_ref); 
-static St_entry* st_create_fun_entry(const char* name, Type* fun_type, LLVMValueRef fun_ref, LLVMTypeRef llvm_fun_type); 
-static void st_free_entry(void* entry); 
+#include <stdio.h> 
 
-static unsigned int st_hash(const char* key)
-{
-    /* djb2 hash */ 
-    unsigned long hash = 5381;
-    int c;
+static St_entry* st_create_entry(Symbol name, Entry_kind kind, Type* type); 
+static void st_free_entry(St_entry* entry); 
+static St_slot* st_slot(Symbol_table* table, Symbol name, Entry_kind kind, size_t arity, bool create); 
+static void st_bind(Symbol_table* table, St_slot* slot, St_entry* entry); 
 
-    while ((c = *key++))
-        hash = ((hash << 5) + hash) + c; 
+static unsigned int st_hash(Symbol key, Entry_kind kind, size_t arity)
+{
+    /* names are already unique ids, just spread them over the table */ 
+    uint64_t hash = ((uint64_t)key << 8) ^ ((uint64_t)arity << 2) ^ kind; 
+    hash *= 0x9E3779B97F4A7C15ull; 
 
-    return hash % TABLE_SIZE;
+    return hash >> 32; 
 }
 
-Symbol_table* st_create()
+static void* st_alloc(size_t size)
 {
-    Symbol_table* table = malloc(sizeof(Symbol_table)); 
+    void* ptr = calloc(1, size); 
+    if (!ptr)
+    {
+        fprintf(stderr, "Error: out of memory\n"); 
+        exit(1); 
+    }
+    return ptr; 
+}
 
-    for (int i = 0; i < TABLE_SIZE; i++)
+static void* st_realloc(void* ptr, size_t size)
+{
+    ptr = realloc(ptr, size); 
+    if (!ptr)
     {
-        table -> buckets[i] = LL_create_list();
+        fprintf(stderr, "Error: out of memory\n"); 
+        exit(1); 
     }
+    return ptr; 
+}
+
+Symbol_table* st_create()
+{
+    Symbol_table* table = st_alloc(sizeof(Symbol_table)); 
+
+    table -> capacity = ST_INITIAL_CAPACITY; 
+    table -> slots = st_alloc(table -> capacity * sizeof(St_slot)); 
 
     return table; 
 }
@@ -32,121 +52,188 @@ void st_free(Symbol_table* table)
 {
     if (table == NULL)
         return; 
-    for (int i = 0; i < TABLE_SIZE; i++)
-    {
-        LL_free_list(&table -> buckets[i], st_free_entry); 
-    }
+
+    while (table -> entries_count > 0)
+        st_free_entry(table -> entries[--table -> entries_count]); 
+    free(table -> slots); 
+    free(table -> entries); 
+    free(table -> scope_marks); 
     free(table); 
 }
 
-static St_entry* st_create_var_entry(const char* name, Type* type, LLVMValueRef id_alloca)
+void st_push_scope(Symbol_table* table)
 {
-    St_entry* entry = malloc(sizeof(St_entry));
-    
-    entry -> kind = ENTRY_VAR; 
-    entry -> name = strdup(name); 
-    entry -> type = type; 
-    entry -> value_ref = id_alloca; 
-
-    return entry; 
+    if (table -> scope_depth == table -> scope_capacity)
+    {
+        table -> scope_capacity = table -> scope_capacity ? table -> scope_capacity * 2 : 8; 
+        table -> scope_marks = st_realloc(table -> scope_marks, table -> scope_capacity * sizeof(size_t)); 
+    }
+    table -> scope_marks[table -> scope_depth++] = table -> entries_count; 
 }
 
-static St_entry* st_create_fun_entry(const char* name, Type* fun_type, LLVMValueRef fun_ref, LLVMTypeRef llvm_fun_type)
+void st_pop_scope(Symbol_table* table)
 {
-    St_entry* entry = malloc(sizeof(St_entry));
-    
-    entry -> kind = ENTRY_FUN; 
-    entry -> name = strdup(name); 
-    entry -> type = fun_type; 
-    entry -> value_ref = fun_ref; 
-    entry -> type_ref = llvm_fun_type; 
+    if (table -> scope_depth == 0)
+        return; 
 
-    return entry; 
+    size_t mark = table -> scope_marks[--table -> scope_depth]; 
+    while (table -> entries_count > mark)
+    {
+        St_entry* entry = table -> entries[--table -> entries_count]; 
+        /* entries are popped in reverse order so each one heads its chain, 
+         * the slot keeps its key so the next function reuses it */ 
+        St_slot* slot = st_slot(table, entry -> name, entry -> kind, 
+                entry -> kind == ENTRY_FUN ? ((Function_type*)entry -> type) -> param_count : 0, false); 
+        slot -> binding = entry -> shadowed; 
+        st_free_entry(entry); 
+    }
 }
 
-static St_entry* st_create_type_entry(const char* name, Type* type)
+static St_entry* st_create_entry(Symbol name, Entry_kind kind, Type* type)
 {
     St_entry* entry = malloc(sizeof(St_entry));
-    entry -> kind = ENTRY_TYPE; 
-    entry -> name = strdup(name); 
+    
+    entry -> kind = kind; 
+    entry -> name = name; 
     entry -> type = type; 
+    entry -> value_ref = NULL; 
+    entry -> type_ref = NULL; 
+    entry -> decl = NULL; 
+    entry -> scope = 0; 
+    entry -> order = 0; 
+    entry -> shadowed = NULL; 
+
     return entry; 
 }
 
-static void st_free_entry(void* entry)
+static void st_free_entry(St_entry* entry)
 {
     if (!entry)
         return; 
 
-    free(((St_entry*)entry) -> name); 
-    if (((St_entry*)entry) -> kind != ENTRY_VAR)
-        type_free(((St_entry*)entry)->type); 
-    
+    /* the types belong to the type pool */ 
     free(entry); 
 }
 
-int st_insert_var(Symbol_table* table, const char* name, Type* type, LLVMValueRef id_alloca)
+static void st_grow(Symbol_table* table)
 {
-    if (st_find_var(table, name) != NULL)
+    St_slot* old_slots = table -> slots; 
+    size_t old_capacity = table -> capacity; 
+
+    table -> capacity *= 2; 
+    table -> slots = st_alloc(table -> capacity * sizeof(St_slot)); 
+    table -> used = 0; 
+
+    for (size_t i = 0; i < old_capacity; i++)
+    {
+        St_slot* old = &old_slots[i]; 
+        /* dead keys are dropped while rehashing */ 
+        if (old -> name == SYMBOL_NONE || !old -> binding)
+            continue; 
+        size_t index = st_hash(old -> name, old -> kind, old -> arity) & (table -> capacity - 1); 
+        while (table -> slots[index].name != SYMBOL_NONE)
+            index = (index + 1) & (table -> capacity - 1); 
+        table -> slots[index] = *old; 
+        table -> used++; 
+    }
+    free(old_slots); 
+}
+
+/* linear probing, returns NULL if the key is missing and create is false */ 
+static St_slot* st_slot(Symbol_table* table, Symbol name, Entry_kind kind, size_t arity, bool create)
+{
+    if (create && table -> used + 1 > ST_MAX_LOAD(table -> capacity))
+        st_grow(table); 
+
+    unsigned hash = st_hash(name, kind, arity); 
+    size_t mask = table -> capacity - 1; 
+    size_t index = hash & mask; 
+
+    while (table -> slots[index].name != SYMBOL_NONE)
+    {
+        St_slot* slot = &table -> slots[index]; 
+        if (slot -> name == name && slot -> kind == kind && slot -> arity == arity)
+            return slot; 
+        index = (index + 1) & mask; 
+    }
+
+    if (!create)
+        return NULL; 
+
+    St_slot* slot = &table -> slots[index]; 
+    slot -> name = name; 
+    slot -> kind = kind; 
+    slot -> arity = arity; 
+    slot -> binding = NULL; 
+    table -> used++; 
+
+    return slot; 
+}
+
+static void st_bind(Symbol_table* table, St_slot* slot, St_entry* entry)
+{
+    entry -> scope = table -> scope_depth; 
+    entry -> order = table -> entries_count; 
+    entry -> shadowed = slot -> binding; 
+    slot -> binding = entry; 
+
+    if (table -> entries_count == table -> entries_capacity)
+    {
+        table -> entries_capacity = table -> entries_capacity ? table -> entries_capacity * 2 : 64; 
+        table -> entries = st_realloc(table -> entries, table -> entries_capacity * sizeof(St_entry*)); 
+    }
+    table -> entries[table -> entries_count++] = entry; 
+}
+
+int st_insert_var(Symbol_table* table, Symbol name, Type* type, LLVMValueRef id_alloca)
+{
+    St_slot* slot = st_slot(table, name, ENTRY_VAR, 0, true); 
+    if (slot -> binding && slot -> binding -> scope == table -> scope_depth)
         return ST_ALREADY_DECLARED; 
     
-    St_entry* entry = st_create_var_entry(name, type, id_alloca); 
-    unsigned index = st_hash(name); 
-    LL_insert_back(table->buckets[index], entry); 
+    St_entry* entry = st_create_entry(name, ENTRY_VAR, type); 
+    entry -> value_ref = id_alloca; 
+    st_bind(table, slot, entry); 
     
     return ST_INSERT_SUCCESS; 
 }
 
-int st_insert_fun(Symbol_table* table, const char* name, Type* fun_type, LLVMValueRef fun_ref, LLVMTypeRef llvm_fun_type)
+int st_insert_fun(Symbol_table* table, Symbol name, Type* fun_type, LLVMValueRef fun_ref, LLVMTypeRef llvm_fun_type)
 {
     Function_type* type = (Function_type*)fun_type; 
     if (st_find_fun(table, name, type->param_types, type->param_count) != NULL)
         return ST_ALREADY_DECLARED; 
 
-    St_entry* entry = st_create_fun_entry(name, fun_type, fun_ref, llvm_fun_type); 
-    unsigned index = st_hash(name); 
-    LL_insert_back(table->buckets[index], entry); 
+    St_slot* slot = st_slot(table, name, ENTRY_FUN, type->param_count, true); 
+    St_entry* entry = st_create_entry(name, ENTRY_FUN, fun_type); 
+    entry -> value_ref = fun_ref; 
+    entry -> type_ref = llvm_fun_type; 
+    st_bind(table, slot, entry); 
     
     return ST_INSERT_SUCCESS; 
 }
 
-int st_insert_type(Symbol_table* table, const char* name, Type* type)
+int st_insert_type(Symbol_table* table, Symbol name, Type* type)
 {
-    if (st_find_type(table, name) != NULL)
+    St_slot* slot = st_slot(table, name, ENTRY_TYPE, 0, true); 
+    if (slot -> binding && slot -> binding -> scope == table -> scope_depth)
         return ST_ALREADY_DECLARED; 
     
-    St_entry* entry = st_create_type_entry(name, type); 
-    unsigned index = st_hash(name); 
-    LL_insert_back(table->buckets[index], entry); 
+    St_entry* entry = st_create_entry(name, ENTRY_TYPE, type); 
+    st_bind(table, slot, entry); 
     
     return ST_INSERT_SUCCESS; 
 }
 
-St_entry* st_find_var(Symbol_table* table, const char* name)
+St_entry* st_find_var(Symbol_table* table, Symbol name)
 {
-    unsigned index = st_hash(name); 
-
-    LL_FOR_EACH(table->buckets[index], node)
-    {
-        if (!strcmp(((St_entry*)node -> data) -> name, name) 
-                && ((St_entry*)node->data)->kind==ENTRY_VAR)
-        {
-            return (St_entry*) node -> data; 
-        }
-    }
-
-    return NULL; 
+    St_slot* slot = st_slot(table, name, ENTRY_VAR, 0, false); 
+    return slot ? slot -> binding : NULL; 
 }
 
-static bool is_entry_fn_equal(St_entry* entry, const char* name, Type** args, size_t args_count)
+static bool is_entry_fn_equal(St_entry* entry, Type** args, size_t args_count)
 {
-    if (strcmp(name, entry->name))
-        return false; 
-    if (entry->type->kind != TYPE_FUNCTION)
-        return false; 
     Function_type* fn_type = (Function_type*)entry->type; 
-    if (fn_type->param_count != args_count)
-        return false; 
     for (size_t i = 0; i < args_count; i++)
     {
         if (!type_equal(fn_type->param_types[i], args[i]))
@@ -155,34 +242,24 @@ static bool is_entry_fn_equal(St_entry* entry, const char* name, Type** args, si
     return true; 
 }
 
-St_entry* st_find_fun(Symbol_table* table, const char* name, Type** args, size_t args_count)
+St_entry* st_find_fun(Symbol_table* table, Symbol name, Type** args, size_t args_count)
 {
-    unsigned index = st_hash(name); 
+    /* only the overloads with the same arity share a slot */ 
+    St_slot* slot = st_slot(table, name, ENTRY_FUN, args_count, false); 
+    if (!slot)
+        return NULL; 
 
-    LL_FOR_EACH(table->buckets[index], node)
+    for (St_entry* entry = slot -> binding; entry; entry = entry -> shadowed)
     {
-        if (is_entry_fn_equal((St_entry*)node->data, name, args, args_count))
-        {
-            return (St_entry*) node -> data; 
-        }
+        if (is_entry_fn_equal(entry, args, args_count))
+            return entry; 
     }
 
     return NULL; 
-    
 }
 
-St_entry* st_find_type(Symbol_table* table, const char* name)
+St_entry* st_find_type(Symbol_table* table, Symbol name)
 {
-    unsigned index = st_hash(name); 
-
-    LL_FOR_EACH(table->buckets[index], node)
-    {
-        if (!strcmp(((St_entry*)node -> data) -> name, name) 
-                && ((St_entry*)node->data)->kind==ENTRY_TYPE)
-        {
-            return (St_entry*) node -> data; 
-        }
-    }
-
-    return NULL; 
+    St_slot* slot = st_slot(table, name, ENTRY_TYPE, 0, false); 
+    return slot ? slot -> binding : NULL; 
 }
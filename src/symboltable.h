@@ -5,10 +5,11 @@
 #include <string.h> 
 #include <llvm-c/Core.h> //LLVMValueRef
 
-#include "linkedlist.h"
 #include "types.h"
+#include "intern.h"
 
-#define TABLE_SIZE 333
+#define ST_INITIAL_CAPACITY 64 /* must be a power of 2 */ 
+#define ST_MAX_LOAD(cap) ((cap) / 4 * 3)
 
 typedef enum Entry_kind_e {
     ENTRY_FUN, 
@@ -18,34 +19,62 @@ typedef enum Entry_kind_e {
 
 
 typedef struct St_entry_s {
-    char* name;   
+    Symbol name;   
     Entry_kind kind; 
     Type* type; 
     // llvm : 
     LLVMValueRef value_ref; 
-    LLVMTypeRef type_ref;  /* used by function */ 
+    LLVMTypeRef type_ref;  /* used by function, and by narrowed arrays for their storage */ 
+    void* decl;            /* the declaring ast node, semantic pass only */ 
+
+    size_t scope;  /* depth of the scope that declared it */ 
+    size_t order;  /* index in the table's entries, stable for the global scope */ 
+    struct St_entry_s* shadowed; /* next binding with the same key */ 
 } St_entry; 
 
+/* a key is (name, kind, arity), variables and types have an arity of 0 
+ * so overloads with different arities land in different slots */ 
+typedef struct St_slot_s {
+    Symbol name; /* SYMBOL_NONE if the slot was never used */ 
+    Entry_kind kind; 
+    size_t arity; 
+    St_entry* binding; /* innermost binding, NULL once its scopes are popped */ 
+} St_slot; 
+
 typedef struct Symbol_table_s {
-    Linkedlist* buckets[TABLE_SIZE]; 
+    St_slot* slots; 
+    size_t capacity; 
+    size_t used;   /* slots with a key */ 
+
+    /* every live entry in declaration order, scopes are ranges of it */ 
+    St_entry** entries; 
+    size_t entries_count; 
+    size_t entries_capacity; 
+    size_t* scope_marks; 
+    size_t scope_depth; /* 0 is the global scope */ 
+    size_t scope_capacity; 
 } Symbol_table; 
 
 
 Symbol_table* st_create(); 
 void st_free(Symbol_table* table); 
 
+/* function bodies get their own scope, popping it drops its entries */ 
+void st_push_scope(Symbol_table* table); 
+void st_pop_scope(Symbol_table* table); 
 
 #define ST_INSERT_SUCCESS   0
 #define ST_ALREADY_DECLARED  1
 /* return insert success if success */
-/* otherwise already declared if it's already declared duh */
-int st_insert_var(Symbol_table* table, const char* name, Type* type, LLVMValueRef id_alloca); 
-int st_insert_fun(Symbol_table* table, const char* name, Type* type, LLVMValueRef function, LLVMTypeRef fun_type); 
-int st_insert_type(Symbol_table* table, const char* name, Type* type); 
+/* otherwise already declared if it's already declared in the current scope */
+int st_insert_var(Symbol_table* table, Symbol name, Type* type, LLVMValueRef id_alloca); 
+int st_insert_fun(Symbol_table* table, Symbol name, Type* type, LLVMValueRef function, LLVMTypeRef fun_type); 
+int st_insert_type(Symbol_table* table, Symbol name, Type* type); 
 
-St_entry* st_find_var(Symbol_table* table, const char* name); 
+/* lookups return the innermost binding */ 
+St_entry* st_find_var(Symbol_table* table, Symbol name); 
 /* function overloading so you need to pass also args type */ 
-St_entry* st_find_fun(Symbol_table* table, const char* name, Type** args, size_t args_count); 
-St_entry* st_find_type(Symbol_table* table, const char* name); 
+St_entry* st_find_fun(Symbol_table* table, Symbol name, Type** args, size_t args_count); 
+St_entry* st_find_type(Symbol_table* table, Symbol name); 
 
 #endif
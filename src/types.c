@@ -1,129 +1,206 @@
+#include <stdint.h> 
+
 #include "types.h"
+#include "arena.h"
+#include "error.h"
 
 Primitive_type type_primitives[VAL_CHAR + 1] = {
-    {TYPE_PRIMITIVE, VAL_ERR}, 
-    {TYPE_PRIMITIVE, VAL_INT}, 
-    {TYPE_PRIMITIVE, VAL_FLOAT}, 
-    {TYPE_PRIMITIVE, VAL_BOOL}, 
-    {TYPE_PRIMITIVE, VAL_CHAR}, 
+    {TYPE_PRIMITIVE, VAL_ERR, VAL_ERR}, 
+    {TYPE_PRIMITIVE, VAL_INT, VAL_INT}, 
+    {TYPE_PRIMITIVE, VAL_FLOAT, VAL_FLOAT}, 
+    {TYPE_PRIMITIVE, VAL_BOOL, VAL_BOOL}, 
+    {TYPE_PRIMITIVE, VAL_CHAR, VAL_CHAR}, 
 }; 
 
-bool type_is_singelton(Type* type)
+#define TYPE_POOL_INITIAL_CAPACITY 64 /* must be a power of 2 */ 
+
+/* the composite types of a compilation, the primitives are shared singletons */ 
+typedef struct Type_pool_s {
+    Arena types;    /* the types and their params arrays */ 
+    Type** slots;   /* open addressing table, NULL is empty */ 
+    size_t slots_capacity; 
+    size_t count;   /* ids follow the primitives' */ 
+} Type_pool; 
+
+/* each compilation creates its types in the pool of its thread */ 
+static _Thread_local Type_pool* pool = NULL; 
+
+static inline uint32_t type_hash_mix(uint32_t hash, uintptr_t value)
 {
-    for (int val_type = 0; val_type < VAL_TYPE_NB; val_type++)
-    {
-        if (type == (Type*)&type_primitives[val_type])
-            return true; 
-    }
-    return false; 
+    /* fnv-1a on words */ 
+    return (hash ^ (uint32_t)(value ^ ((uint64_t)value >> 32))) * 16777619u; 
 }
 
-bool type_equal(Type* type_a, Type* type_b)
+/* the components are interned already, they are hashed by address */ 
+static uint32_t type_hash(Type* type)
 {
-    if (!type_a || !type_b)
+    uint32_t hash = type_hash_mix(2166136261u, type->kind); 
+    switch (type->kind)
     {
-        fprintf(stderr,"Error: comparing null types\n"); 
-        exit(2); 
+        case TYPE_ARRAY: 
+            hash = type_hash_mix(hash, (uintptr_t)((Array_type*)type)->element_type); 
+            return type_hash_mix(hash, ((Array_type*)type)->size); 
+        case TYPE_MATRIX: 
+            hash = type_hash_mix(hash, (uintptr_t)((Matrix_type*)type)->element_type); 
+            hash = type_hash_mix(hash, ((Matrix_type*)type)->size[0]); 
+            return type_hash_mix(hash, ((Matrix_type*)type)->size[1]); 
+        case TYPE_FUNCTION: 
+        {
+            Function_type* fn_type = (Function_type*)type; 
+            hash = type_hash_mix(hash, (uintptr_t)fn_type->return_type); 
+            for (size_t i = 0; i < fn_type->param_count; i++)
+                hash = type_hash_mix(hash, (uintptr_t)fn_type->param_types[i]); 
+            return type_hash_mix(hash, fn_type->param_count); 
+        }
+        default: 
+            return hash; 
     }
-    if (type_a == type_b)
-        return true; 
-    if (type_a->kind != type_b->kind)
+}
+
+static bool type_same(Type* a, Type* b)
+{
+    if (a->kind != b->kind)
         return false; 
-    switch (type_a->kind)
+    switch (a->kind)
     {
-        case TYPE_PRIMITIVE: 
-            return ((Primitive_type*)type_a)->val_type 
-                                    == ((Primitive_type*)type_b)->val_type; 
+        case TYPE_ARRAY: 
+            return ((Array_type*)a)->element_type == ((Array_type*)b)->element_type 
+                && ((Array_type*)a)->size == ((Array_type*)b)->size; 
+        case TYPE_MATRIX: 
+            return ((Matrix_type*)a)->element_type == ((Matrix_type*)b)->element_type 
+                && ((Matrix_type*)a)->size[0] == ((Matrix_type*)b)->size[0] 
+                && ((Matrix_type*)a)->size[1] == ((Matrix_type*)b)->size[1]; 
+        case TYPE_FUNCTION: 
+        {
+            Function_type* fa = (Function_type*)a; 
+            Function_type* fb = (Function_type*)b; 
+            if (fa->return_type != fb->return_type || fa->param_count != fb->param_count)
+                return false; 
+            for (size_t i = 0; i < fa->param_count; i++)
+            {
+                if (fa->param_types[i] != fb->param_types[i])
+                    return false; 
+            }
+            return true; 
+        }
         default: 
             return false; 
     }
 }
 
-Type* type_primitive_create(Value_type vtype)
-{
-    if (vtype >= VAL_ERR && vtype <= VAL_CHAR)
-        return (Type*)&type_primitives[vtype];
-    return TYPE_ERR;
-}
-
-Type* type_function_create(Type* return_type, Type** param_types, size_t param_count)
+static void type_pool_grow(void)
 {
-    Function_type* type = malloc(sizeof(Function_type)); 
+    size_t capacity = pool->slots_capacity ? pool->slots_capacity * 2 : TYPE_POOL_INITIAL_CAPACITY; 
+    Type** new_slots = calloc(capacity, sizeof(Type*)); 
+    if (!new_slots)
+    {
+        fprintf(stderr, "Error: out of memory\n"); 
+        exit(1); 
+    }
 
-    type->kind = TYPE_FUNCTION; 
-    type->return_type = return_type; 
-    type->param_types = NULL; 
-    if (param_count > 0)
+    for (size_t i = 0; i < pool->slots_capacity; i++)
     {
-        type->param_types = malloc(param_count * sizeof(Type*)); 
-        memcpy(type->param_types, param_types, param_count * sizeof(Type*)); 
+        Type* type = pool->slots[i]; 
+        if (!type)
+            continue; 
+        size_t index = type_hash(type) & (capacity - 1); 
+        while (new_slots[index])
+            index = (index + 1) & (capacity - 1); 
+        new_slots[index] = type; 
     }
-    type->param_count = param_count; 
 
-    return (Type*) type; 
+    free(pool->slots); 
+    pool->slots = new_slots; 
+    pool->slots_capacity = capacity; 
 }
 
-Type* type_array_create(Type* elem_type, size_t arr_size)
+/* returns the pooled copy of key, size is the size of key's struct */ 
+static Type* type_intern(Type* key, size_t size)
 {
-    Array_type* type = malloc(sizeof(Array_type)); 
-
-    type->kind = TYPE_ARRAY; 
-    type->element_type = elem_type; 
-    type->size = arr_size; 
+    if (!pool)
+    {
+        pool = calloc(1, sizeof(Type_pool)); 
+        if (!pool)
+        {
+            fprintf(stderr, "Error: out of memory\n"); 
+            exit(1); 
+        }
+    }
 
-    return (Type*)type; 
-}
+    /* keep the load under 1/2 */ 
+    if (pool->count * 2 >= pool->slots_capacity)
+        type_pool_grow(); 
 
-Type* type_matrix_create(Type* elem_type, size_t size_row, size_t size_col)
-{
-    Matrix_type* type = malloc(sizeof(Matrix_type)); 
+    size_t index = type_hash(key) & (pool->slots_capacity - 1); 
+    while (pool->slots[index])
+    {
+        if (type_same(pool->slots[index], key))
+            return pool->slots[index]; 
+        index = (index + 1) & (pool->slots_capacity - 1); 
+    }
 
-    type->kind = TYPE_MATRIX; 
-    type->element_type = elem_type; 
-    type->size[0] = size_row; 
-    type->size[1] = size_col; 
+    Type* type = arena_alloc(&pool->types, size); 
+    memcpy(type, key, size); 
+    if (type->kind == TYPE_FUNCTION && ((Function_type*)key)->param_count > 0)
+    {
+        Function_type* fn_type = (Function_type*)type; 
+        size_t params_size = fn_type->param_count * sizeof(Type*); 
+        fn_type->param_types = arena_alloc(&pool->types, params_size); 
+        memcpy(fn_type->param_types, ((Function_type*)key)->param_types, params_size); 
+    }
+    type->id = VAL_TYPE_NB + pool->count++; 
+    pool->slots[index] = type; 
 
-    return (Type*)type; 
+    return type; 
 }
 
-/* this should be called during sym tables freeing so recursing is not needed */ 
-void type_free(Type* type)
+void type_pool_release(void)
 {
-    if (!type || type_is_singelton(type))
+    if (!pool)
         return; 
+    arena_release(&pool->types); 
+    free(pool->slots); 
+    free(pool); 
+    pool = NULL; 
+}
 
-    switch (type->kind)
+bool type_equal(Type* type_a, Type* type_b)
+{
+    if (!type_a || !type_b)
     {
-        case TYPE_FUNCTION: 
-            {
-            Function_type* fn_type = (Function_type*)type; 
-            //type_free(fn_type->return_type); 
-            if (fn_type->param_types)
-            {
-                for (size_t i = 0; i < fn_type->param_count; i++)
-                {
-                    //type_free(fn_type->param_types[i]);
-                }
-                free(fn_type->param_types); 
-            }
-            }
-            break; 
-        case TYPE_PRIMITIVE: 
-        case TYPE_MATRIX: 
-        case TYPE_ARRAY: 
-            break; 
-        default: 
-            fprintf(stderr, "not implemented yet\n"); 
-            exit(1); 
+        error_fatal(2, "Error: comparing null types\n"); 
     }
+    return type_a == type_b; 
+}
 
-    free(type); 
+Type* type_primitive_create(Value_type vtype)
+{
+    if (vtype >= VAL_ERR && vtype <= VAL_CHAR)
+        return (Type*)&type_primitives[vtype];
+    return TYPE_ERR;
+}
+
+Type* type_function_create(Type* return_type, Type** param_types, size_t param_count)
+{
+    Function_type key = {TYPE_FUNCTION, 0, return_type, param_types, param_count}; 
+    return type_intern((Type*)&key, sizeof(Function_type)); 
+}
+
+Type* type_array_create(Type* elem_type, size_t arr_size)
+{
+    Array_type key = {TYPE_ARRAY, 0, arr_size, elem_type}; 
+    return type_intern((Type*)&key, sizeof(Array_type)); 
+}
+
+Type* type_matrix_create(Type* elem_type, size_t size_row, size_t size_col)
+{
+    Matrix_type key = {TYPE_MATRIX, 0, {size_row, size_col}, elem_type}; 
+    return type_intern((Type*)&key, sizeof(Matrix_type)); 
 }
 
 void type_error(char* msg)
 {
-    fprintf(stderr, "Error : %s\n", msg); 
-    exit(3); 
+    error_fatal(3, "Error : %s\n", msg); 
 }
 
 bool op_rel(Op_type op)
@@ -287,7 +364,8 @@ Type* type_resolve_assign(Type* dest, Type* exp)
 }
 
 
-LLVMTypeRef type_to_llvm_type(Type* type)
+/* cache is NULL for a one off type */ 
+static LLVMTypeRef build_llvm_type(LLVMContextRef context, Llvm_type_cache* cache, Type* type)
 {
     switch (type->kind)
     {
@@ -295,36 +373,95 @@ LLVMTypeRef type_to_llvm_type(Type* type)
         switch (((Primitive_type*)type) -> val_type)
         {
             case VAL_INT:
-                return LLVMInt32Type();
+                return LLVMInt32TypeInContext(context);
             case VAL_FLOAT:
-                return LLVMFloatType();
+                return LLVMFloatTypeInContext(context);
             case VAL_BOOL:
-                return LLVMInt1Type();
+                return LLVMInt1TypeInContext(context);
             case VAL_CHAR:
-                return LLVMInt8Type();
+                return LLVMInt8TypeInContext(context);
             default:
-                fprintf(stderr, "Error: bad type\n");
-                exit(3);
+                error_fatal(3, "Error: bad type\n");
         }
         break; 
         case TYPE_ARRAY: 
         {
             Array_type* arr_type = (Array_type*)type; 
-            LLVMTypeRef elem_llvm_type = type_to_llvm_type(arr_type->element_type); 
+            LLVMTypeRef elem_llvm_type = cache ? type_to_llvm_type_cached(cache, arr_type->element_type) 
+                                               : type_to_llvm_type(context, arr_type->element_type); 
             return LLVMArrayType(elem_llvm_type, arr_type->size); 
         }
         break; 
         case TYPE_MATRIX: 
         {
             Matrix_type* mat_type = (Matrix_type*)type; 
-            LLVMTypeRef elem_llvm_type = type_to_llvm_type(mat_type->element_type); 
+            LLVMTypeRef elem_llvm_type = cache ? type_to_llvm_type_cached(cache, mat_type->element_type) 
+                                               : type_to_llvm_type(context, mat_type->element_type); 
             LLVMTypeRef inner = LLVMArrayType(elem_llvm_type, mat_type->size[1]); 
             return LLVMArrayType(inner, mat_type->size[0]); 
         }
         break; 
+        case TYPE_FUNCTION: 
+        {
+            Function_type* fn_type = (Function_type*)type; 
+            LLVMTypeRef* params = NULL; 
+            if (fn_type->param_count > 0)
+                params = malloc(fn_type->param_count * sizeof(LLVMTypeRef)); 
+            for (size_t i = 0; i < fn_type->param_count; i++)
+            {
+                params[i] = cache ? type_to_llvm_type_cached(cache, fn_type->param_types[i]) 
+                                  : type_to_llvm_type(context, fn_type->param_types[i]); 
+            }
+            LLVMTypeRef ret = cache ? type_to_llvm_type_cached(cache, fn_type->return_type) 
+                                    : type_to_llvm_type(context, fn_type->return_type); 
+            LLVMTypeRef llvm_fn_type = LLVMFunctionType(ret, params, fn_type->param_count, 0); 
+            free(params); 
+            return llvm_fn_type; 
+        }
         default: 
-        fprintf(stderr, "not implemented yet\n");
-        exit(3);
+        error_fatal(3, "not implemented yet\n");
     }
     return NULL;
 }
+
+LLVMTypeRef type_to_llvm_type(LLVMContextRef context, Type* type)
+{
+    return build_llvm_type(context, NULL, type); 
+}
+
+void llvm_type_cache_init(Llvm_type_cache* cache, LLVMContextRef context)
+{
+    cache->context = context; 
+    cache->refs = NULL; 
+    cache->capacity = 0; 
+}
+
+void llvm_type_cache_free(Llvm_type_cache* cache)
+{
+    free(cache->refs); 
+    cache->refs = NULL; 
+    cache->capacity = 0; 
+}
+
+LLVMTypeRef type_to_llvm_type_cached(Llvm_type_cache* cache, Type* type)
+{
+    if (type->id >= cache->capacity)
+    {
+        size_t capacity = cache->capacity ? cache->capacity : 64; 
+        while (capacity <= type->id)
+            capacity *= 2; 
+        LLVMTypeRef* refs = realloc(cache->refs, capacity * sizeof(LLVMTypeRef)); 
+        if (!refs)
+        {
+            fprintf(stderr, "Error: out of memory\n"); 
+            exit(1); 
+        }
+        memset(refs + cache->capacity, 0, (capacity - cache->capacity) * sizeof(LLVMTypeRef)); 
+        cache->refs = refs; 
+        cache->capacity = capacity; 
+    }
+
+    if (!cache->refs[type->id])
+        cache->refs[type->id] = build_llvm_type(cache->context, cache, type); 
+    return cache->refs[type->id]; 
+}
@@ -30,12 +30,17 @@ typedef enum Type_kind_e {
     TYPE_MATRIX, 
 } Type_kind; 
 
+/* types are hash consed: each distinct type exists once per compilation, 
+ * two types are equal if they are the same pointer. 
+ * ids are dense, the primitives come first, they index the llvm type caches */ 
 typedef struct Type_s {
     Type_kind kind; 
+    size_t id; 
 } Type; 
 
 typedef struct Matrix_type_s{
     Type_kind kind; 
+    size_t id; 
     
     size_t size[2];   
     Type* element_type; 
@@ -43,14 +48,15 @@ typedef struct Matrix_type_s{
 
 typedef struct Array_type_s {
     Type_kind kind; 
+    size_t id; 
     
     size_t size;   
     Type* element_type; 
 } Array_type; 
 
-/* should be responsible for freeing the array of params types */ 
 typedef struct Function_type_s {
     Type_kind kind; 
+    size_t id; 
 
     Type* return_type;
     Type** param_types;
@@ -59,6 +65,7 @@ typedef struct Function_type_s {
 
 typedef struct Primitive_type_s {
     Type_kind kind; 
+    size_t id; 
     
     Value_type val_type; 
 } Primitive_type;  
@@ -93,18 +100,20 @@ extern Primitive_type type_primitives[VAL_TYPE_NB];
 #define TYPE_CHAR   ((Type*)&type_primitives[VAL_CHAR])
 #define TYPE_ERR    ((Type*)&type_primitives[VAL_ERR])
 
-bool type_is_singelton(Type* type); 
 bool type_equal(Type* type_a, Type* type_b); 
 
 #define TYPE_IS_PRIMITIVE(t) ((t)->kind == TYPE_PRIMITIVE)
 Type* type_primitive_create(Value_type val_type); 
+/* the create functions return the existing type if there is one, 
+ * types live in the pool of the calling thread until type_pool_release */ 
 /* warning: the params array will be copied */ 
 Type* type_function_create(Type* return_type, Type** param_types, size_t param_count);
 #define TYPE_IS_ARRAY(t) ((t)->kind == TYPE_ARRAY)
 Type* type_array_create(Type* elem_type, size_t arr_size); 
 #define TYPE_IS_MATRIX(t) ((t)->kind == TYPE_MATRIX)
 Type* type_matrix_create(Type* elem_type, size_t size_row, size_t size_col); 
-void type_free(Type* type);  
+/* frees every type of the calling thread */ 
+void type_pool_release(void); 
 
 bool op_rel(Op_type op); /* check whether an operation is a relational operation */
 bool op_unary(Op_type op); /* check whether an operation is a unary operation */ 
@@ -112,6 +121,17 @@ bool op_unary(Op_type op); /* check whether an operation is a unary operation */
 Type* type_resolve_op(Type* left, Type* right, Op_type op); 
 Type* type_resolve_assign(Type* dest, Type* exp); 
 
-LLVMTypeRef type_to_llvm_type(Type* type);
+LLVMTypeRef type_to_llvm_type(LLVMContextRef context, Type* type);
+
+/* the llvm types built for one context, each type is built once */ 
+typedef struct Llvm_type_cache_s {
+    LLVMContextRef context; 
+    LLVMTypeRef* refs;  /* indexed by type id, NULL until built */ 
+    size_t capacity; 
+} Llvm_type_cache; 
+
+void llvm_type_cache_init(Llvm_type_cache* cache, LLVMContextRef context); 
+void llvm_type_cache_free(Llvm_type_cache* cache); 
+LLVMTypeRef type_to_llvm_type_cached(Llvm_type_cache* cache, Type* type); 
 
 #endif
@@ -0,0 +1,71 @@
+#include "vector.h"
+
+#include <stdio.h> 
+#include <string.h> 
+
+void VEC_init(Vector* vec, Arena* arena)
+{
+    vec->size = 0; 
+    vec->capacity = VEC_INLINE_CAP; 
+    vec->arena = arena; 
+    vec->heap = NULL; 
+}
+
+void VEC_free(Vector* vec)
+{
+    if (vec == NULL)
+        return; 
+    if (vec->arena == NULL)
+        free(vec->heap); 
+    VEC_init(vec, vec->arena); 
+}
+
+static void VEC_grow(Vector* vec)
+{
+    size_t new_capacity = vec->capacity * 2; 
+    void** new_data; 
+
+    if (vec->arena != NULL)
+    {
+        /* the old block stays in the arena until it is released */ 
+        new_data = arena_alloc(vec->arena, new_capacity * sizeof(void*)); 
+        memcpy(new_data, VEC_data(vec), vec->size * sizeof(void*)); 
+    }
+    else if (vec->heap != NULL)
+    {
+        new_data = realloc(vec->heap, new_capacity * sizeof(void*)); 
+    }
+    else 
+    {
+        new_data = malloc(new_capacity * sizeof(void*)); 
+        if (new_data)
+            memcpy(new_data, vec->inline_data, vec->size * sizeof(void*)); 
+    }
+
+    if (!new_data)
+    {
+        fprintf(stderr, "Error: out of memory\n"); 
+        exit(1); 
+    }
+    vec->heap = new_data; 
+    vec->capacity = new_capacity; 
+}
+
+void VEC_push_back(Vector* vec, void* data)
+{
+    if (vec->size == vec->capacity)
+        VEC_grow(vec); 
+    VEC_data(vec)[vec->size++] = data; 
+}
+
+void* VEC_pop_back(Vector* vec)
+{
+    if (vec->size == 0)
+        return NULL; 
+    return VEC_data(vec)[--vec->size]; 
+}
+
+void VEC_clear(Vector* vec)
+{
+    vec->size = 0; 
+}
@@ -0,0 +1,56 @@
+#ifndef VECTOR_H
+#define VECTOR_H
+
+#include <stdlib.h>  
+#include <stdbool.h> 
+#include <stddef.h> 
+
+#include "arena.h"
+
+/* growable array of pointers, the first VEC_INLINE_CAP elements are stored 
+ * inside the struct so small lists never allocate */ 
+#define VEC_INLINE_CAP 4
+
+#define VEC_FOR_EACH(vec, item)\
+    for (void **item##_it = VEC_data(vec), **item##_end = item##_it + (vec)->size, *item = NULL;\
+            item##_it != item##_end && ((item) = *item##_it, true); item##_it++)
+
+typedef struct Vector_s {
+    size_t size; 
+    size_t capacity; 
+    Arena* arena; /* NULL if the storage is malloc'd */ 
+    void** heap;  /* NULL while the elements fit inline */ 
+    void* inline_data[VEC_INLINE_CAP]; 
+} Vector; 
+
+void    VEC_init(Vector* vec, Arena* arena); 
+/* frees the malloc'd storage, no-op for arena vectors */ 
+void    VEC_free(Vector* vec); 
+
+void    VEC_push_back(Vector* vec, void* data); 
+void*   VEC_pop_back(Vector* vec); 
+void    VEC_clear(Vector* vec); 
+
+/* the storage can be borrowed as a plain array until the next push */ 
+static inline void** VEC_data(Vector* vec) 
+{
+    return vec->heap ? vec->heap : vec->inline_data; 
+}
+static inline void* VEC_at(Vector* vec, size_t index)
+{
+    return VEC_data(vec)[index]; 
+}
+static inline void* VEC_back(Vector* vec)
+{
+    return vec->size ? VEC_data(vec)[vec->size - 1] : NULL; 
+}
+static inline size_t VEC_size(Vector* vec)
+{
+    return vec ? vec->size : 0; 
+}
+static inline bool VEC_empty(Vector* vec)
+{
+    return VEC_size(vec) == 0; 
+}
+
+#endif